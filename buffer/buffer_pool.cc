@@ -0,0 +1,314 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "buffer_pool.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+static const size_t kClasses = 15;
+static const size_t kMinChunkShift = 6;
+static const size_t kCacheBytes = 1 << 20;
+
+static_assert((1 << kMinChunkShift) == BufferPool::MIN_CHUNK_SIZE,
+              "min chunk size does not match its shift");
+static_assert((BufferPool::MIN_CHUNK_SIZE << (kClasses - 1)) ==
+              BufferPool::MAX_CHUNK_SIZE,
+              "max chunk size does not match the number of classes");
+
+/// FreeList is an intrusive list of free chunks,
+/// linked through their first bytes
+struct FreeList final {
+  struct Node final {
+    Node *next;
+  };
+
+  inline void push(uint8_t *chunk) noexcept {
+    Node *node = reinterpret_cast<Node*>(chunk);
+    node->next = head;
+    head = node;
+    size++;
+  }
+
+  inline uint8_t *pop() noexcept {
+    Node *node = head;
+    if (node == nullptr) {
+      return nullptr;
+    }
+
+    head = node->next;
+    size--;
+    return reinterpret_cast<uint8_t*>(node);
+  }
+
+  /// move moves up to `len` chunks to `list`, and
+  /// returns the number of chunks moved
+  inline size_t move(FreeList *list, size_t len) noexcept {
+    size_t moved = 0;
+    uint8_t *chunk;
+
+    while (moved < len && (chunk = pop()) != nullptr) {
+      list->push(chunk);
+      moved++;
+    }
+
+    return moved;
+  }
+
+  Node *head = nullptr;
+  size_t size = 0;
+};
+
+/// Depot keeps the chunks shared by all the threads
+struct Depot final {
+  std::mutex mutex;
+  FreeList lists[kClasses];
+  std::atomic<bool> hugepages{false};
+};
+
+/// depot is never destroyed, so that the caches of the threads
+/// that exit after the static destructors run can still give
+/// their chunks back
+static Depot *depot() {
+  static Depot *depot = new Depot();
+  return depot;
+}
+
+static inline size_t chunk_class(size_t len) {
+  if (len <= BufferPool::MIN_CHUNK_SIZE) {
+    return 0;
+  }
+
+  const size_t shift = 64 - __builtin_clzll(static_cast<uint64_t>(len - 1));
+  return shift - kMinChunkShift;
+}
+
+static inline size_t class_size(size_t cls) {
+  return BufferPool::MIN_CHUNK_SIZE << cls;
+}
+
+/// batch returns the number of chunks of a class
+/// that move between a cache and the depot at once
+static inline size_t batch(size_t cls) {
+  return std::max<size_t>(1, (kCacheBytes >> 1) / class_size(cls));
+}
+
+/// map_slab maps SLAB_SIZE bytes aligned to SLAB_SIZE
+static uint8_t *map_slab() {
+  const int prot = PROT_READ | PROT_WRITE;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_HUGETLB
+  if (depot()->hugepages) {
+    // huge pages are aligned to their size
+    void *mem = mmap(nullptr, BufferPool::SLAB_SIZE, prot,
+                     flags | MAP_HUGETLB, -1, 0);
+    if (mem != MAP_FAILED) {
+      return static_cast<uint8_t*>(mem);
+    }
+  }
+#endif
+
+  const size_t size = BufferPool::SLAB_SIZE << 1;
+  void *mem = mmap(nullptr, size, prot, flags, -1, 0);
+  if (mem == MAP_FAILED) {
+    return nullptr;
+  }
+
+  uint8_t *base = static_cast<uint8_t*>(mem);
+  uint8_t *slab = reinterpret_cast<uint8_t*>(
+      (reinterpret_cast<uintptr_t>(base) + BufferPool::SLAB_SIZE - 1) &
+      ~(BufferPool::SLAB_SIZE - 1));
+
+  if (slab > base) {
+    munmap(base, slab - base);
+  }
+
+  uint8_t *end = slab + BufferPool::SLAB_SIZE;
+  if (end < base + size) {
+    munmap(end, base + size - end);
+  }
+
+  return slab;
+}
+
+/// carve maps a new slab and pushes all its chunks to `list`
+static bool carve(size_t cls, FreeList *list) {
+  uint8_t *slab = map_slab();
+  if (slab == nullptr) {
+    return false;
+  }
+
+  const size_t size = class_size(cls);
+  for (size_t offset = BufferPool::SLAB_SIZE; offset > 0; offset -= size) {
+    list->push(slab + offset - size);
+  }
+
+  return true;
+}
+
+/// cache_destroyed is set once the cache of the thread is destroyed.
+/// Chunks acquired or released later on, from the destructors of other
+/// thread_local objects, go through the depot instead
+static thread_local bool cache_destroyed = false;
+
+/// ThreadCache keeps the free chunks of a thread
+class ThreadCache final {
+ public:
+  ThreadCache() = default;
+
+  ~ThreadCache() {
+    Depot *depot = ::depot();
+    std::lock_guard<std::mutex> lock(depot->mutex);
+    cache_destroyed = true;
+
+    for (size_t cls = 0; cls < kClasses; cls++) {
+      m_lists[cls].move(&depot->lists[cls], m_lists[cls].size);
+    }
+  }
+
+  ThreadCache(const ThreadCache &cache) = delete;
+  ThreadCache(ThreadCache &&cache) = delete;
+  ThreadCache& operator=(const ThreadCache &cache) = delete;
+  ThreadCache& operator=(ThreadCache &&cache) = delete;
+
+  inline uint8_t *acquire(size_t cls) noexcept {
+    uint8_t *chunk = m_lists[cls].pop();
+    if (chunk == nullptr && refill(cls)) {
+      chunk = m_lists[cls].pop();
+    }
+
+    return chunk;
+  }
+
+  inline void release(uint8_t *chunk, size_t cls) noexcept {
+    m_lists[cls].push(chunk);
+
+    if (m_lists[cls].size > (batch(cls) << 1)) {
+      Depot *depot = ::depot();
+      std::lock_guard<std::mutex> lock(depot->mutex);
+      m_lists[cls].move(&depot->lists[cls], batch(cls));
+    }
+  }
+
+ private:
+  bool refill(size_t cls) noexcept {
+    Depot *depot = ::depot();
+
+    {
+      std::lock_guard<std::mutex> lock(depot->mutex);
+      if (depot->lists[cls].move(&m_lists[cls], batch(cls)) > 0) {
+        return true;
+      }
+    }
+
+    FreeList list;
+    if (!carve(cls, &list)) {
+      return false;
+    }
+
+    list.move(&m_lists[cls], batch(cls));
+
+    std::lock_guard<std::mutex> lock(depot->mutex);
+    list.move(&depot->lists[cls], list.size);
+    return true;
+  }
+
+  FreeList m_lists[kClasses];
+};
+
+static thread_local ThreadCache cache;
+
+static uint8_t *depot_acquire(size_t cls) {
+  Depot *depot = ::depot();
+  std::lock_guard<std::mutex> lock(depot->mutex);
+
+  uint8_t *chunk = depot->lists[cls].pop();
+  if (chunk == nullptr && carve(cls, &depot->lists[cls])) {
+    chunk = depot->lists[cls].pop();
+  }
+
+  return chunk;
+}
+
+static void depot_release(uint8_t *chunk, size_t cls) {
+  Depot *depot = ::depot();
+  std::lock_guard<std::mutex> lock(depot->mutex);
+  depot->lists[cls].push(chunk);
+}
+
+uint8_t *BufferPool::acquire(size_t len, size_t *capacity) noexcept {
+  if (len > MAX_CHUNK_SIZE) {
+    *capacity = len;
+    return new (std::nothrow) uint8_t[len];
+  }
+
+  const size_t cls = chunk_class(len);
+  *capacity = class_size(cls);
+  return cache_destroyed ? depot_acquire(cls) : cache.acquire(cls);
+}
+
+void BufferPool::release(uint8_t *chunk, size_t capacity) noexcept {
+  if (capacity > MAX_CHUNK_SIZE) {
+    delete [] chunk;
+    return;
+  }
+
+  if (cache_destroyed) {
+    depot_release(chunk, chunk_class(capacity));
+  } else {
+    cache.release(chunk, chunk_class(capacity));
+  }
+}
+
+DisposeFunc BufferPool::dispose_func(size_t capacity) noexcept {
+  return DisposeFunc::pool(capacity);
+}
+
+size_t BufferPool::reserve(size_t len, size_t count) noexcept {
+  if (len > MAX_CHUNK_SIZE) {
+    return 0;
+  }
+
+  const size_t cls = chunk_class(len);
+  FreeList list;
+
+  while (list.size < count) {
+    if (!carve(cls, &list)) {
+      break;
+    }
+  }
+
+  const size_t reserved = list.size;
+  Depot *depot = ::depot();
+  std::lock_guard<std::mutex> lock(depot->mutex);
+  list.move(&depot->lists[cls], list.size);
+  return reserved;
+}
+
+void BufferPool::use_hugepages(bool enable) noexcept {
+  depot()->hugepages = enable;
+}
+
+std::unique_ptr<StreamBuffer> BufferPool::make_stream_buffer(size_t capacity) {
+  size_t size;
+  uint8_t *chunk = acquire(capacity, &size);
+  if (chunk == nullptr) {
+    return nullptr;
+  }
+
+  return std::make_unique<StreamBuffer>(chunk, size, dispose_func(size));
+}
+
+std::unique_ptr<MsgBuffer> BufferPool::make_msg_buffer(size_t capacity) {
+  size_t size;
+  uint8_t *chunk = acquire(capacity, &size);
+  if (chunk == nullptr) {
+    return nullptr;
+  }
+
+  return std::make_unique<MsgBuffer>(chunk, size, dispose_func(size));
+}
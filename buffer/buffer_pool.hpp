@@ -0,0 +1,72 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef BUFFER_BUFFERPOOL_H_
+#define BUFFER_BUFFERPOOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "dispose_func.hpp"
+#include "msg_buffer.hpp"
+#include "stream_buffer.hpp"
+
+/// BufferPool hands out the memory for buffers from size classes
+/// of power of two sizes, between MIN_CHUNK_SIZE and MAX_CHUNK_SIZE
+/// bytes. Chunks are aligned to their size, so they are always
+/// cache line aligned, and they are carved from slabs of SLAB_SIZE
+/// bytes that are mapped once and never given back to the system.
+/// Slabs can be backed by huge pages.
+///
+/// Each thread keeps a cache of free chunks per size class, so
+/// acquiring and releasing chunks does not take any lock in the
+/// common case. Caches that grow too large give chunks back to a
+/// global depot, from which the threads with empty caches take
+/// them. A chunk can be released from any thread.
+///
+/// Requests larger than MAX_CHUNK_SIZE are served from the heap.
+class BufferPool final {
+ public:
+  static const size_t MIN_CHUNK_SIZE = 64;
+  static const size_t MAX_CHUNK_SIZE = 1 << 20;
+  static const size_t SLAB_SIZE = 2 << 20;
+
+  BufferPool() = delete;
+
+  /// acquire returns a chunk of at least `len` bytes, and
+  /// sets `capacity` to the size of the chunk. It returns
+  /// nullptr if no memory can be mapped for the chunk
+  static uint8_t *acquire(size_t len, size_t *capacity) noexcept;
+
+  /// release gives back a chunk returned by `acquire`,
+  /// where `capacity` is the capacity of the chunk
+  static void release(uint8_t *chunk, size_t capacity) noexcept;
+
+  /// dispose_func returns the DisposeFunc that releases
+  /// a chunk of `capacity` bytes back to the pool
+  static DisposeFunc dispose_func(size_t capacity) noexcept;
+
+  /// reserve maps the slabs needed for `count` chunks of at
+  /// least `len` bytes, and keeps the chunks in the depot, so
+  /// that they are ready before the first call to `acquire`.
+  /// It returns the number of chunks reserved
+  static size_t reserve(size_t len, size_t count) noexcept;
+
+  /// use_hugepages makes the slabs mapped from now on
+  /// be backed by huge pages if the system has them
+  /// available. It is disabled by default
+  static void use_hugepages(bool enable) noexcept;
+
+  /// make_stream_buffer returns a StreamBuffer of at
+  /// least `capacity` bytes backed by a chunk of the pool,
+  /// or nullptr if the chunk could not be acquired
+  static std::unique_ptr<StreamBuffer> make_stream_buffer(size_t capacity);
+
+  /// make_msg_buffer returns a MsgBuffer of at least
+  /// `capacity` bytes backed by a chunk of the pool,
+  /// or nullptr if the chunk could not be acquired
+  static std::unique_ptr<MsgBuffer> make_msg_buffer(size_t capacity);
+};
+
+#endif  // BUFFER_BUFFERPOOL_H_
@@ -3,10 +3,15 @@
 #include <string.h>
 
 #include <memory>
+#include <string>
+#include <thread>
 #include "test/test.hpp"
 
 #include "io/copy.hpp"
 
+#include "buffer_pool.hpp"
+#include "buffered_writer.hpp"
+#include "ring_stream_buffer.hpp"
 #include "stream_buffer.hpp"
 #include "msg_buffer.hpp"
 
@@ -63,6 +68,93 @@ static int test_read_write_too_much_message() {
   return EXIT_SUCCESS;
 }
 
+static int test_msg_buffer_messages(bool index) {
+  MsgBuffer buffer(64);
+  const uint8_t *msg;
+  uint8_t readdata[kDataLen];
+  size_t wbytes, rbytes, pbytes;
+
+  if (index) {
+    buffer.index();
+  }
+
+  for (size_t len = 1; len <= 5; len++) {
+    ASSERT_EQ(buffer.write(data, len, &wbytes), OK);
+    ASSERT_EQ(wbytes, len);
+  }
+
+  ASSERT_EQ(buffer.messages(), 5);
+  ASSERT_EQ(buffer.compactable(), 0);
+
+  ASSERT_EQ(buffer.peek_message(3, &msg, &pbytes), OK);
+  ASSERT_EQ(pbytes, 4);
+  ASSERT_MEM_EQ(msg, data, 4);
+
+  ASSERT_EQ(buffer.peek_message(5, &msg, &pbytes), OK);
+  ASSERT_EQ(pbytes, 0);
+
+  // only whole messages are consumed
+  ASSERT_EQ(buffer.consume(5), 3);
+  ASSERT_EQ(buffer.messages(), 3);
+  ASSERT_EQ(buffer.compactable(), 11);
+
+  ASSERT_EQ(buffer.peek_message(0, &msg, &pbytes), OK);
+  ASSERT_EQ(pbytes, 3);
+
+  // compaction keeps all the messages not yet read
+  ASSERT_EQ(buffer.compact(), 11);
+  ASSERT_EQ(buffer.compactable(), 0);
+  ASSERT_EQ(buffer.write(data, 6, &wbytes), OK);
+  ASSERT_EQ(wbytes, 6);
+
+  for (size_t len = 3; len <= 6; len++) {
+    ASSERT_EQ(buffer.peek_message(len - 3, &msg, &pbytes), OK);
+    ASSERT_EQ(pbytes, len);
+    ASSERT_MEM_EQ(msg, data, len);
+  }
+
+  ASSERT_EQ(buffer.read(readdata, kDataLen, &rbytes), OK);
+  ASSERT_EQ(rbytes, 3);
+  ASSERT_EQ(buffer.consume(kDataLen), 9);
+  ASSERT_EQ(buffer.consume(kDataLen), 6);
+  ASSERT_EQ(buffer.messages(), 0);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_msg_buffer_index_ring() {
+  MsgBuffer buffer(4096);
+  const uint8_t *msg;
+  size_t wbytes, pbytes;
+  size_t written = 0, consumed = 0;
+
+  buffer.index();
+
+  // the index wraps around as messages are consumed, and
+  // grows once more messages are held than it has room for
+  for (size_t round = 0; round < 4; round++) {
+    for (size_t i = 0; i < 60; i++, written++) {
+      const size_t len = written % kDataLen + 1;
+      ASSERT_EQ(buffer.write(data, len, &wbytes), OK);
+      ASSERT_EQ(wbytes, len);
+    }
+
+    ASSERT_EQ(buffer.consume_messages(20), 20);
+    consumed += 20;
+    buffer.compact();
+
+    for (size_t k = 0; k < buffer.messages(); k++) {
+      const size_t len = (consumed + k) % kDataLen + 1;
+      ASSERT_EQ(buffer.peek_message(k, &msg, &pbytes), OK);
+      ASSERT_EQ(pbytes, len);
+      ASSERT_MEM_EQ(msg, data, pbytes);
+    }
+  }
+
+  ASSERT_EQ(buffer.messages(), written - consumed);
+  return EXIT_SUCCESS;
+}
+
 template <typename T>
 static int test_copy_reader() {
   auto reader = std::make_unique<T>(128);
@@ -108,6 +200,324 @@ static int test_copy_reader_twice_capacity() {
   return EXIT_SUCCESS;
 }
 
+static int test_ring_buffer_wraparound() {
+  RingStreamBuffer buffer(1);
+  const size_t capacity = buffer.capacity();
+  uint8_t readdata[kDataLen];
+  const uint8_t *dst;
+  uint8_t *src;
+  size_t wbytes, pbytes;
+
+  ASSERT_TRUE(capacity > kDataLen);
+  ASSERT_EQ(buffer.provide(&src, 0, &pbytes), OK);
+  ASSERT_EQ(pbytes, capacity);
+  ASSERT_EQ(buffer.extend(capacity - 4), capacity - 4);
+  ASSERT_EQ(buffer.consume(capacity - 4), capacity - 4);
+  ASSERT_EQ(buffer.recoverable(), capacity - 4);
+
+  // the write wraps around the end of the region, and
+  // it can still be peeked as a single span
+  ASSERT_EQ(buffer.write(data, kDataLen, &wbytes), OK);
+  ASSERT_EQ(wbytes, kDataLen);
+  ASSERT_EQ(buffer.peek(&dst, 0, &pbytes), OK);
+  ASSERT_EQ(pbytes, kDataLen);
+  ASSERT_MEM_EQ(dst, data, kDataLen);
+
+  // the bytes that were overwritten cannot be recovered
+  ASSERT_EQ(buffer.recoverable(), capacity - kDataLen);
+  ASSERT_EQ(buffer.writable(), capacity - kDataLen);
+
+  ASSERT_EQ(buffer.read(readdata, kDataLen, &wbytes), OK);
+  ASSERT_EQ(wbytes, kDataLen);
+  ASSERT_MEM_EQ(readdata, data, kDataLen);
+  ASSERT_EQ(buffer.recover(kDataLen), kDataLen);
+  ASSERT_EQ(buffer.readable(), kDataLen);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_buffer_pool_reuse() {
+  size_t capacity, other_capacity;
+
+  uint8_t *chunk = BufferPool::acquire(100, &capacity);
+  ASSERT_TRUE(chunk != nullptr);
+  ASSERT_EQ(capacity, 128);
+  const uintptr_t misalignment = reinterpret_cast<uintptr_t>(chunk) & 127;
+  ASSERT_EQ(misalignment, 0);
+
+  // released chunks are handed out again by the same thread
+  BufferPool::release(chunk, capacity);
+  ASSERT_TRUE(BufferPool::acquire(128, &other_capacity) == chunk);
+  ASSERT_EQ(other_capacity, capacity);
+
+  // chunks can be released from other threads
+  std::thread thread([chunk, capacity]() {
+    BufferPool::release(chunk, capacity);
+  });
+  thread.join();
+
+  uint8_t *large = BufferPool::acquire(BufferPool::MAX_CHUNK_SIZE + 1,
+                                       &capacity);
+  ASSERT_TRUE(large != nullptr);
+  ASSERT_EQ(capacity, BufferPool::MAX_CHUNK_SIZE + 1);
+  BufferPool::release(large, capacity);
+
+  return EXIT_SUCCESS;
+}
+
+/// LateRelease releases a chunk when the thread exits,
+/// after the cache of the thread has been destroyed
+struct LateRelease final {
+  ~LateRelease() {
+    if (chunk != nullptr) {
+      BufferPool::release(chunk, capacity);
+    }
+  }
+
+  uint8_t *chunk = nullptr;
+  size_t capacity = 0;
+};
+
+static int test_buffer_pool_release_after_exit() {
+  uint8_t *released = nullptr;
+
+  // thread_local objects are destroyed in the reverse order of
+  // their construction, so the cache is destroyed first
+  std::thread thread([&released]() {
+    static thread_local LateRelease late;
+    late.chunk = BufferPool::acquire(BufferPool::MAX_CHUNK_SIZE,
+                                     &late.capacity);
+    released = late.chunk;
+  });
+  thread.join();
+  ASSERT_TRUE(released != nullptr);
+
+  // the chunk went back to the depot, where
+  // the cache of a new thread picks it up
+  uint8_t *acquired = nullptr;
+  std::thread other([&acquired]() {
+    size_t capacity;
+    acquired = BufferPool::acquire(BufferPool::MAX_CHUNK_SIZE, &capacity);
+    BufferPool::release(acquired, capacity);
+  });
+  other.join();
+  ASSERT_TRUE(acquired == released);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_buffer_pool_buffers() {
+  ASSERT_EQ(BufferPool::reserve(64 << 10, 4), 32);
+
+  for (int i = 0; i < 64; i++) {
+    auto stream = BufferPool::make_stream_buffer(64 << 10);
+    auto msg = BufferPool::make_msg_buffer(kDataLen);
+    size_t wbytes, rbytes;
+    uint8_t readdata[kDataLen];
+
+    ASSERT_EQ(stream->capacity(), 64 << 10);
+    ASSERT_EQ(stream->write(data, kDataLen, &wbytes), OK);
+    ASSERT_EQ(wbytes, kDataLen);
+    ASSERT_EQ(msg->write(data, kDataLen, &wbytes), OK);
+    ASSERT_EQ(wbytes, kDataLen);
+    ASSERT_EQ(msg->read(readdata, kDataLen, &rbytes), OK);
+    ASSERT_EQ(rbytes, kDataLen);
+    ASSERT_MEM_EQ(readdata, data, kDataLen);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// GatherSink keeps the bytes written to it and
+/// counts the calls to write_v
+class GatherSink final : public Sink {
+ public:
+  GatherSink(StreamBuffer *buffer, size_t *calls):
+      m_buffer(buffer),
+      m_calls(calls) { }
+
+  Status write(const uint8_t *src,
+               size_t len,
+               size_t *wbytes) noexcept override {
+    return m_buffer->write(src, len, wbytes);
+  }
+
+  Status write_v(const struct iovec *iov,
+                 size_t iovcnt,
+                 size_t *wbytes) noexcept override {
+    (*m_calls)++;
+    return Sink::write_v(iov, iovcnt, wbytes);
+  }
+
+ private:
+  StreamBuffer *m_buffer;
+  size_t *m_calls;
+};
+
+static int test_buffered_writer_write_v() {
+  StreamBuffer output(128);
+  size_t calls = 0;
+  BufferedWriter writer(std::make_unique<GatherSink>(&output, &calls),
+                        std::make_unique<StreamBuffer>(16));
+  const uint8_t header[] = "head";
+  const uint8_t payload[] = "some content some content";
+  const uint8_t trailer[] = "tail";
+  uint8_t readdata[64];
+  size_t wbytes, rbytes;
+
+  ASSERT_EQ(writer.write(header, 4, &wbytes), OK);
+  ASSERT_EQ(wbytes, 4);
+  ASSERT_EQ(calls, 0);
+
+  struct iovec iov[2];
+  iov[0].iov_base = const_cast<uint8_t*>(payload);
+  iov[0].iov_len = 25;
+  iov[1].iov_base = const_cast<uint8_t*>(trailer);
+  iov[1].iov_len = 4;
+
+  // the buffered header, the payload and the trailer
+  // are handed to the sink with a single call
+  ASSERT_EQ(writer.write_v(iov, 2, &wbytes), OK);
+  ASSERT_EQ(wbytes, 29);
+  ASSERT_EQ(calls, 1);
+
+  ASSERT_EQ(output.read(readdata, sizeof(readdata), &rbytes), OK);
+  ASSERT_EQ(rbytes, 33);
+  ASSERT_MEM_EQ(readdata, header, 4);
+  ASSERT_MEM_EQ(readdata + 4, payload, 25);
+  ASSERT_MEM_EQ(readdata + 29, trailer, 4);
+
+  // regions that fit in the buffer are buffered
+  ASSERT_EQ(writer.write_v(iov + 1, 1, &wbytes), OK);
+  ASSERT_EQ(wbytes, 4);
+  ASSERT_EQ(calls, 1);
+
+  return EXIT_SUCCESS;
+}
+
+/// BlockSink writes like a file opened with O_DIRECT, it only
+/// takes aligned memory and only counts whole blocks as written
+class BlockSink final : public Sink {
+ public:
+  static constexpr size_t BLOCK_SIZE = 64;
+
+  BlockSink(std::string *file, size_t *misaligned):
+      m_file(file),
+      m_misaligned(misaligned),
+      m_offset(0) { }
+
+  Status write(const uint8_t *src,
+               size_t len,
+               size_t *wbytes) noexcept override {
+    if (reinterpret_cast<uintptr_t>(src) / BLOCK_SIZE * BLOCK_SIZE !=
+        reinterpret_cast<uintptr_t>(src)) {
+      (*m_misaligned)++;
+    }
+
+    const size_t blocks = len / BLOCK_SIZE * BLOCK_SIZE;
+    m_file->resize(m_offset);
+    m_file->append(reinterpret_cast<const char*>(src), len);
+    m_offset += blocks;
+    *wbytes = blocks;
+    return OK;
+  }
+
+ private:
+  std::string *m_file;
+  size_t *m_misaligned;
+  size_t m_offset;
+};
+
+static int test_buffered_writer_blocks() {
+  std::string file, expected;
+  size_t misaligned = 0;
+  size_t wbytes, fbytes;
+  char record[48];
+
+  BufferedWriter writer(std::make_unique<BlockSink>(&file, &misaligned),
+                        BufferPool::make_stream_buffer(256),
+                        BlockSink::BLOCK_SIZE);
+
+  for (int i = 0; i < 20; i++) {
+    memset(record, 'a' + i, sizeof(record));
+    ASSERT_EQ(writer.write(reinterpret_cast<const uint8_t*>(record),
+                           sizeof(record), &wbytes), OK);
+    ASSERT_EQ(wbytes, sizeof(record));
+    expected.append(record, sizeof(record));
+
+    // the tail is written and then written again with
+    // the records that follow it
+    if (i == 6 || i == 7) {
+      ASSERT_EQ(writer.flush(&fbytes), OK);
+      ASSERT_EQ(file.size(), expected.size());
+      ASSERT_EQ(file.compare(expected), 0);
+
+      // only the whole blocks the sink took count as flushed
+      ASSERT_EQ(fbytes / BlockSink::BLOCK_SIZE * BlockSink::BLOCK_SIZE,
+                fbytes);
+    }
+  }
+
+  // the bytes written so far are whole blocks, the
+  // rest are still in the buffer
+  ASSERT_EQ(file.size() / BlockSink::BLOCK_SIZE * BlockSink::BLOCK_SIZE,
+            file.size());
+  ASSERT_EQ(writer.flush(&fbytes), OK);
+  ASSERT_EQ(file.compare(expected), 0);
+  ASSERT_EQ(misaligned, 0);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_dispose_func() {
+  size_t calls = 0;
+
+  {
+    DisposeFunc::Function function = [&calls](uint8_t *ptr) {
+      calls++;
+      delete [] ptr;
+    };
+    MsgBuffer buffer(new uint8_t[16], 16, function);
+    MsgBuffer moved(std::move(buffer));
+  }
+
+  // the disposal runs once, from the buffer that owns the memory
+  ASSERT_EQ(calls, 1);
+
+  {
+    // lambdas are taken as they are, with or without captures
+    MsgBuffer buffer(new uint8_t[16], 16, [&calls](uint8_t *ptr) {
+      calls++;
+      delete [] ptr;
+    });
+    StreamBuffer other(new uint8_t[16], 16, [](uint8_t *ptr) {
+      delete [] ptr;
+    });
+    DisposeFunc dispose_func([](uint8_t *ptr) {
+      delete [] ptr;
+    });
+    dispose_func(new uint8_t[16]);
+  }
+
+  ASSERT_EQ(calls, 2);
+
+  {
+    size_t capacity;
+    uint8_t *chunk = BufferPool::acquire(128, &capacity);
+    ASSERT_TRUE(chunk != nullptr);
+    StreamBuffer buffer(chunk, capacity, DisposeFunc::pool(capacity));
+  }
+
+  // the chunk went back to the pool of this thread
+  size_t capacity;
+  uint8_t *chunk = BufferPool::acquire(128, &capacity);
+  ASSERT_TRUE(chunk != nullptr);
+  BufferPool::release(chunk, capacity);
+
+  ASSERT_TRUE(sizeof(DisposeFunc) <= 2 * sizeof(void*));
+  return EXIT_SUCCESS;
+}
+
 template <typename T>
 static int bench_copy(int n) {
   size_t capacity = 128;
@@ -139,10 +549,23 @@ int main(int argc, char *argv[]) {
   TEST_RUN(ctx, test_read_write_too_much_stream());
   TEST_RUN(ctx, test_read_write<MsgBuffer>());
   TEST_RUN(ctx, test_read_write_too_much_message());
+  TEST_RUN(ctx, test_msg_buffer_messages(false));
+  TEST_RUN(ctx, test_msg_buffer_messages(true));
+  TEST_RUN(ctx, test_msg_buffer_index_ring());
   TEST_RUN(ctx, test_copy_reader<StreamBuffer>());
   TEST_RUN(ctx, test_copy_reader<MsgBuffer>());
   TEST_RUN(ctx, test_copy_reader_twice_capacity<StreamBuffer>());
   TEST_RUN(ctx, test_copy_reader_twice_capacity<MsgBuffer>());
+  TEST_RUN(ctx, test_read_write<RingStreamBuffer>());
+  TEST_RUN(ctx, test_copy_reader<RingStreamBuffer>());
+  TEST_RUN(ctx, test_copy_reader_twice_capacity<RingStreamBuffer>());
+  TEST_RUN(ctx, test_ring_buffer_wraparound());
+  TEST_RUN(ctx, test_buffer_pool_reuse());
+  TEST_RUN(ctx, test_buffer_pool_release_after_exit());
+  TEST_RUN(ctx, test_buffer_pool_buffers());
+  TEST_RUN(ctx, test_buffered_writer_write_v());
+  TEST_RUN(ctx, test_buffered_writer_blocks());
+  TEST_RUN(ctx, test_dispose_func());
   BENCH_RUN(ctx, bench_copy<StreamBuffer>);
   BENCH_RUN(ctx, bench_copy<MsgBuffer>);
 
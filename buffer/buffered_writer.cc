@@ -3,6 +3,11 @@
 #include "buffered_writer.hpp"
 
 #include "io/copy.hpp"
+#include "io/iovec.hpp"
+
+#include <string.h>
+
+#include <algorithm>
 
 static inline Status flush_buffer(
     Sink *sink,
@@ -15,40 +20,191 @@ Status BufferedWriter::write(
     const uint8_t *source,
     const size_t len,
     size_t *wbytes) noexcept {
+  struct iovec iov;
+  iov.iov_base = const_cast<uint8_t*>(source);
+  iov.iov_len = len;
+  return write_v(&iov, 1, wbytes);
+}
+
+Status BufferedWriter::write_v(
+    const struct iovec *iov,
+    size_t iovcnt,
+    size_t *wbytes) noexcept {
+  if (m_block_size > 0) {
+    return write_v_blocks(iov, iovcnt, wbytes);
+  }
+
+  IovCursor cursor(iov, iovcnt);
+  size_t remaining = IovCursor::total(iov, iovcnt);
   Status status = OK;
   size_t bbytes;
-  size_t remaining = len;
+  int count;
 
   *wbytes = 0;
 
-  while (remaining > 0) {
-    if (m_buffer->writable() < remaining) {
-      status = flush_buffer(m_sink.get(), m_buffer.get());
+  // a payload that does not fit in the buffer is written to the
+  // sink together with the buffered bytes in a single gathered
+  // write, instead of being staged in the buffer first
+  while (remaining > m_buffer->writable()) {
+    struct iovec gather[IovCursor::BATCH + 1];
+    const uint8_t *buffered = nullptr;
+    size_t pbytes = 0;
+    size_t written;
+    int len = 0;
+
+    if (m_buffer->readable() > 0) {
+      status = m_buffer->peek(&buffered, 0, &pbytes);
       if (status->error()) {
         return status;
       }
     }
 
-    status = m_buffer->write(source, remaining, &bbytes);
+    if (pbytes > 0) {
+      gather[len].iov_base = const_cast<uint8_t*>(buffered);
+      gather[len].iov_len = pbytes;
+      len++;
+    }
+
+    const struct iovec *batch = cursor.batch(&count);
+    for (int i = 0; i < count; i++) {
+      gather[len++] = batch[i];
+    }
+
+    status = m_sink->write_v(gather, len, &written);
     if (status->error()) {
       return status;
     }
 
-    source += bbytes;
-    remaining -= bbytes;
+    const size_t flushed = m_buffer->consume(std::min(written, pbytes));
+    cursor.advance(written - flushed);
+    remaining -= written - flushed;
+    *wbytes += written - flushed;
+
+    if (written == 0) {
+      break;
+    }
+  }
+
+  // what remains fits in the buffer, or the sink
+  // cannot take more bytes for now
+  while (!cursor.done()) {
+    const struct iovec *batch = cursor.batch(&count);
+    status = m_buffer->write(static_cast<const uint8_t*>(batch[0].iov_base),
+                             batch[0].iov_len, &bbytes);
+    if (status->error() || bbytes == 0) {
+      return status;
+    }
+
+    cursor.advance(bbytes);
     *wbytes += bbytes;
   }
 
   return status;
 }
 
+Status BufferedWriter::write_v_blocks(
+    const struct iovec *iov,
+    size_t iovcnt,
+    size_t *wbytes) noexcept {
+  IovCursor cursor(iov, iovcnt);
+  Status status = OK;
+  size_t bbytes, fbytes;
+  int count;
+
+  *wbytes = 0;
+
+  while (!cursor.done()) {
+    const struct iovec *batch = cursor.batch(&count);
+    status = m_buffer->write(static_cast<const uint8_t*>(batch[0].iov_base),
+                             batch[0].iov_len, &bbytes);
+    if (status->error()) {
+      return status;
+    }
+
+    cursor.advance(bbytes);
+    *wbytes += bbytes;
+
+    // the buffer is full, make room by writing its whole
+    // blocks, unless the sink cannot take any for now
+    if (!cursor.done() && m_buffer->writable() == 0) {
+      status = write_blocks(&fbytes);
+      if (status->error() || fbytes == 0) {
+        return status;
+      }
+    }
+  }
+
+  return status;
+}
+
+Status BufferedWriter::write_blocks(size_t *fbytes) noexcept {
+  const size_t blocks = m_buffer->readable() / m_block_size * m_block_size;
+  const uint8_t *buffered;
+  size_t pbytes;
+
+  *fbytes = 0;
+  if (blocks == 0) {
+    return OK;
+  }
+
+  Status status = m_buffer->peek(&buffered, blocks, &pbytes);
+  if (status->error()) {
+    return status;
+  }
+
+  status = m_sink->write(buffered, blocks, fbytes);
+  m_buffer->consume(*fbytes);
+  return status;
+}
+
+Status BufferedWriter::write_tail(size_t *fbytes) noexcept {
+  const size_t tail = m_buffer->readable();
+  const uint8_t *buffered;
+  uint8_t *padding;
+  size_t pbytes, wbytes;
+
+  *fbytes = 0;
+  if (tail == 0) {
+    return OK;
+  }
+
+  // providing the whole buffer compacts it, which moves
+  // the tail to the start of the buffer memory
+  Status status = m_buffer->provide(&padding, 0, &pbytes);
+  if (status->error()) {
+    return status;
+  }
+
+  const size_t padded = (tail + m_block_size - 1) / m_block_size * m_block_size;
+  memset(padding, 0, std::min(padded - tail, pbytes));
+
+  status = m_buffer->peek(&buffered, tail, &pbytes);
+  if (status->error()) {
+    return status;
+  }
+
+  status = m_sink->write(buffered, tail, &wbytes);
+  if (status->error()) {
+    return status;
+  }
+
+  // a sink that counts the tail as written does not need it
+  // again. Otherwise it stays buffered and is not reported
+  m_buffer->consume(wbytes);
+  *fbytes = wbytes;
+  return OK;
+}
+
 Status BufferedWriter::provide(
     uint8_t **source,
     size_t intent,
     size_t *pbytes) noexcept {
   if (m_buffer->writable() == 0 ||
       m_buffer->writable() < intent) {
-    auto status = flush_buffer(m_sink.get(), m_buffer.get());
+    size_t fbytes;
+    auto status = m_block_size > 0 ?
+        write_blocks(&fbytes) :
+        flush_buffer(m_sink.get(), m_buffer.get());
     if (status->error()) {
       return status;
     }
@@ -62,6 +218,18 @@ size_t BufferedWriter::extend(size_t length) noexcept {
 }
 
 Status BufferedWriter::flush(size_t *fbytes) noexcept {
-  return copy(m_buffer.get(), m_sink.get(), fbytes);
+  if (m_block_size == 0) {
+    return copy(m_buffer.get(), m_sink.get(), fbytes);
+  }
+
+  size_t tbytes;
+  Status status = write_blocks(fbytes);
+  if (status->error() || m_buffer->readable() >= m_block_size) {
+    return status;
+  }
+
+  status = write_tail(&tbytes);
+  *fbytes += tbytes;
+  return status;
 }
 
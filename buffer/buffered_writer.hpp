@@ -10,17 +10,34 @@
 #include "io/sink.hpp"
 #include "io/flusher_writer.hpp"
 
+/// BufferedWriter stages writes in a buffer before they
+/// reach the sink.
+///
+/// With a `block_size`, the writer only hands whole blocks to the
+/// sink, each one starting at a block boundary of the buffer, for
+/// sinks that write past the page cache, like a FileStream opened
+/// with `open_direct`. The memory of the buffer must then be aligned
+/// to the block size, and its capacity a multiple of it, which is
+/// the case for the buffers of the BufferPool with a capacity of at
+/// least a block. Payloads are always staged in the buffer. A flush
+/// writes the unaligned tail too, padded with zeros to a block. The
+/// sink does not count the tail as written, so the writer keeps it,
+/// leaves it out of the flushed bytes, and writes it again with the
+/// bytes that follow it
 class BufferedWriter final : public FlusherWriter {
  public:
   BufferedWriter(std::unique_ptr<Sink> &&sink,
-                 std::unique_ptr<Buffer> &&buffer):
+                 std::unique_ptr<Buffer> &&buffer,
+                 size_t block_size = 0):
       m_sink(std::move(sink)),
-      m_buffer(std::move(buffer)) { }
+      m_buffer(std::move(buffer)),
+      m_block_size(block_size) { }
 
   BufferedWriter(const BufferedWriter &writer) = delete;
   BufferedWriter(BufferedWriter &&writer):
       m_sink(std::move(writer.m_sink)),
-      m_buffer(std::move(writer.m_buffer)) { }
+      m_buffer(std::move(writer.m_buffer)),
+      m_block_size(writer.m_block_size) { }
 
   BufferedWriter& operator=(const BufferedWriter &writer) = delete;
   BufferedWriter& operator=(const BufferedWriter && writer) = delete;
@@ -28,6 +45,14 @@ class BufferedWriter final : public FlusherWriter {
   Status write(const uint8_t *source,
                  size_t length,
                  size_t *wbytes) noexcept override;
+
+  /// write_v buffers the regions if they fit in the buffer.
+  /// Otherwise the buffered bytes and the regions are written
+  /// to the sink with a single call to `Sink::write_v`, so that
+  /// large payloads are not copied into the buffer
+  Status write_v(const struct iovec *iov,
+                 size_t iovcnt,
+                 size_t *wbytes) noexcept override;
   Status provide(uint8_t **source,
                    size_t intent,
                    size_t *pbytes) noexcept override;
@@ -35,8 +60,21 @@ class BufferedWriter final : public FlusherWriter {
   Status flush(size_t *fbytes) noexcept override;
 
  private:
+  /// write_blocks writes the whole blocks in the buffer to the sink
+  Status write_blocks(size_t *fbytes) noexcept;
+
+  /// write_tail writes the bytes after the last whole block of the
+  /// buffer to the sink, padded with zeros to a whole block
+  Status write_tail(size_t *fbytes) noexcept;
+
+  /// write_v_blocks is write_v with a block size
+  Status write_v_blocks(const struct iovec *iov,
+                        size_t iovcnt,
+                        size_t *wbytes) noexcept;
+
   std::unique_ptr<Sink> m_sink;
   std::unique_ptr<Buffer> m_buffer;
+  size_t m_block_size;
 };
 
 #endif  // IO_BUFFEREDWRITER_H_
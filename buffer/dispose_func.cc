@@ -0,0 +1,34 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "dispose_func.hpp"
+
+#include <sys/mman.h>
+
+#include "buffer_pool.hpp"
+
+void DisposeFunc::dispose(uint8_t *ptr) const noexcept {
+  switch (m_kind) {
+    case Kind::array_delete:
+      delete [] ptr;
+      break;
+
+    case Kind::nothing:
+      break;
+
+    case Kind::pool:
+      BufferPool::release(ptr, m_arg);
+      break;
+
+    case Kind::unmap:
+      munmap(ptr, m_arg);
+      break;
+
+    case Kind::func:
+      m_func(ptr);
+      break;
+
+    case Kind::function:
+      (*m_function)(ptr);
+      break;
+  }
+}
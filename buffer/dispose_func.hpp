@@ -3,9 +3,12 @@
 #ifndef IO_DISPOSEFUNC_H_
 #define IO_DISPOSEFUNC_H_
 
-#include <functional>
+#include <stddef.h>
+#include <stdint.h>
 
-using DisposeFunc = std::function<void(uint8_t*)>;
+#include <functional>
+#include <type_traits>
+#include <utility>
 
 extern inline void array_delete_dispose_func(uint8_t *ptr) {
   delete [] ptr;
@@ -15,4 +18,156 @@ extern inline void do_nothing_delete_dispose_func(uint8_t *ptr) {
   (void)(ptr);
 }
 
+/// DisposeFunc releases the memory of a buffer. It is a tagged
+/// disposer rather than a std::function: the common policies
+/// (delete [], nothing, give back to the BufferPool and munmap)
+/// are selected by a tag and need no allocation, and the first
+/// two are inlined in the destructor of the buffer. Any other
+/// callable is type erased on the heap, for callers that need
+/// custom disposal. A DisposeFunc takes 16 bytes
+class DisposeFunc final {
+ public:
+  using Func = void (*)(uint8_t*);
+  using Function = std::function<void(uint8_t*)>;
+
+  /// array_delete disposes memory allocated with new []
+  static inline DisposeFunc array_delete() noexcept {
+    return DisposeFunc(Kind::array_delete, 0);
+  }
+
+  /// nothing leaves the memory untouched, for
+  /// memory owned by someone else
+  static inline DisposeFunc nothing() noexcept {
+    return DisposeFunc(Kind::nothing, 0);
+  }
+
+  /// pool gives a chunk of `capacity` bytes back to the BufferPool
+  static inline DisposeFunc pool(size_t capacity) noexcept {
+    return DisposeFunc(Kind::pool, capacity);
+  }
+
+  /// unmap unmaps `len` bytes mapped with mmap
+  static inline DisposeFunc unmap(size_t len) noexcept {
+    return DisposeFunc(Kind::unmap, len);
+  }
+
+  DisposeFunc() noexcept:
+      DisposeFunc(Kind::array_delete, 0) { }
+
+  /// the two disposal functions above map to their policies,
+  /// so that callers that pass them keep the inlined disposal
+  DisposeFunc(Func func) noexcept:  // NOLINT(runtime/explicit)
+      m_kind(func == array_delete_dispose_func ? Kind::array_delete :
+             func == do_nothing_delete_dispose_func ||
+             func == nullptr ? Kind::nothing : Kind::func) {
+    m_func = func;
+  }
+
+  /// any other callable. Captureless lambdas convert to Func and
+  /// are stored as such, the rest are type erased in a Function
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<F>::type, DisposeFunc>::value>::type>
+  DisposeFunc(F &&function):  // NOLINT(runtime/explicit)
+      DisposeFunc(std::forward<F>(function),
+                  std::is_convertible<F, Func>()) { }
+
+  DisposeFunc(const DisposeFunc &dispose_func):
+      m_kind(dispose_func.m_kind) {
+    m_arg = dispose_func.m_arg;
+    if (m_kind == Kind::function) {
+      m_function = new Function(*dispose_func.m_function);
+    }
+  }
+
+  DisposeFunc(DisposeFunc &&dispose_func) noexcept:
+      m_kind(dispose_func.m_kind) {
+    m_arg = dispose_func.m_arg;
+    dispose_func.m_kind = Kind::nothing;
+  }
+
+  DisposeFunc& operator=(const DisposeFunc &dispose_func) {
+    if (this != &dispose_func) {
+      DisposeFunc copy(dispose_func);
+      *this = std::move(copy);
+    }
+
+    return *this;
+  }
+
+  DisposeFunc& operator=(DisposeFunc &&dispose_func) noexcept {
+    if (this != &dispose_func) {
+      reset();
+      m_kind = dispose_func.m_kind;
+      m_arg = dispose_func.m_arg;
+      dispose_func.m_kind = Kind::nothing;
+    }
+
+    return *this;
+  }
+
+  ~DisposeFunc() {
+    reset();
+  }
+
+  inline void operator()(uint8_t *ptr) const noexcept {
+    switch (m_kind) {
+      case Kind::array_delete:
+        delete [] ptr;
+        return;
+
+      case Kind::nothing:
+        return;
+
+      default:
+        dispose(ptr);
+        return;
+    }
+  }
+
+ private:
+  enum class Kind : uint8_t {
+    array_delete,
+    nothing,
+    pool,
+    unmap,
+    func,
+    function
+  };
+
+  DisposeFunc(Kind kind, size_t arg) noexcept:
+      m_kind(kind) {
+    m_arg = arg;
+  }
+
+  template <typename F>
+  DisposeFunc(F &&function, std::true_type) noexcept:
+      DisposeFunc(static_cast<Func>(function)) { }
+
+  template <typename F>
+  DisposeFunc(F &&function, std::false_type):
+      m_kind(Kind::function) {
+    m_function = new Function(std::forward<F>(function));
+  }
+
+  inline void reset() noexcept {
+    if (m_kind == Kind::function) {
+      delete m_function;
+      m_kind = Kind::nothing;
+    }
+  }
+
+  /// dispose handles the policies that are not inlined
+  void dispose(uint8_t *ptr) const noexcept;
+
+  Kind m_kind;
+  union {
+    size_t m_arg;
+    Func m_func;
+    Function *m_function;
+  };
+};
+
+static_assert(sizeof(DisposeFunc) <= 16, "DisposeFunc should take 16 bytes");
+
 #endif  // IO_DISPOSEFUNC_H_
@@ -1,34 +1,60 @@
 #include "msg_buffer.hpp"
 
-size_t MsgBuffer::compactable() const noexcept {
-  size_t compactable = 0;
-  const uint8_t *offset = m_mem;
+/// kIndexedMessageSize is the message size the index
+/// of a buffer is initially sized for
+static const size_t kIndexedMessageSize = 64;
 
-  while (offset < m_woffset) {
-    size_t len = rmsgsize(offset);
-    offset += len + m_header_size;
-    compactable += len + m_header_size;
+void MsgBuffer::MsgIndex::grow(size_t messages) {
+  const size_t slots = (mask + 1) << 1;
+  std::unique_ptr<uint64_t[]> grown(new uint64_t[slots]);
+
+  for (size_t k = 0; k < messages; k++) {
+    grown[k] = end(k);
   }
 
-  return compactable;
+  ends = std::move(grown);
+  mask = slots - 1;
+  first = 0;
 }
 
 size_t MsgBuffer::compact() noexcept {
-  if (m_mem == m_roffset) {
+  size_t compactable = this->compactable();
+  if (compactable == 0) {
     return 0;
+  }
 
-  } else {
-    size_t compactable = this->compactable();
-    size_t readable = this->readable();
+  size_t pending = m_woffset - m_roffset;
+  if (pending > 0) {
+    memmove(m_mem, m_roffset, pending);
+  }
 
-    if (readable > 0) {
-      memmove(m_mem, m_roffset, readable);
-    }
+  m_base += compactable;
+  m_roffset = m_mem;
+  m_woffset = m_mem + pending;
+
+  return compactable;
+}
+
+void MsgBuffer::index() {
+  if (m_index) {
+    return;
+  }
+
+  // the ring is sized for a buffer full of messages of
+  // kIndexedMessageSize bytes, so that extend seldom grows it
+  const size_t expected = std::max<size_t>(
+      m_messages, m_capacity / (m_header_size + kIndexedMessageSize));
+  size_t slots = 16;
+  while (slots < expected) {
+    slots <<= 1;
+  }
 
-    m_roffset = m_mem;
-    m_woffset = readable + m_roffset;
+  m_index = std::make_unique<MsgIndex>(slots);
 
-    return compactable;
+  const uint8_t *offset = m_roffset;
+  for (size_t i = 0; i < m_messages; i++) {
+    offset += rmsgsize(offset) + m_header_size;
+    m_index->push(i, position(offset));
   }
 }
 
@@ -36,6 +62,13 @@ size_t MsgBuffer::extend(const size_t len) noexcept {
   if (len <= writable()) {
     wmsgsize(m_woffset, len);
     m_woffset += len + m_header_size;
+
+    if (m_index) {
+      m_index->push(m_messages, position(m_woffset));
+    }
+
+    m_messages++;
+
     return len;
 
   } else {
@@ -75,21 +108,72 @@ Status MsgBuffer::write(const uint8_t *src, const size_t len, size_t *wbytes) no
 }
 
 size_t MsgBuffer::consume(const size_t len) noexcept {
+  if (m_index) {
+    // the bytes taken by the first n messages grow with n,
+    // so the number of messages that fit in len is searched
+    const MsgIndex &index = *m_index;
+    const uint64_t start = position(m_roffset);
+    auto consumable = [&](size_t n) -> uint64_t {
+      return index.end(n - 1) - start - n * m_header_size;
+    };
+
+    size_t lo = 0, hi = m_messages;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo + 1) / 2;
+      if (consumable(mid) <= len) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+
+    if (lo == 0) {
+      return 0;
+    }
+
+    size_t consumed = consumable(lo);
+    m_roffset = pointer(index.end(lo - 1));
+    m_index->advance(lo);
+    m_messages -= lo;
+    return consumed;
+  }
+
   size_t consumed = 0;
 
-  for (;;) {
-    size_t consumable = readable();
-    if (consumable == 0 || consumed + consumable > len) {
-      return consumed;
+  while (m_messages > 0) {
+    size_t consumable = rmsgsize(m_roffset);
+    if (consumed + consumable > len) {
+      break;
     }
 
     m_roffset += consumable + m_header_size;
+    m_messages--;
     consumed += consumable;
   }
 
   return consumed;
 }
 
+size_t MsgBuffer::consume_messages(const size_t count) noexcept {
+  const size_t consumed = std::min(count, m_messages);
+  if (consumed == 0) {
+    return 0;
+  }
+
+  if (m_index) {
+    m_roffset = pointer(m_index->end(consumed - 1));
+    m_index->advance(consumed);
+
+  } else {
+    for (size_t i = 0; i < consumed; i++) {
+      m_roffset += rmsgsize(m_roffset) + m_header_size;
+    }
+  }
+
+  m_messages -= consumed;
+  return consumed;
+}
+
 Status MsgBuffer::peek(const uint8_t **dst,
                        const size_t intent,
                        size_t *pbytes) noexcept {
@@ -100,6 +184,30 @@ Status MsgBuffer::peek(const uint8_t **dst,
   return OK;
 }
 
+Status MsgBuffer::peek_message(const size_t k,
+                               const uint8_t **dst,
+                               size_t *pbytes) const noexcept {
+  if (k >= m_messages) {
+    *dst = nullptr;
+    *pbytes = 0;
+    return OK;
+  }
+
+  const uint8_t *offset = m_roffset;
+  if (m_index && k > 0) {
+    offset = pointer(m_index->end(k - 1));
+
+  } else {
+    for (size_t i = 0; i < k; i++) {
+      offset += rmsgsize(offset) + m_header_size;
+    }
+  }
+
+  *dst = offset + m_header_size;
+  *pbytes = rmsgsize(offset);
+  return OK;
+}
+
 Status MsgBuffer::read(uint8_t *dst,
                        const size_t len,
                        size_t *rbytes) noexcept {
@@ -111,6 +219,11 @@ Status MsgBuffer::read(uint8_t *dst,
 
   memcpy(dst, m_roffset + m_header_size, readable);
   m_roffset += readable + m_header_size;
+  m_messages--;
+  if (m_index) {
+    m_index->advance(1);
+  }
+
   *rbytes = readable;
   return OK;
 }
@@ -4,6 +4,8 @@
 #define BUFFER_MSGBUFFER_H_
 
 #include <algorithm>
+#include <memory>
+#include <utility>
 
 #include "buffer.hpp"
 #include "dispose_func.hpp"
@@ -14,13 +16,18 @@
 /// messages has a size, and a message can only be written
 /// to the buffer if the buffer has enough capacity left.
 /// Likewise, a message can only be read from the buffer
-/// if a big enough array is provided to copy the buffer to
+/// if a big enough array is provided to copy the buffer to.
+///
+/// The buffer can optionally keep an index of the offsets of the
+/// messages it holds, which makes looking up any message and
+/// consuming many messages at once cheap, at the cost of 8 bytes
+/// per message held
 class MsgBuffer final : public Buffer {
  public:
   explicit MsgBuffer(size_t capacity):
       MsgBuffer(new uint8_t[capacity],
                 capacity,
-                array_delete_dispose_func) { }
+                DisposeFunc::array_delete()) { }
 
   MsgBuffer(uint8_t *mem,
             size_t capacity,
@@ -28,9 +35,11 @@ class MsgBuffer final : public Buffer {
       m_header_size(DEFAULT_HEADER_SIZE),
       m_capacity(capacity),
       m_mem(mem),
-      m_dispose_func(dispose_func),
+      m_dispose_func(std::move(dispose_func)),
       m_roffset(m_mem),
-      m_woffset(m_mem) { }
+      m_woffset(m_mem),
+      m_base(0),
+      m_messages(0) { }
 
   MsgBuffer(uint8_t header_size,
             uint8_t *mem,
@@ -39,9 +48,11 @@ class MsgBuffer final : public Buffer {
       m_header_size(header_size),
       m_capacity(capacity),
       m_mem(mem),
-      m_dispose_func(dispose_func),
+      m_dispose_func(std::move(dispose_func)),
       m_roffset(m_mem),
-      m_woffset(m_mem) { }
+      m_woffset(m_mem),
+      m_base(0),
+      m_messages(0) { }
 
   ~MsgBuffer() {
     if (m_mem) {
@@ -55,13 +66,17 @@ class MsgBuffer final : public Buffer {
     this->m_header_size = buffer.m_header_size;
     this->m_capacity = buffer.m_capacity;
     this->m_mem = buffer.m_mem;
-    this->m_dispose_func = buffer.m_dispose_func;
+    this->m_dispose_func = std::move(buffer.m_dispose_func);
     this->m_roffset = buffer.m_roffset;
     this->m_woffset = buffer.m_woffset;
+    this->m_base = buffer.m_base;
+    this->m_messages = buffer.m_messages;
+    this->m_index = std::move(buffer.m_index);
     buffer.m_mem = nullptr;
     buffer.m_capacity = 0;
     buffer.m_roffset = nullptr;
     buffer.m_woffset = nullptr;
+    buffer.m_messages = 0;
   }
 
   MsgBuffer& operator=(const MsgBuffer &buffer) = delete;
@@ -88,7 +103,37 @@ class MsgBuffer final : public Buffer {
   }
 
   /// return the number of bytes that can be made available for the buffer
-  size_t compactable() const noexcept;
+  inline size_t compactable() const noexcept {
+    return m_roffset - m_mem;
+  }
+
+  /// returns the number of messages that can be read
+  inline size_t messages() const noexcept {
+    return m_messages;
+  }
+
+  /// returns the size of the header that precedes each message.
+  /// The first bytes of a header hold the size of the message,
+  /// and the rest hold metadata about the message
+  inline size_t header_size() const noexcept {
+    return m_header_size;
+  }
+
+  /// returns the number of bytes of metadata of each header
+  inline size_t metadata_size() const noexcept {
+    return m_header_size > SIZE_LEN ? m_header_size - SIZE_LEN : 0;
+  }
+
+  /// metadata returns the metadata in the header of the message
+  /// at `msg`, as returned by `provide`, `peek` or `peek_message`
+  inline uint8_t *metadata(const uint8_t *msg) const noexcept {
+    return const_cast<uint8_t*>(msg) - metadata_size();
+  }
+
+  /// index makes the buffer keep the offsets of the messages it
+  /// holds, so that `peek_message` and `consume` do not need to
+  /// walk the headers of the messages
+  void index();
 
   /// frees unused space for the buffer
   size_t compact() noexcept;
@@ -98,24 +143,37 @@ class MsgBuffer final : public Buffer {
   Status write(const uint8_t *src, const size_t len, size_t *wbytes) noexcept override;
 
   size_t consume(const size_t len) noexcept override;
+
+  /// consume_messages consumes up to `count` messages, and
+  /// returns the number of messages consumed
+  size_t consume_messages(const size_t count) noexcept;
   Status peek(const uint8_t **dst,
               const size_t intent,
               size_t *pbytes) noexcept override;
+
+  /// peek_message sets `dst` to the message `k` positions after
+  /// the next message that can be read, and `pbytes` to its size.
+  /// It sets `pbytes` to 0 if the buffer holds no such message
+  Status peek_message(const size_t k,
+                      const uint8_t **dst,
+                      size_t *pbytes) const noexcept;
+
   Status read(uint8_t *dst,
               const size_t len,
               size_t *rbytes) noexcept override;
 
  private:
   static constexpr int DEFAULT_HEADER_SIZE = 4;
+  static constexpr int SIZE_LEN = 4;
 
   inline uint8_t* roffset() const {
-    return readable() < m_header_size
+    return m_messages == 0
                         ? m_roffset
                         : m_roffset + m_header_size;
   }
 
   inline uint8_t* woffset() const {
-    return writable() < m_header_size
+    return remaining() < m_header_size
                         ? m_woffset
                         : m_woffset + m_header_size;
   }
@@ -124,6 +182,16 @@ class MsgBuffer final : public Buffer {
     return m_capacity - (m_woffset - m_mem);
   }
 
+  /// position returns the position of `ptr` in the stream
+  /// of bytes written to the buffer since it was created
+  inline uint64_t position(const uint8_t *ptr) const {
+    return m_base + (ptr - m_mem);
+  }
+
+  inline uint8_t *pointer(uint64_t position) const {
+    return m_mem + (position - m_base);
+  }
+
   static inline uint32_t wmsgsize(uint8_t *ptr,
                                   const uint32_t len) noexcept {
     return writeu32(ptr, len) - ptr;
@@ -143,6 +211,45 @@ class MsgBuffer final : public Buffer {
 
   uint8_t *m_roffset;
   uint8_t *m_woffset;
+
+  uint64_t m_base;
+  size_t m_messages;
+
+  /// MsgIndex keeps the positions of the end of the messages held
+  /// in a ring, starting from the first message not yet consumed at
+  /// `first`. Positions do not change on compaction, and the ring
+  /// only grows when more messages are held than it has room for
+  struct MsgIndex final {
+    explicit MsgIndex(size_t slots):
+        ends(new uint64_t[slots]),
+        mask(slots - 1) { }
+
+    inline uint64_t end(size_t k) const noexcept {
+      return ends[(first + k) & mask];
+    }
+
+    inline void advance(size_t n) noexcept {
+      first = (first + n) & mask;
+    }
+
+    /// push records the end of a message, given the
+    /// number of messages the index already holds
+    inline void push(size_t messages, uint64_t position) {
+      if (messages > mask) {
+        grow(messages);
+      }
+
+      ends[(first + messages) & mask] = position;
+    }
+
+    void grow(size_t messages);
+
+    std::unique_ptr<uint64_t[]> ends;
+    size_t mask;
+    size_t first = 0;
+  };
+
+  std::unique_ptr<MsgIndex> m_index;
 };
 
 #endif  // BUFFER_MSGBUFFER_H_
@@ -0,0 +1,150 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "ring_stream_buffer.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+/// ring_fd returns an anonymous shared memory file of `size` bytes
+static int ring_fd(size_t size) {
+#ifdef __linux__
+  int fd = memfd_create("ring_stream_buffer", MFD_CLOEXEC);
+#else
+  char name[64];
+  snprintf(name, sizeof(name), "/ring_stream_buffer.%d.%p",
+           getpid(), static_cast<void*>(name));
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd > -1) {
+    shm_unlink(name);
+  }
+#endif
+
+  if (fd == -1) {
+    return -1;
+  }
+
+  if (ftruncate(fd, size) == -1) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+  }
+
+  return fd;
+}
+
+RingStreamBuffer::RingStreamBuffer(size_t capacity):
+    m_capacity(0),
+    m_mem(nullptr),
+    m_roffset(0),
+    m_woffset(0) {
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t size = std::max(page, (capacity + page - 1) / page * page);
+
+  int fd = ring_fd(size);
+  if (fd == -1) {
+    throw RingBufferException("failed to create ring buffer file", errno);
+  }
+
+  // the address range for both mappings is reserved first,
+  // so that the second mapping is right after the first one
+  void *mem = mmap(nullptr, size << 1, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    int err = errno;
+    close(fd);
+    throw RingBufferException("failed to reserve ring buffer memory", err);
+  }
+
+  uint8_t *base = static_cast<uint8_t*>(mem);
+  if (mmap(base, size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+      mmap(base + size, size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    int err = errno;
+    munmap(mem, size << 1);
+    close(fd);
+    throw RingBufferException("failed to map ring buffer memory", err);
+  }
+
+  // the mappings keep a reference to the file
+  close(fd);
+
+  m_capacity = size;
+  m_mem = base;
+}
+
+RingStreamBuffer::~RingStreamBuffer() {
+  if (m_mem) {
+    munmap(m_mem, m_capacity << 1);
+    m_mem = nullptr;
+  }
+}
+
+size_t RingStreamBuffer::extend(const size_t len) noexcept {
+  size_t extendable = std::min(len, writable());
+  m_woffset += extendable;
+  return extendable;
+}
+
+Status RingStreamBuffer::provide(uint8_t **src,
+                                 const size_t intent,
+                                 size_t *pbytes) noexcept {
+  (void)(intent);
+  *src = woffset();
+  *pbytes = writable();
+
+  return OK;
+}
+
+Status RingStreamBuffer::write(const uint8_t *src,
+                               const size_t len,
+                               size_t *wbytes) noexcept {
+  size_t copiable = std::min(writable(), len);
+  memcpy(woffset(), src, copiable);
+
+  *wbytes = copiable;
+  m_woffset += copiable;
+
+  return OK;
+}
+
+size_t RingStreamBuffer::recover(const size_t len) noexcept {
+  size_t recoverable = std::min(len, this->recoverable());
+  m_roffset -= recoverable;
+  return recoverable;
+}
+
+size_t RingStreamBuffer::consume(const size_t len) noexcept {
+  size_t consumable = std::min(len, readable());
+  m_roffset += consumable;
+  return consumable;
+}
+
+Status RingStreamBuffer::peek(const uint8_t **dst,
+                              const size_t intent,
+                              size_t *pbytes) noexcept {
+  (void)(intent);
+  *dst = roffset();
+  *pbytes = readable();
+
+  return OK;
+}
+
+Status RingStreamBuffer::read(uint8_t *dst,
+                              const size_t len,
+                              size_t *rbytes) noexcept {
+  size_t copiable = std::min(readable(), len);
+  memcpy(dst, roffset(), copiable);
+
+  m_roffset += copiable;
+  *rbytes = copiable;
+
+  return OK;
+}
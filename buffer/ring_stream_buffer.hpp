@@ -0,0 +1,155 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef BUFFER_RINGSTREAMBUFFER_H_
+#define BUFFER_RINGSTREAMBUFFER_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "buffer.hpp"
+#include "io/recoverer.hpp"
+
+class RingBufferException final {
+ public:
+  RingBufferException(const char *msg, int err):
+      m_msg(msg),
+      m_err(err){ }
+
+  inline const char *msg() const noexcept {
+    return m_msg;
+  }
+
+  inline int err() const noexcept {
+    return m_err;
+  }
+
+ private:
+  const char *m_msg;
+  const int m_err;
+};
+
+/// RingStreamBuffer is a StreamBuffer on a circular region of
+/// memory. The region is mapped twice, back to back, in the
+/// address space, so that the bytes past its end are the bytes
+/// at its start. `peek` and `provide` always return contiguous
+/// spans of all the readable and writable bytes, and the buffer
+/// never moves its contents to make room for new bytes.
+///
+/// The read and write offsets grow monotonically, and they
+/// are only reduced modulo the capacity to address memory.
+/// Consumed bytes can be recovered until they are overwritten.
+/// The capacity is rounded up to a multiple of the page size
+class RingStreamBuffer final : public Buffer {
+ public:
+  explicit RingStreamBuffer(size_t capacity);
+  ~RingStreamBuffer();
+
+  RingStreamBuffer(const RingStreamBuffer &buffer) = delete;
+  RingStreamBuffer(RingStreamBuffer &&buffer) {
+    this->m_capacity = buffer.m_capacity;
+    this->m_mem = buffer.m_mem;
+    this->m_roffset = buffer.m_roffset;
+    this->m_woffset = buffer.m_woffset;
+    buffer.m_mem = nullptr;
+    buffer.m_capacity = 0;
+    buffer.m_roffset = 0;
+    buffer.m_woffset = 0;
+  }
+
+  RingStreamBuffer& operator=(const RingStreamBuffer &buffer) = delete;
+  RingStreamBuffer& operator=(RingStreamBuffer &&buffer) = delete;
+
+  /// returns the total capacity of the buffer
+  inline size_t capacity() const noexcept override {
+    return m_capacity;
+  }
+
+  /// returns the number of bytes required to read all the
+  /// bytes available in the buffer
+  inline size_t readable() const noexcept override {
+    return m_woffset - m_roffset;
+  }
+
+  /// returns the number of bytes that can be recovered
+  /// because they have been previously `consumed` and
+  /// have not been overwritten yet
+  inline size_t recoverable() const noexcept {
+    const uint64_t oldest = m_woffset > m_capacity ?
+        m_woffset - m_capacity : 0;
+    return m_roffset - oldest;
+  }
+
+  /// returns the number of bytes that be written
+  /// to the buffer
+  inline size_t writable() const noexcept override {
+    return m_capacity - readable();
+  }
+
+  size_t extend(const size_t len) noexcept override;
+  Status provide(uint8_t **src,
+                 const size_t intent,
+                 size_t *pbytes) noexcept override;
+  Status write(const uint8_t *src,
+               const size_t len,
+               size_t *wbytes) noexcept override;
+
+  size_t recover(const size_t len) noexcept;
+  size_t consume(const size_t len) noexcept override;
+  Status peek(const uint8_t **dst,
+              const size_t intent,
+              size_t *pbytes) noexcept override;
+  Status read(uint8_t *dst,
+              const size_t len,
+              size_t *rbytes) noexcept override;
+
+ private:
+  inline uint8_t *roffset() const noexcept {
+    return m_mem + (m_roffset % m_capacity);
+  }
+
+  inline uint8_t *woffset() const noexcept {
+    return m_mem + (m_woffset % m_capacity);
+  }
+
+  size_t m_capacity;
+  uint8_t *m_mem;
+
+  uint64_t m_roffset;
+  uint64_t m_woffset;
+};
+
+class RecovererRingBuffer final : public RecovererReader {
+ public:
+  explicit RecovererRingBuffer(std::unique_ptr<RingStreamBuffer> &&buffer):
+      m_buffer(std::move(buffer)) { }
+
+  inline size_t recover(const size_t len) noexcept override {
+    return m_buffer->recover(len);
+  }
+
+  inline Status peek(const uint8_t **dst,
+                     const size_t intent,
+                     size_t *pbytes) noexcept override {
+    return m_buffer->peek(dst, intent, pbytes);
+  }
+
+  size_t consume(const size_t len) noexcept override {
+    return m_buffer->consume(len);
+  }
+
+  inline Status read(uint8_t *dst,
+                     const size_t len,
+                     size_t *rbytes) noexcept override {
+    return m_buffer->read(dst, len, rbytes);
+  }
+
+  inline size_t recoverable() const noexcept override {
+    return m_buffer->recoverable();
+  }
+
+ private:
+  std::unique_ptr<RingStreamBuffer> m_buffer;
+};
+
+#endif  // BUFFER_RINGSTREAMBUFFER_H_
@@ -9,39 +9,73 @@
 #include "status.hpp"
 #include "value/string_utils.hpp"
 
+/// scan_until sets `offset` to the length of the token that ends at
+/// `stopped`, the first delimiter found from `current`, or `limit`
+/// if there is none. The vectorized search of the delimiter is done
+/// by the caller
+static inline bool scan_until(const uint8_t *current,
+                              const uint8_t *limit,
+                              const uint8_t *stopped,
+                              bool is_end,
+                              size_t *offset) {
+  if (current >= limit || stopped == current) {
+    // if we have reached the end of the buffer and there are no
+    // delimiters, or the buffer starts with a delimiter, just
+    // return offset 0 so that the delimiter is skipped
+    *offset = 0;
+    return true;
+  }
+
+  *offset = stopped - current;
+  return is_end || stopped < limit;
+}
+
 bool Scanner::scan_line_func(
     const uint8_t *current,
     const uint8_t *limit,
     bool is_end,
     size_t *offset) {
+  const char *skipped = string_skip_line(
+      reinterpret_cast<const char*>(current),
+      current < limit ? limit - current : 0);
+  return scan_until(current, limit,
+                    reinterpret_cast<const uint8_t*>(skipped),
+                    is_end, offset);
+}
 
-    while (true) {
-        if (current >= limit) {
-            // if we have reached the end of the buffer and there are no
-            // newlines just return offset 0
-            *offset = 0;
-            return true;
-        }
-
-        const char *skipped = string_skip_line(
-            reinterpret_cast<const char*>(current),
-            limit - current);
-        const uint8_t *stopped = reinterpret_cast<const uint8_t*>(skipped);
-        if (stopped == current) {
-            // skip all newline characters at the beginning of the
-            // buffer
-            *offset = 0;
-            return true;
-        }
+Scanner::ScanFunc Scanner::scan_delimiter_func(char delimiter) {
+  return [delimiter](const uint8_t *current,
+                     const uint8_t *limit,
+                     bool is_end,
+                     size_t *offset) {
+    const char *stopped = string_find_char(
+        reinterpret_cast<const char*>(current),
+        current < limit ? limit - current : 0,
+        delimiter);
+    return scan_until(current, limit,
+                      reinterpret_cast<const uint8_t*>(stopped),
+                      is_end, offset);
+  };
+}
 
-        *offset = stopped - current;
-        if (is_end || stopped < limit) {
-            return true;
+Scanner::ScanFunc Scanner::scan_delimiters_func(const char *delimiters) {
+  std::string set(delimiters);
+  if (set.size() == 1) {
+    return scan_delimiter_func(set[0]);
+  }
 
-        } else {
-            return false;
-        }
-    }
+  return [set](const uint8_t *current,
+               const uint8_t *limit,
+               bool is_end,
+               size_t *offset) {
+    const char *stopped = string_find_any(
+        reinterpret_cast<const char*>(current),
+        current < limit ? limit - current : 0,
+        set.data(), set.size());
+    return scan_until(current, limit,
+                      reinterpret_cast<const uint8_t*>(stopped),
+                      is_end, offset);
+  };
 }
 
 size_t Scanner::consume(const size_t len) noexcept {
@@ -5,6 +5,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 #include "io/recoverer.hpp"
 
@@ -22,11 +23,20 @@ class Scanner final : public Reader {
                                       bool is_end,
                                       size_t *offset)>;
 
+  /// scan_line_func splits the input in lines
   static bool scan_line_func(const uint8_t *current,
                              const uint8_t *limit,
                              bool is_end,
                              size_t *offset);
 
+  /// scan_delimiter_func returns a ScanFunc that splits the
+  /// input in tokens separated by `delimiter`
+  static ScanFunc scan_delimiter_func(char delimiter);
+
+  /// scan_delimiters_func returns a ScanFunc that splits the input
+  /// in tokens separated by any of the bytes in `delimiters`
+  static ScanFunc scan_delimiters_func(const char *delimiters);
+
   Scanner(std::unique_ptr<RecovererReader> &&reader,
           bool skip_on_failure = false,
           ScanFunc scan_func = scan_line_func):
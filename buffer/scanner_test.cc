@@ -76,6 +76,31 @@ static int test_scanner_read_multiple_lines() {
   return EXIT_SUCCESS;
 }
 
+static int test_scanner_read_delimiters() {
+  char content[] = "key0=value0;key1=value1;;key2";
+  const char *expected[] = {"key0", "value0", "key1", "value1", "key2"};
+  const uint8_t *data;
+  size_t rbytes;
+  auto buffer = std::make_unique<StreamBuffer>(
+      reinterpret_cast<uint8_t*>(content), strlen(content),
+      do_nothing_delete_dispose_func);
+  buffer->extend(strlen(content));
+  Scanner scanner(std::make_unique<RecovererBuffer>(std::move(buffer)),
+                  false, Scanner::scan_delimiters_func("=;"));
+
+  for (const char *token : expected) {
+    ASSERT_EQ(scanner.peek(&data, 0, &rbytes), OK);
+    ASSERT_EQ(rbytes, strlen(token));
+    ASSERT_MEM_EQ(token, data, rbytes);
+    ASSERT_EQ(scanner.consume(rbytes), rbytes);
+  }
+
+  ASSERT_EQ(scanner.peek(&data, 0, &rbytes), OK);
+  ASSERT_EQ(rbytes, 0);
+
+  return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
   test_ctx_t ctx;
   TEST_INIT(ctx, argc, argv);
@@ -84,6 +109,7 @@ int main(int argc, char *argv[]) {
   TEST_RUN(ctx, test_scanner_read_line_newline_only());
   TEST_RUN(ctx, test_scanner_read_line_with_newline());
   TEST_RUN(ctx, test_scanner_read_multiple_lines());
+  TEST_RUN(ctx, test_scanner_read_delimiters());
 
   return TEST_RELEASE(ctx);
 }
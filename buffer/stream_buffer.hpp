@@ -8,6 +8,7 @@
 #include "io/recoverer.hpp"
 
 #include <memory>
+#include <utility>
 
 /// StreamBuffer provides a buffer implementation in which
 /// the input is treated as a stream, that is, as a stream
@@ -17,14 +18,14 @@ class StreamBuffer final : public Buffer {
   explicit StreamBuffer(size_t capacity):
       StreamBuffer(new uint8_t[capacity],
                    capacity,
-                   array_delete_dispose_func) { }
+                   DisposeFunc::array_delete()) { }
 
   StreamBuffer(uint8_t *mem,
                size_t capacity,
                DisposeFunc dispose_func):
       m_capacity(capacity),
       m_mem(mem),
-      m_dispose_func(dispose_func),
+      m_dispose_func(std::move(dispose_func)),
       m_roffset(m_mem),
       m_woffset(m_mem) { }
 
@@ -39,7 +40,7 @@ class StreamBuffer final : public Buffer {
   StreamBuffer(StreamBuffer &&buffer) {
     this->m_capacity = buffer.m_capacity;
     this->m_mem = buffer.m_mem;
-    this->m_dispose_func = buffer.m_dispose_func;
+    this->m_dispose_func = std::move(buffer.m_dispose_func);
     this->m_roffset = buffer.m_roffset;
     this->m_woffset = buffer.m_woffset;
     buffer.m_mem = nullptr;
@@ -12,167 +12,200 @@ static inline bool _is_comment(char c) {
   return c == '#';
 }
 
+/// hash_bytes hashes variable names and values with 64 bit FNV-1a
+static inline uint64_t hash_bytes(const char *name, size_t len) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (size_t i = 0; i < len; i++) {
+    hash ^= static_cast<uint8_t>(name[i]);
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
 bool Config::string_var(char *ptr,
                           size_t len,
                           const char *name,
                           const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
-    return false;
-  }
-
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::string_parser(ptr, len),
-                                       Parser::kString,
-                                       name,  desc));
-  return true;
+  return add_var(CharArrayParser(ptr, len), name, desc);
 }
 
-
 bool Config::string_var(std::string *ptr,
                           const char *name,
                           const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
-    return false;
-  }
-
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::string_parser(ptr),
-                                       Parser::kString,
-                                       name,  desc));
-  return true;
+  return add_var(TypedParser<std::string>(ptr), name, desc);
 }
 
 bool Config::bool_var(bool *ptr,
                         const char *name,
                         const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
-    return false;
-  }
-
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::bool_parser(ptr),
-                                       Parser::kBool,
-                                       name,  desc));
-  return true;
+  return add_var(TypedParser<bool>(ptr), name, desc);
 }
 
 bool Config::int32_var(int32_t *ptr,
                          const char *name,
                          const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
-    return false;
-  }
-
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::int32_parser(ptr),
-                                       Parser::kInt32,
-                                       name,  desc));
-  return true;
+  return add_var(TypedParser<int32_t>(ptr), name, desc);
 }
 
-
 bool Config::uint32_var(uint32_t *ptr,
                           const char *name,
                           const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
-    return false;
-  }
-
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::uint32_parser(ptr),
-                                       Parser::kUInt32,
-                                       name,  desc));
-  return true;
+  return add_var(TypedParser<uint32_t>(ptr), name, desc);
 }
 
 bool Config::int64_var(int64_t *ptr,
                          const char *name,
                          const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
-    return false;
-  }
-
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::int64_parser(ptr),
-                                       Parser::kInt64,
-                                       name,  desc));
-  return true;
+  return add_var(TypedParser<int64_t>(ptr), name, desc);
 }
 
-
 bool Config::uint64_var(uint64_t *ptr,
                           const char *name,
                           const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
-    return false;
-  }
-
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::uint64_parser(ptr),
-                                       Parser::kUInt64,
-                                       name,  desc));
-  return true;
+  return add_var(TypedParser<uint64_t>(ptr), name, desc);
 }
 
-
 bool Config::duration_var(std::chrono::nanoseconds *ptr,
                             const char *name,
                             const char *desc) noexcept {
-  std::string s(name);
-  if (m_vars.count(s) > 0) {
+  return add_var(TypedParser<std::chrono::nanoseconds>(ptr), name, desc);
+}
+
+bool Config::add_var(AnyParser parser,
+                     const char *name,
+                     const char *desc) noexcept {
+  const size_t len = strlen(name);
+  if (find_var(name, len) != nullptr) {
     return false;
   }
 
-  m_vars.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(std::move(s)),
-                 std::forward_as_tuple(Parser::duration_parser(ptr),
-                                       Parser::kDuration,
-                                       name,  desc));
+  // the index is kept at most half full, so that
+  // probe sequences stay short
+  if ((m_vars.size() + 1) * 2 > m_slots.size()) {
+    grow();
+  }
+
+  const uint64_t hash = hash_bytes(name, len);
+  const size_t mask = m_slots.size() - 1;
+  size_t pos = hash & mask;
+
+  while (m_slots[pos].index != EMPTY_SLOT) {
+    pos = (pos + 1) & mask;
+  }
+
+  m_slots[pos].hash = hash;
+  m_slots[pos].index = static_cast<uint32_t>(m_vars.size());
+  m_vars.emplace_back(parser, name, desc);
   return true;
 }
 
+Config::variable_t *Config::find_var(const char *name, size_t len) noexcept {
+  if (m_slots.empty()) {
+    return nullptr;
+  }
+
+  const uint64_t hash = hash_bytes(name, len);
+  const size_t mask = m_slots.size() - 1;
+
+  for (size_t pos = hash & mask; m_slots[pos].index != EMPTY_SLOT;
+       pos = (pos + 1) & mask) {
+    if (m_slots[pos].hash != hash) {
+      continue;
+    }
+
+    variable_t *variable = &m_vars[m_slots[pos].index];
+    if (variable->name_len() == len &&
+        memcmp(variable->name(), name, len) == 0) {
+      return variable;
+    }
+  }
+
+  return nullptr;
+}
+
+void Config::grow() {
+  const size_t size = m_slots.empty() ? 16 : m_slots.size() * 2;
+  const size_t mask = size - 1;
+
+  m_slots.assign(size, Slot{0, EMPTY_SLOT});
+  for (size_t i = 0; i < m_vars.size(); i++) {
+    const uint64_t hash = hash_bytes(m_vars[i].name(), m_vars[i].name_len());
+    size_t pos = hash & mask;
+
+    while (m_slots[pos].index != EMPTY_SLOT) {
+      pos = (pos + 1) & mask;
+    }
+
+    m_slots[pos].hash = hash;
+    m_slots[pos].index = static_cast<uint32_t>(i);
+  }
+}
+
 void Config::print_help(const char *prog) const noexcept {
   printf("Configuration; %s", prog);
 
-  for (const auto& pair : m_vars) {
-    printf("  %s [%s]\t%s\n", pair.second.name(),
-           pair.second.type(), pair.second.desc());
+  for (const auto& variable : m_vars) {
+    printf("  %s [%s]\t%s\n", variable.name(),
+           variable.type(), variable.desc());
   }
 }
 
 Status Config::parse(const char **error) noexcept {
+  size_t changed;
+  return parse_lines(false, &changed, error);
+}
+
+bool Config::on_change(const char *name, ChangeFunc func) noexcept {
+  variable_t *variable = find_var(name, strlen(name));
+  if (variable == nullptr) {
+    return false;
+  }
+
+  variable->set_on_change(std::move(func));
+  return true;
+}
+
+Status Config::reload(std::unique_ptr<Scanner> &&scanner,
+                      size_t *changed,
+                      const char **error) noexcept {
+  m_scanner = std::move(scanner);
+  return parse_lines(true, changed, error);
+}
+
+Status Config::parse_lines(bool incremental,
+                           size_t *changed,
+                           const char **error) noexcept {
   Status status = OK;
-  size_t len;
+  size_t len = 0;
 
-  for (int i = 0; status->ok() && len > 0; i++) {
+  *changed = 0;
+  *error = m_error;
+  for (int i = 0; ; i++) {
     const char *line;
     status = m_scanner->peek(
         reinterpret_cast<const uint8_t**>(&line), 0, &len);
-    status = process_line(i, line, len);
-    assert(len == m_scanner->consume(len));
-    *error = m_error;
+    if (status->error() || len == 0) {
+      return status;
+    }
+
+    status = process_line(i, line, len, incremental, changed);
+    if (status->error()) {
+      return status;
+    }
+
+    size_t cbytes = m_scanner->consume(len);
+    assert(cbytes == len);
+    (void)(cbytes);
   }
-
-  return status;
 }
 
 Status Config::process_line(int count,
                             const char *line,
-                            size_t len) noexcept {
+                            size_t len,
+                            bool incremental,
+                            size_t *changed) noexcept {
   size_t remaining = len;
   const char *begin_key = string_skip_blank(line, len);
   size_t parsed = static_cast<size_t>(begin_key - line);
@@ -193,7 +226,8 @@ Status Config::process_line(int count,
   }
 
   remaining -= parsed;
-  const std::string key(begin_key, parsed);
+  const char *key = begin_key;
+  const int key_len = static_cast<int>(parsed);
   const char *begin_value = string_skip_blank(end_key, remaining);
   parsed = begin_value - end_key;
   if (parsed >= remaining) {
@@ -209,18 +243,29 @@ Status Config::process_line(int count,
     return ConfigNotFoundKey;
   }
 
-  if (m_vars.count(key) == 0) {
-    snprintf(m_error, ERROR_LENGTH, "[%d] error: %s - key: %s",
-             count, "key was not defined", key.c_str());
+  variable_t *variable = find_var(key, key_len);
+  if (variable == nullptr) {
+    snprintf(m_error, ERROR_LENGTH, "[%d] error: %s - key: %.*s",
+             count, "key was not defined", key_len, key);
     return ConfigNotFoundKey;
   }
 
-  variable_t& variable = m_vars.find(key)->second;
-  if (!variable.set(begin_value, parsed)) {
-    snprintf(m_error, ERROR_LENGTH, "[%d] error: %s - key: %s",
-             count, "failed to parse value for key", key.c_str());
+  const uint64_t hash = hash_bytes(begin_value, parsed);
+  if (incremental && variable->applied(hash)) {
+    return OK;
+  }
+
+  if (!variable->set(begin_value, parsed)) {
+    snprintf(m_error, ERROR_LENGTH, "[%d] error: %s - key: %.*s",
+             count, "failed to parse value for key", key_len, key);
     return ConfigParseValue;
   }
 
+  variable->set_applied(hash);
+  (*changed)++;
+  if (incremental) {
+    variable->changed();
+  }
+
   return OK;
 }
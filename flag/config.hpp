@@ -4,12 +4,14 @@
 #define FLAG_CONFIG_H_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <chrono>
-#include <map>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "buffer/buffer.hpp"
 #include "buffer/scanner.hpp"
@@ -18,6 +20,10 @@
 
 class Config final {
  public:
+  /// ChangeFunc is called with the name of a variable
+  /// whose value was changed by a reload
+  using ChangeFunc = std::function<void(const char *name)>;
+
   // delete to prevent a conversion from a static const char
   // value to a std::string
   bool string_var(char *value,
@@ -76,28 +82,52 @@ class Config final {
    */
   Status parse(const char **error) noexcept;
 
+  /// on_change sets the function called when a reload changes
+  /// the value of the variable `name`. It returns false if
+  /// there is no such variable
+  bool on_change(const char *name, ChangeFunc func) noexcept;
+
+  /// reload parses the configuration from a new `scanner`, like
+  /// parse, but only sets the variables whose value differs from
+  /// the one last applied, and calls their change functions.
+  /// A reload still reads, hashes and looks up every line of the
+  /// file, so its cost is linear in the size of the file. Values
+  /// are compared by hash, which only saves parsing and setting
+  /// the values that did not change. Variables that are no longer
+  /// in the file keep their value. `changed` is set to the number
+  /// of variables that were set. If an error is found the
+  /// variables set before it keep their new value
+  Status reload(std::unique_ptr<Scanner> &&scanner,
+                size_t *changed,
+                const char **error) noexcept;
+
  private:
   class variable_t {
    public:
-    variable_t(Parser parser,
-               const char *type,
+    variable_t(AnyParser parser,
                const char *name,
                const char *desc):
         m_parser(parser),
-        m_type(type),
         m_name(name),
-        m_desc(desc) { }
+        m_name_len(strlen(name)),
+        m_desc(desc),
+        m_applied(false),
+        m_value_hash(0) { }
 
     ~variable_t() = default;
 
     inline const char *type() const noexcept {
-      return m_type;
+      return m_parser.type();
     }
 
     inline const char *name() const noexcept {
       return m_name;
     }
 
+    inline size_t name_len() const noexcept {
+      return m_name_len;
+    }
+
     inline const char *desc() const noexcept {
       return m_desc;
     }
@@ -114,22 +144,79 @@ class Config final {
       return m_parser.expects_arg();
     }
 
+    /// applied returns true if the variable was set from a value
+    /// with the hash `hash` and it has not been set since
+    inline bool applied(uint64_t hash) const noexcept {
+      return m_applied && m_value_hash == hash;
+    }
+
+    inline void set_applied(uint64_t hash) noexcept {
+      m_applied = true;
+      m_value_hash = hash;
+    }
+
+    inline void set_on_change(ChangeFunc func) noexcept {
+      m_on_change = std::move(func);
+    }
+
+    inline void changed() const {
+      if (m_on_change) {
+        m_on_change(m_name);
+      }
+    }
+
    private:
-    Parser m_parser;
-    const char *m_type;
+    AnyParser m_parser;
     const char *m_name;
+    size_t m_name_len;
     const char *m_desc;
+    bool m_applied;
+    uint64_t m_value_hash;
+    ChangeFunc m_on_change;
   };
 
+  /// parse_lines processes all the lines of the scanner. With
+  /// `incremental` set, values that are already applied are
+  /// skipped and the change functions are called
+  Status parse_lines(bool incremental,
+                     size_t *changed,
+                     const char **error) noexcept;
+
   Status process_line(int count,
                       const char *line,
-                      size_t len) noexcept;
+                      size_t len,
+                      bool incremental,
+                      size_t *changed) noexcept;
+
+  /// add_var registers a variable, unless there is
+  /// already one with the same name
+  bool add_var(AnyParser parser,
+               const char *name,
+               const char *desc) noexcept;
+
+  /// find_var returns the variable named by the `len` bytes
+  /// of `name`, or nullptr if there is none
+  variable_t *find_var(const char *name, size_t len) noexcept;
+
+  /// grow doubles the slots of the index and rehashes
+  /// the variables into them
+  void grow();
 
   static constexpr int ERROR_LENGTH = 128;
+  static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+  /// Slot is an entry of the open addressing index of the
+  /// variables by name. It keeps the hash of the name so that
+  /// most mismatches are found without comparing names
+  struct Slot final {
+    uint64_t hash;
+    uint32_t index;
+  };
 
   std::unique_ptr<Scanner> m_scanner;
   char m_error[ERROR_LENGTH];
-  std::map<std::string, variable_t> m_vars;
+  std::vector<variable_t> m_vars;
+  std::vector<Slot> m_slots;
 };
 
 #endif  // FLAG_CONFIG_H_
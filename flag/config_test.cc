@@ -104,6 +104,101 @@ static int test_config_parse_ignore_comments() {
   return EXIT_SUCCESS;
 }
 
+static int test_config_parse_many_keys() {
+  const char *content = "key7 7\nkey31 31\nkey0 0\n";
+  const char *error;
+  int32_t values[40];
+  char names[40][8];
+
+  auto config = make_config(content, strlen(content));
+
+  for (int i = 0; i < 40; i++) {
+    values[i] = -1;
+    snprintf(names[i], sizeof(names[i]), "key%d", i);
+    ASSERT_TRUE(config.int32_var(&values[i], names[i], "key for a test"));
+  }
+
+  ASSERT_FALSE(config.int32_var(&values[0], "key3", "duplicate key"));
+  ASSERT_EQ(config.parse(&error), OK);
+  ASSERT_EQ(values[7], 7);
+  ASSERT_EQ(values[31], 31);
+  ASSERT_EQ(values[0], 0);
+  ASSERT_EQ(values[3], -1);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_config_parse_key_prefix() {
+  const char *content = "ke value";
+  const char *error;
+  std::string value;
+  auto config = make_config(content, strlen(content));
+
+  ASSERT_TRUE(config.string_var(&value, "key", "key for a test"));
+  ASSERT_EQ(config.parse(&error), ConfigNotFoundKey);
+
+  return EXIT_SUCCESS;
+}
+
+static std::unique_ptr<Scanner> make_scanner(const char *content) {
+  size_t wbytes;
+  auto buffer = std::make_unique<StreamBuffer>(128);
+  buffer->write(reinterpret_cast<const uint8_t*>(content),
+                strlen(content), &wbytes);
+  auto recoverer = std::make_unique<RecovererBuffer>(std::move(buffer));
+  return std::make_unique<Scanner>(std::move(recoverer));
+}
+
+static int test_config_reload_changed_keys() {
+  const char *content = "first 1\nsecond 2\nthird 3\n";
+  const char *error;
+  int32_t first, second, third;
+  std::string names;
+  size_t changed;
+
+  auto config = make_config(content, strlen(content));
+
+  ASSERT_TRUE(config.int32_var(&first, "first", "key for a test"));
+  ASSERT_TRUE(config.int32_var(&second, "second", "key for a test"));
+  ASSERT_TRUE(config.int32_var(&third, "third", "key for a test"));
+  ASSERT_FALSE(config.on_change("fourth", [](const char *) { }));
+  for (const char *name : {"first", "second", "third"}) {
+    ASSERT_TRUE(config.on_change(name, [&names](const char *name) {
+      names.append(name);
+    }));
+  }
+  ASSERT_EQ(config.parse(&error), OK);
+  ASSERT_EQ(first, 1);
+  ASSERT_EQ(second, 2);
+  ASSERT_EQ(third, 3);
+  ASSERT_TRUE(names.empty());
+
+  // values set by hand are kept unless their key changes
+  first = 10;
+  ASSERT_EQ(config.reload(make_scanner("first 1\nsecond 20\n# third\n"),
+                          &changed, &error), OK);
+  ASSERT_EQ(changed, 1);
+  ASSERT_EQ(first, 10);
+  ASSERT_EQ(second, 20);
+  ASSERT_EQ(third, 3);
+  ASSERT_EQ(names.compare("second"), 0);
+
+  ASSERT_EQ(config.reload(make_scanner("second 2\nthird  3\nfirst 5"),
+                          &changed, &error), OK);
+  ASSERT_EQ(changed, 2);
+  ASSERT_EQ(first, 5);
+  ASSERT_EQ(second, 2);
+  ASSERT_EQ(names.compare("secondsecondfirst"), 0);
+
+  ASSERT_EQ(config.reload(make_scanner("third x\n"),
+                          &changed, &error), ConfigParseValue);
+  ASSERT_EQ(config.reload(make_scanner("third 3\n"),
+                          &changed, &error), OK);
+  ASSERT_EQ(changed, 0);
+
+  return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
   test_ctx_t ctx;
   TEST_INIT(ctx, argc, argv);
@@ -114,6 +209,9 @@ int main(int argc, char *argv[]) {
   TEST_RUN(ctx, test_config_parse_bool_false());
   TEST_RUN(ctx, test_config_parse_multiple_properties());
   TEST_RUN(ctx, test_config_parse_ignore_comments());
+  TEST_RUN(ctx, test_config_parse_many_keys());
+  TEST_RUN(ctx, test_config_parse_key_prefix());
+  TEST_RUN(ctx, test_config_reload_changed_keys());
 
   TEST_RELEASE(ctx);
   return EXIT_SUCCESS;
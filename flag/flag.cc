@@ -140,8 +140,7 @@ bool Flag::string_var(char *ptr,
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kString,
-                        Parser::string_parser(ptr, len),
+  m_vars[flagcode].init(variable, CharArrayParser(ptr, len),
                         ascii, name, desc);
   return true;
 }
@@ -158,8 +157,7 @@ bool Flag::string_var(std::string *ptr,
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kString,
-                        Parser::string_parser(ptr),
+  m_vars[flagcode].init(variable, TypedParser<std::string>(ptr),
                         ascii, name, desc);
   return true;
 }
@@ -176,8 +174,7 @@ bool Flag::bool_var(bool *ptr,
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kBool,
-                        Parser::bool_parser(ptr),
+  m_vars[flagcode].init(variable, TypedParser<bool>(ptr),
                         ascii, name, desc);
   return true;
 }
@@ -188,15 +185,13 @@ bool Flag::int32_var(int32_t *ptr,
                               const char *desc) noexcept {
   Variable *variable = nullptr;
   uint8_t flagcode = _ascii_to_flag(ascii);
-  Parser parser(ptr, 0, true, parse_func_int32);
 
   if (flagcode == 0xff) {
     return false;
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kInt32,
-                        Parser::int32_parser(ptr),
+  m_vars[flagcode].init(variable, TypedParser<int32_t>(ptr),
                         ascii, name, desc);
 
   return true;
@@ -214,8 +209,7 @@ bool Flag::uint32_var(uint32_t *ptr,
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kUInt32,
-                        Parser::uint32_parser(ptr),
+  m_vars[flagcode].init(variable, TypedParser<uint32_t>(ptr),
                         ascii, name, desc);
   return true;
 }
@@ -232,8 +226,7 @@ bool Flag::int64_var(int64_t *ptr,
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kInt64,
-                        Parser::int64_parser(ptr),
+  m_vars[flagcode].init(variable, TypedParser<int64_t>(ptr),
                         ascii, name, desc);
 
   return true;
@@ -245,15 +238,13 @@ bool Flag::duration_var(std::chrono::nanoseconds *ptr,
                                  const char *desc) noexcept {
   Variable *variable = nullptr;
   uint8_t flagcode = _ascii_to_flag(ascii);
-  Parser parser(ptr, 0, true, parse_func_duration);
 
   if (flagcode == 0xff) {
     return false;
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kDuration,
-                        Parser::duration_parser(ptr),
+  m_vars[flagcode].init(variable, TypedParser<std::chrono::nanoseconds>(ptr),
                         ascii, name, desc);
 
   return true;
@@ -265,14 +256,12 @@ bool Flag::uint64_var(uint64_t *ptr,
                                const char *desc) noexcept {
   Variable *variable = nullptr;
   uint8_t flagcode = _ascii_to_flag(ascii);
-  Parser parser(ptr, 0, true, parse_func_uint64);
   if (flagcode == 0xff) {
     return false;
   }
 
   variable = &m_vars[flagcode];
-  m_vars[flagcode].init(variable, Parser::kUInt64,
-                        Parser::uint64_parser(ptr),
+  m_vars[flagcode].init(variable, TypedParser<uint64_t>(ptr),
                         ascii, name, desc);
 
   return true;
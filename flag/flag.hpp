@@ -89,10 +89,8 @@ class Flag final {
  private:
   class Variable {
    public:
-    Variable():
-        m_parser(nullptr, 0, false, nullptr) {
+    Variable() {
       m_flag = 0;
-      m_type = nullptr;
       m_name = nullptr;
       m_desc = nullptr;
       m_init = false;
@@ -100,15 +98,12 @@ class Flag final {
 
     ~Variable() = default;
 
-    // cppcheck-suppress performance
     static void init(Variable *variable,
-                     const char *type,
-                     Parser parser,
+                     AnyParser parser,
                      char flag,
                      const char *name,
                      const char *desc) {
       variable->m_parser = parser;
-      variable->m_type = type;
       variable->m_flag = flag;
       variable->m_name = name;
       variable->m_desc = desc;
@@ -120,7 +115,7 @@ class Flag final {
     }
 
     inline const char *type() const noexcept {
-      return m_type;
+      return m_parser.type();
     }
 
     inline const char *name() const noexcept {
@@ -148,12 +143,11 @@ class Flag final {
     }
 
    private:
-    Parser m_parser;
+    AnyParser m_parser;
     char m_flag;
-    const char *m_type;
+    bool m_init;
     const char *m_name;
     const char *m_desc;
-    bool m_init;
   };
 
   Flag::Variable *find_flag(const char *arg,
@@ -0,0 +1,101 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef IO_IOVEC_H_
+#define IO_IOVEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/// IovCursor tracks the progress of a vectored transfer over an
+/// array of iovec, which vectored syscalls may complete partially.
+/// `batch` returns the entries that are still pending, with the
+/// first entry adjusted to skip the bytes already transferred, so
+/// that the array passed by the caller is never modified. Entries
+/// are handed out in batches of at most BATCH entries
+class IovCursor final {
+ public:
+  static const size_t BATCH = 64;
+
+  IovCursor(const struct iovec *iov, size_t iovcnt):
+      m_iov(iov),
+      m_iovcnt(iovcnt),
+      m_offset(0) {
+    skip_empty();
+  }
+
+  IovCursor(const IovCursor &cursor) = delete;
+  IovCursor(IovCursor &&cursor) = delete;
+  IovCursor& operator=(const IovCursor &cursor) = delete;
+  IovCursor& operator=(IovCursor &&cursor) = delete;
+
+  /// done returns true once all the bytes have been transferred
+  inline bool done() const noexcept {
+    return m_iovcnt == 0;
+  }
+
+  /// batch returns the pending entries and sets `count`
+  /// to the number of entries returned
+  inline const struct iovec *batch(int *count) noexcept {
+    const size_t len = m_iovcnt < BATCH ? m_iovcnt : BATCH;
+
+    for (size_t i = 0; i < len; i++) {
+      m_batch[i] = m_iov[i];
+    }
+
+    if (len > 0) {
+      m_batch[0].iov_base = static_cast<uint8_t*>(m_iov[0].iov_base) + m_offset;
+      m_batch[0].iov_len = m_iov[0].iov_len - m_offset;
+    }
+
+    *count = static_cast<int>(len);
+    return m_batch;
+  }
+
+  /// advance marks `bytes` bytes as transferred
+  inline void advance(size_t bytes) noexcept {
+    while (bytes > 0 && m_iovcnt > 0) {
+      const size_t pending = m_iov->iov_len - m_offset;
+      if (bytes < pending) {
+        m_offset += bytes;
+        return;
+      }
+
+      bytes -= pending;
+      next();
+    }
+
+    skip_empty();
+  }
+
+  /// total returns the number of bytes
+  /// described by an array of iovec
+  static inline size_t total(const struct iovec *iov, size_t iovcnt) noexcept {
+    size_t len = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+      len += iov[i].iov_len;
+    }
+
+    return len;
+  }
+
+ private:
+  inline void next() noexcept {
+    m_iov++;
+    m_iovcnt--;
+    m_offset = 0;
+  }
+
+  inline void skip_empty() noexcept {
+    while (m_iovcnt > 0 && m_iov->iov_len == m_offset) {
+      next();
+    }
+  }
+
+  const struct iovec *m_iov;
+  size_t m_iovcnt;
+  size_t m_offset;
+  struct iovec m_batch[BATCH];
+};
+
+#endif  // IO_IOVEC_H_
@@ -0,0 +1,23 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "sink.hpp"
+
+Status Sink::write_v(const struct iovec *iov,
+                     size_t iovcnt,
+                     size_t *wbytes) noexcept {
+  Status status = OK;
+  size_t written;
+
+  *wbytes = 0;
+
+  for (size_t i = 0; i < iovcnt; i++) {
+    status = write(static_cast<const uint8_t*>(iov[i].iov_base),
+                   iov[i].iov_len, &written);
+    *wbytes += written;
+    if (status->error() || written < iov[i].iov_len) {
+      break;
+    }
+  }
+
+  return status;
+}
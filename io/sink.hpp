@@ -5,6 +5,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 #include "status/status.hpp"
 
@@ -21,6 +22,15 @@ class Sink {
   virtual Status write(const uint8_t *src,
                        size_t len,
                        size_t *wbytes) noexcept = 0;
+
+  /// write_v writes as many bytes as possible from the `iovcnt`
+  /// regions in `iov`, in order, as if they were a single region.
+  /// The default implementation calls `write` once per region and
+  /// stops at the first short write. Sinks backed by a file
+  /// descriptor gather the regions with a single syscall
+  virtual Status write_v(const struct iovec *iov,
+                         size_t iovcnt,
+                         size_t *wbytes) noexcept;
 };
 
 #endif  // IO_SINK_H_
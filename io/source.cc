@@ -0,0 +1,23 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "source.hpp"
+
+Status Source::read_v(const struct iovec *iov,
+                      size_t iovcnt,
+                      size_t *rbytes) noexcept {
+  Status status = OK;
+  size_t chunk;
+
+  *rbytes = 0;
+
+  for (size_t i = 0; i < iovcnt; i++) {
+    status = read(static_cast<uint8_t*>(iov[i].iov_base),
+                  iov[i].iov_len, &chunk);
+    *rbytes += chunk;
+    if (status->error() || chunk < iov[i].iov_len) {
+      break;
+    }
+  }
+
+  return status;
+}
@@ -5,6 +5,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 #include "status/status.hpp"
 
@@ -21,6 +22,15 @@ public:
   virtual Status read(uint8_t *src,
                       size_t len,
                       size_t *rbytes) noexcept = 0;
+
+  /// read_v reads as many bytes as possible into the `iovcnt`
+  /// regions in `iov`, filling each region before the next one.
+  /// The default implementation calls `read` once per region and
+  /// stops at the first short read. Sources backed by a file
+  /// descriptor scatter into the regions with a single syscall
+  virtual Status read_v(const struct iovec *iov,
+                        size_t iovcnt,
+                        size_t *rbytes) noexcept;
 };
 
 #endif  // IO_SOURCE_H
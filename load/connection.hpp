@@ -0,0 +1,172 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef LOAD_CONNECTION_H_
+#define LOAD_CONNECTION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "buffer/buffered_reader.hpp"
+#include "buffer/buffered_writer.hpp"
+#include "buffer/stream_buffer.hpp"
+#include "os/socket.hpp"
+
+/// SocketCounters are the system calls made to read from and write
+/// to the sockets of the connections of a thread, as estimated by
+/// SocketRef from the bytes each call transferred. They are written
+/// by that thread only, and can be read from any other
+struct SocketCounters {
+  SocketCounters():
+      reads(0),
+      writes(0) { }
+
+  inline void add(std::atomic<uint64_t> *counter, uint64_t calls) noexcept {
+    counter->store(counter->load(std::memory_order_relaxed) + calls,
+                   std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> reads;
+  std::atomic<uint64_t> writes;
+};
+
+/// SocketRef reads from and writes to a socket it does not own, so
+/// that the reader and the writer of a Connection share its socket.
+/// It remembers whether a read drained the socket, which is the case
+/// when it returned less than asked for, and then reads nothing more
+/// until `rearm` so that filling a buffer does not end with a read
+/// that is known to find the socket empty
+class SocketRef final : public Source, public Sink {
+ public:
+  SocketRef(TcpSocket *socket, SocketCounters *counters):
+      m_socket(socket),
+      m_counters(counters),
+      m_drained(false) { }
+
+  Status read(uint8_t *dst, size_t len, size_t *rbytes) noexcept override {
+    if (m_drained) {
+      *rbytes = 0;
+      return OK;
+    }
+
+    Status status = m_socket->read(dst, len, rbytes);
+    m_drained = *rbytes < len;
+    m_counters->add(&m_counters->reads, calls(*rbytes, len));
+    return status;
+  }
+
+  Status write(const uint8_t *src, size_t len, size_t *wbytes) noexcept override {
+    Status status = m_socket->write(src, len, wbytes);
+    m_counters->add(&m_counters->writes, calls(*wbytes, len));
+    return status;
+  }
+
+  Status write_v(const struct iovec *iov,
+                 size_t iovcnt,
+                 size_t *wbytes) noexcept override {
+    size_t len = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+      len += iov[i].iov_len;
+    }
+
+    Status status = m_socket->write_v(iov, iovcnt, wbytes);
+    m_counters->add(&m_counters->writes, calls(*wbytes, len));
+    return status;
+  }
+
+  inline bool drained() const noexcept {
+    return m_drained;
+  }
+
+  inline void rearm() noexcept {
+    m_drained = false;
+  }
+
+ private:
+  /// calls returns the system calls a socket made to transfer
+  /// `bytes` out of `len`: one that transferred the bytes, and one
+  /// more that found the socket drained or full if they fell short.
+  /// On loopback a socket call transfers all that is available
+  static inline uint64_t calls(size_t bytes, size_t len) noexcept {
+    return (bytes > 0 ? 1 : 0) + (bytes < len ? 1 : 0);
+  }
+
+  TcpSocket *m_socket;
+  SocketCounters *m_counters;
+  bool m_drained;
+};
+
+/// Connection is a socket with a BufferedReader and a BufferedWriter
+/// of `buffer_size` bytes on top of it. The system calls they make
+/// are added to `counters`
+class Connection {
+ public:
+  Connection(std::unique_ptr<TcpSocket> &&socket,
+             size_t buffer_size,
+             SocketCounters *counters):
+      m_socket(std::move(socket)),
+      m_source(new SocketRef(m_socket.get(), counters)),
+      m_reader(std::unique_ptr<Source>(m_source),
+               std::make_unique<StreamBuffer>(buffer_size)),
+      m_wbuffer(new StreamBuffer(buffer_size)),
+      m_writer(std::make_unique<SocketRef>(m_socket.get(), counters),
+               std::unique_ptr<Buffer>(m_wbuffer)) { }
+
+  virtual ~Connection() = default;
+
+  Connection(const Connection &connection) = delete;
+  Connection& operator=(const Connection &connection) = delete;
+
+  inline TcpSocket *socket() const noexcept {
+    return m_socket.get();
+  }
+
+  /// peek returns the bytes buffered by the reader, after reading
+  /// from the socket the bytes available without blocking
+  inline Status peek(const uint8_t **data, size_t *pbytes) noexcept {
+    m_source->rearm();
+    return m_reader.peek(data, 0, pbytes);
+  }
+
+  inline size_t consume(size_t len) noexcept {
+    return m_reader.consume(len);
+  }
+
+  /// drained returns true if the last peek read all the
+  /// bytes the socket had available
+  inline bool drained() const noexcept {
+    return m_source->drained();
+  }
+
+  /// write writes up to `len` bytes of `src` through the writer,
+  /// which buffers them unless they do not fit in its buffer
+  inline Status write(const uint8_t *src, size_t len, size_t *wbytes) noexcept {
+    return m_writer.write(src, len, wbytes);
+  }
+
+  /// pending returns true if the writer holds bytes
+  /// that could not be written to the socket yet
+  inline bool pending() const noexcept {
+    return m_wbuffer->readable() > 0;
+  }
+
+  /// flush writes the buffered bytes to the socket. `flushed`
+  /// is set to false if some of them could not be written
+  inline Status flush(bool *flushed) noexcept {
+    size_t fbytes;
+    Status status = m_writer.flush(&fbytes);
+    *flushed = m_wbuffer->readable() == 0;
+    return status;
+  }
+
+ private:
+  std::unique_ptr<TcpSocket> m_socket;
+  SocketRef *m_source;
+  BufferedReader m_reader;
+  StreamBuffer *m_wbuffer;
+  BufferedWriter m_writer;
+};
+
+#endif  // LOAD_CONNECTION_H_
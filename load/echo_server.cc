@@ -0,0 +1,201 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "echo_server.hpp"
+
+#include "connection.hpp"
+
+/// Handler serves the connections accepted by a loop. Connections
+/// are indexed by their file descriptor, which the loop guarantees
+/// to be lower than its maximum
+class EchoServer::Handler final : public EventHandler {
+ public:
+  Handler(EventLoop *loop, size_t max_fd, size_t buffer_size):
+      m_loop(loop),
+      m_buffer_size(buffer_size),
+      m_accepted(0),
+      m_connections(max_fd) { }
+
+  inline EventLoop *loop() const noexcept {
+    return m_loop;
+  }
+
+  inline uint64_t accepted() const noexcept {
+    return m_accepted.load(std::memory_order_relaxed);
+  }
+
+  inline const SocketCounters &counters() const noexcept {
+    return m_counters;
+  }
+
+  void accept(std::unique_ptr<TcpSocket> &&socket) noexcept {
+    const int fd = socket->read_fd();
+    if (fd < 0 || static_cast<size_t>(fd) >= m_connections.size()) {
+      return;
+    }
+
+    auto connection = std::make_unique<Connection>(std::move(socket),
+                                                   m_buffer_size,
+                                                   &m_counters);
+    if (m_loop->monitor(connection->socket(), this,
+                        EventLoop::MonitorMode::edge) != OK) {
+      return;
+    }
+
+    m_connections[fd] = std::move(connection);
+    m_accepted.store(m_accepted.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+  }
+
+  void on_read(EventLoop *loop, Channel *channel) noexcept override {
+    echo(loop, channel);
+  }
+
+  /// on_write resumes a connection whose echo stopped because the
+  /// socket was full. In edge mode a write event also comes every time
+  /// the peer reads, which needs no action
+  void on_write(EventLoop *loop, Channel *channel) noexcept override {
+    if (m_connections[channel->read_fd()]->pending()) {
+      echo(loop, channel);
+    }
+  }
+
+  void on_hangup(EventLoop *loop, Channel *channel) noexcept override {
+    close(loop, channel);
+  }
+
+  void on_error(EventLoop *loop, Channel *channel) noexcept override {
+    close(loop, channel);
+  }
+
+ private:
+  /// echo writes back the bytes read on the connection until the
+  /// socket is drained, or it cannot take more bytes, in which case
+  /// echo continues on the next write event
+  void echo(EventLoop *loop, Channel *channel) noexcept {
+    Connection *connection = m_connections[channel->read_fd()].get();
+    bool flushed;
+
+    if (connection->flush(&flushed)->error()) {
+      close(loop, channel);
+      return;
+    }
+
+    while (flushed) {
+      const uint8_t *data;
+      size_t pbytes, wbytes;
+
+      if (connection->peek(&data, &pbytes)->error()) {
+        close(loop, channel);
+        return;
+      }
+
+      if (pbytes == 0) {
+        return;
+      }
+
+      if (connection->write(data, pbytes, &wbytes)->error() ||
+          connection->flush(&flushed)->error()) {
+        close(loop, channel);
+        return;
+      }
+
+      connection->consume(wbytes);
+      if (wbytes < pbytes || connection->drained()) {
+        return;
+      }
+    }
+  }
+
+  void close(EventLoop *loop, Channel *channel) noexcept {
+    const int fd = channel->read_fd();
+    loop->unmonitor(channel);
+    m_connections[fd].reset();
+  }
+
+  EventLoop *m_loop;
+  const size_t m_buffer_size;
+  std::atomic<uint64_t> m_accepted;
+  SocketCounters m_counters;
+  std::vector<std::unique_ptr<Connection>> m_connections;
+};
+
+EchoServer::EchoServer(size_t threads,
+                       const EventLoop::Properties &properties,
+                       size_t buffer_size):
+    m_group(threads, properties, false) {
+  for (size_t i = 0; i < threads; i++) {
+    m_handlers.push_back(std::make_unique<Handler>(
+        m_group.loop(i), properties.max_fd(), buffer_size));
+  }
+}
+
+EchoServer::~EchoServer() {
+  stop();
+  join();
+}
+
+Status EchoServer::listen(const struct sockaddr_in *address,
+                          int backlog) noexcept {
+  return m_group.listen(address, backlog, [this](
+      EventLoop *loop, std::unique_ptr<TcpSocket> &&socket) {
+    for (auto &handler : m_handlers) {
+      if (handler->loop() == loop) {
+        handler->accept(std::move(socket));
+        return;
+      }
+    }
+  });
+}
+
+const struct sockaddr_in *EchoServer::local_address(
+    socklen_t *len) const noexcept {
+  return m_group.local_address(len);
+}
+
+Status EchoServer::start() noexcept {
+  return m_group.start();
+}
+
+void EchoServer::stop() noexcept {
+  m_group.stop();
+}
+
+Status EchoServer::join() noexcept {
+  return m_group.join();
+}
+
+uint64_t EchoServer::accepted() const noexcept {
+  uint64_t accepted = 0;
+  for (const auto &handler : m_handlers) {
+    accepted += handler->accepted();
+  }
+
+  return accepted;
+}
+
+uint64_t EchoServer::reads() const noexcept {
+  uint64_t reads = 0;
+  for (const auto &handler : m_handlers) {
+    reads += handler->counters().reads.load(std::memory_order_relaxed);
+  }
+
+  return reads;
+}
+
+uint64_t EchoServer::writes() const noexcept {
+  uint64_t writes = 0;
+  for (const auto &handler : m_handlers) {
+    writes += handler->counters().writes.load(std::memory_order_relaxed);
+  }
+
+  return writes;
+}
+
+uint64_t EchoServer::wakeups() const noexcept {
+  uint64_t wakeups = 0;
+  for (size_t i = 0; i < m_group.size(); i++) {
+    wakeups += m_group.loop(i)->wakeups();
+  }
+
+  return wakeups;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef LOAD_ECHOSERVER_H_
+#define LOAD_ECHOSERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "os/event_loop.hpp"
+#include "os/event_loop_group.hpp"
+#include "os/status.hpp"
+
+/// EchoServer writes back every byte it reads on the connections it
+/// accepts. It runs on an EventLoopGroup, and each connection is
+/// served by the loop that accepted it with a Connection of
+/// `buffer_size` bytes, monitored in edge mode
+class EchoServer final {
+ public:
+  EchoServer(size_t threads,
+             const EventLoop::Properties &properties,
+             size_t buffer_size);
+  ~EchoServer();
+
+  EchoServer(const EchoServer &server) = delete;
+  EchoServer(EchoServer &&server) = delete;
+  EchoServer& operator=(const EchoServer &server) = delete;
+  EchoServer& operator=(EchoServer &&server) = delete;
+
+  /// listen binds the server to `address`, see EventLoopGroup::listen
+  Status listen(const struct sockaddr_in *address, int backlog) noexcept;
+
+  const struct sockaddr_in *local_address(socklen_t *len) const noexcept;
+
+  Status start() noexcept;
+  void stop() noexcept;
+  Status join() noexcept;
+
+  /// accepted returns the number of connections accepted
+  uint64_t accepted() const noexcept;
+
+  /// reads and writes return the system calls made by the server
+  /// to read from and write to its connections
+  uint64_t reads() const noexcept;
+  uint64_t writes() const noexcept;
+
+  /// wakeups returns the number of wakeups of the loops of the server
+  uint64_t wakeups() const noexcept;
+
+ private:
+  class Handler;
+
+  // the handlers own the connections, so they are destroyed
+  // after the loops that dispatch their events are stopped
+  std::vector<std::unique_ptr<Handler>> m_handlers;
+  EventLoopGroup m_group;
+};
+
+#endif  // LOAD_ECHOSERVER_H_
@@ -0,0 +1,83 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "histogram.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+
+Histogram::Histogram(uint64_t max, int digits):
+    m_max(std::max(max, static_cast<uint64_t>(1))),
+    m_digits(std::min(std::max(digits, 1), 5)),
+    m_count(0),
+    m_sum(0),
+    m_min(UINT64_MAX),
+    m_max_recorded(0) {
+  // the first bucket counts every value below 2 * 10^digits
+  // on its own, which keeps the relative error of the values
+  // in the buckets after it below 10^-digits
+  const uint64_t sub_count = 2 * static_cast<uint64_t>(pow(10, m_digits));
+  m_sub_bits = 64 - __builtin_clzll(sub_count - 1);
+  m_sub_mask = (static_cast<uint64_t>(1) << m_sub_bits) - 1;
+  m_counts.resize(index(m_max) + 1, 0);
+}
+
+bool Histogram::merge(const Histogram &histogram) noexcept {
+  if (histogram.m_max != m_max || histogram.m_digits != m_digits) {
+    return false;
+  }
+
+  for (size_t i = 0; i < m_counts.size(); i++) {
+    m_counts[i] += histogram.m_counts[i];
+  }
+
+  m_count += histogram.m_count;
+  m_sum += histogram.m_sum;
+  m_min = std::min(m_min, histogram.m_min);
+  m_max_recorded = std::max(m_max_recorded, histogram.m_max_recorded);
+  return true;
+}
+
+void Histogram::reset() noexcept {
+  std::fill(m_counts.begin(), m_counts.end(), 0);
+  m_count = 0;
+  m_sum = 0;
+  m_min = UINT64_MAX;
+  m_max_recorded = 0;
+}
+
+uint64_t Histogram::value_at(double percentile) const noexcept {
+  if (m_count == 0) {
+    return 0;
+  }
+
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  uint64_t rank = static_cast<uint64_t>(ceil(percentile / 100 * m_count));
+  rank = std::max(rank, static_cast<uint64_t>(1));
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < m_counts.size(); i++) {
+    seen += m_counts[i];
+    if (seen >= rank) {
+      // no value above the highest recorded is reported
+      return std::min(highest(i), m_max_recorded);
+    }
+  }
+
+  return m_max_recorded;
+}
+
+double Histogram::mean() const noexcept {
+  return m_count > 0 ? static_cast<double>(m_sum) / m_count : 0;
+}
+
+uint64_t Histogram::highest(size_t index) const noexcept {
+  const size_t half = static_cast<size_t>(1) << (m_sub_bits - 1);
+  if (index < 2 * half) {
+    return index;
+  }
+
+  const int bucket = static_cast<int>(index / half) - 1;
+  const uint64_t sub = index - bucket * half;
+  return ((sub + 1) << bucket) - 1;
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef LOAD_HISTOGRAM_H_
+#define LOAD_HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/// Histogram is a high dynamic range histogram of values from 0 to
+/// a maximum, that keeps `digits` significant decimal digits of each
+/// value. Values are counted in buckets that double in width: the
+/// first bucket counts each value below 2 * 10^digits on its own,
+/// rounded up to a power of two, and every bucket after it covers
+/// twice the range of the one before with the same number of counters,
+/// so the relative error of any value stays below 10^-digits. Recording
+/// a value is a few shifts and an increment, without allocations.
+///
+/// Histogram is not a multi-thread safe class. Threads are expected
+/// to record into histograms of their own and `merge` them
+class Histogram final {
+ public:
+  /// values above `max` are recorded as `max`. `digits`
+  /// is at least 1 and at most 5
+  explicit Histogram(uint64_t max, int digits = 3);
+
+  Histogram(const Histogram &histogram) = default;
+  Histogram(Histogram &&histogram) = default;
+  Histogram& operator=(const Histogram &histogram) = default;
+  Histogram& operator=(Histogram &&histogram) = default;
+
+  inline void record(uint64_t value) noexcept {
+    value = value > m_max ? m_max : value;
+    m_counts[index(value)]++;
+    m_count++;
+    m_sum += value;
+    m_min = value < m_min ? value : m_min;
+    m_max_recorded = value > m_max_recorded ? value : m_max_recorded;
+  }
+
+  /// merge adds the values recorded by `histogram`, which
+  /// needs to have been created with the same arguments.
+  /// It returns false otherwise
+  bool merge(const Histogram &histogram) noexcept;
+
+  /// reset discards all the values recorded
+  void reset() noexcept;
+
+  /// value_at returns the smallest value such that `percentile`
+  /// percent of the values recorded are lower or equal to it, up to
+  /// the precision of the histogram. It returns 0 if it is empty
+  uint64_t value_at(double percentile) const noexcept;
+
+  inline uint64_t count() const noexcept {
+    return m_count;
+  }
+
+  /// min returns the lowest value recorded,
+  /// or 0 if the histogram is empty
+  inline uint64_t min() const noexcept {
+    return m_count > 0 ? m_min : 0;
+  }
+
+  /// max returns the highest value recorded
+  inline uint64_t max() const noexcept {
+    return m_max_recorded;
+  }
+
+  double mean() const noexcept;
+
+ private:
+  inline size_t index(uint64_t value) const noexcept {
+    // the bucket is given by the highest bit set above the
+    // first bucket, and the counter by the bits below it
+    const int msb = 63 - __builtin_clzll(value | m_sub_mask);
+    const int bucket = msb - m_sub_bits + 1;
+    return (static_cast<size_t>(bucket) << (m_sub_bits - 1)) +
+        static_cast<size_t>(value >> bucket);
+  }
+
+  /// highest returns the highest value counted at `index`
+  uint64_t highest(size_t index) const noexcept;
+
+  uint64_t m_max;
+  int m_digits;
+  int m_sub_bits;
+  uint64_t m_sub_mask;
+
+  uint64_t m_count;
+  uint64_t m_sum;
+  uint64_t m_min;
+  uint64_t m_max_recorded;
+  std::vector<uint64_t> m_counts;
+};
+
+#endif  // LOAD_HISTOGRAM_H_
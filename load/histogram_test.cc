@@ -0,0 +1,99 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include "histogram.hpp"
+
+static bool within(uint64_t value, uint64_t expected, double error) {
+  const double diff = value > expected ? value - expected : expected - value;
+  return diff <= expected * error;
+}
+
+static int test_histogram_empty() {
+  Histogram histogram(1000000);
+
+  ASSERT_EQ(histogram.count(), 0);
+  ASSERT_EQ(histogram.min(), 0);
+  ASSERT_EQ(histogram.max(), 0);
+  ASSERT_EQ(histogram.value_at(50), 0);
+  ASSERT_TRUE(histogram.mean() == 0);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_histogram_exact_small_values() {
+  Histogram histogram(1000000);
+
+  for (uint64_t i = 1; i <= 1000; i++) {
+    histogram.record(i);
+  }
+
+  ASSERT_EQ(histogram.count(), 1000);
+  ASSERT_EQ(histogram.min(), 1);
+  ASSERT_EQ(histogram.max(), 1000);
+  ASSERT_EQ(histogram.value_at(50), 500);
+  ASSERT_EQ(histogram.value_at(99), 990);
+  ASSERT_EQ(histogram.value_at(100), 1000);
+  ASSERT_EQ(histogram.value_at(0), 1);
+  ASSERT_TRUE(histogram.mean() == 500.5);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_histogram_precision() {
+  const uint64_t max = 60ULL * 1000 * 1000 * 1000;
+  Histogram histogram(max, 3);
+
+  for (uint64_t i = 1; i <= 100000; i++) {
+    histogram.record(i * 1000);
+  }
+
+  ASSERT_TRUE(within(histogram.value_at(50), 50000000, 0.001));
+  ASSERT_TRUE(within(histogram.value_at(99), 99000000, 0.001));
+  ASSERT_TRUE(within(histogram.value_at(99.9), 99900000, 0.001));
+  ASSERT_EQ(histogram.value_at(100), 100000000);
+
+  // values above the maximum are recorded as the maximum
+  histogram.record(max * 2);
+  ASSERT_EQ(histogram.max(), max);
+  ASSERT_EQ(histogram.value_at(100), max);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_histogram_merge_reset() {
+  Histogram first(1000000);
+  Histogram second(1000000);
+  Histogram other(1000);
+
+  for (uint64_t i = 1; i <= 500; i++) {
+    first.record(i);
+    second.record(i + 500);
+  }
+
+  ASSERT_TRUE(first.merge(second));
+  ASSERT_FALSE(first.merge(other));
+  ASSERT_EQ(first.count(), 1000);
+  ASSERT_EQ(first.min(), 1);
+  ASSERT_EQ(first.max(), 1000);
+  ASSERT_EQ(first.value_at(75), 750);
+
+  first.reset();
+  ASSERT_EQ(first.count(), 0);
+  ASSERT_EQ(first.max(), 0);
+  ASSERT_EQ(first.value_at(75), 0);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_histogram_empty());
+  TEST_RUN(ctx, test_histogram_exact_small_values());
+  TEST_RUN(ctx, test_histogram_precision());
+  TEST_RUN(ctx, test_histogram_merge_reset());
+
+  return TEST_RELEASE(ctx);
+}
@@ -0,0 +1,474 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "load_client.hpp"
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+#include <system_error>
+
+#include "status.hpp"
+
+/// kTickInterval is the interval at which the client
+/// schedules requests and checks for changes of its phase
+static constexpr long kTickInterval = 1000000;
+
+/// kMaxLatency is the highest latency the histograms record
+static constexpr uint64_t kMaxLatency = 60ULL * 1000 * 1000 * 1000;
+
+static uint64_t now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/// source_address returns the loopback address the connection
+/// of index `index` is bound to. Linux routes the whole 127.0.0.0/8
+/// to loopback, elsewhere only 127.0.0.1 can be bound to
+static uint32_t source_address(size_t index) {
+#ifdef __linux__
+  return INADDR_LOOPBACK + index / LoadClient::CONNECTIONS_PER_ADDRESS;
+#else
+  (void)(index);
+  return INADDR_LOOPBACK;
+#endif
+}
+
+/// Ticker is a channel on a timerfd that becomes readable
+/// every kTickInterval nanoseconds. timerfd is Linux only,
+/// and elsewhere a Ticker cannot be opened
+class Ticker final : public Channel {
+ public:
+  static std::unique_ptr<Ticker> open() {
+#ifndef __linux__
+    return nullptr;
+#else
+    const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1) {
+      return nullptr;
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = kTickInterval;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(fd, 0, &spec, nullptr) == -1) {
+      ::close(fd);
+      return nullptr;
+    }
+
+    return std::unique_ptr<Ticker>(new Ticker(fd));
+#endif
+  }
+
+  ~Ticker() {
+    ::close(m_fd);
+  }
+
+  Ticker(const Ticker &ticker) = delete;
+  Ticker& operator=(const Ticker &ticker) = delete;
+
+  /// read reads the number of expirations since the last read
+  Status read(uint8_t *dst, size_t len, size_t *rbytes) noexcept override {
+    const ssize_t res = ::read(m_fd, dst, len);
+    *rbytes = res > 0 ? res : 0;
+    return OK;
+  }
+
+  Status write(const uint8_t *src, size_t len, size_t *wbytes) noexcept override {
+    (void)(src);
+    (void)(len);
+    *wbytes = 0;
+    return OK;
+  }
+
+  inline int read_fd() const noexcept override {
+    return m_fd;
+  }
+
+  inline int write_fd() const noexcept override {
+    return m_fd;
+  }
+
+  inline bool wait_write_event() const noexcept override {
+    return false;
+  }
+
+  inline bool wait_read_event() const noexcept override {
+    return false;
+  }
+
+  inline const struct sockaddr_in* local_address(
+      socklen_t *len) const noexcept override {
+    *len = 0;
+    return nullptr;
+  }
+
+  inline const struct sockaddr_in* remote_address(
+      socklen_t *len) const noexcept override {
+    *len = 0;
+    return nullptr;
+  }
+
+ private:
+  explicit Ticker(int fd):
+      m_fd(fd) { }
+
+  int m_fd;
+};
+
+/// ClientConnection is a connection with the state
+/// of the request in flight on it, if any
+class ClientConnection final : public Connection {
+ public:
+  ClientConnection(std::unique_ptr<TcpSocket> &&socket,
+                   size_t buffer_size,
+                   SocketCounters *counters):
+      Connection(std::move(socket), buffer_size, counters),
+      connecting(true),
+      busy(false),
+      scheduled(0),
+      received(0) { }
+
+  bool connecting;
+  bool busy;
+  uint64_t scheduled;
+  size_t received;
+};
+
+LoadClient::LoadClient(const Options &options,
+                       const EventLoop::Properties &properties,
+                       const struct sockaddr_in *server):
+    m_options(options),
+    m_phase(Phase::connecting),
+    m_connected(0),
+    m_failed(0),
+    m_requests(0),
+    m_skipped(0),
+    m_result(OK),
+    m_opened(0),
+    m_connecting(0),
+    m_running(false),
+    m_start(0),
+    m_scheduled(0),
+    m_payload(new uint8_t[options.message_size]),
+    m_histogram(kMaxLatency),
+    m_connections(properties.max_fd()),
+    m_loop(properties) {
+  memcpy(&m_server, server, sizeof(m_server));
+  memset(m_payload.get(), 'x', options.message_size);
+}
+
+LoadClient::~LoadClient() {
+  join();
+}
+
+Status LoadClient::start() noexcept {
+  m_ticker = Ticker::open();
+  if (!m_ticker) {
+    return LoadTickerFailed;
+  }
+
+  Status status = m_loop.rmonitor(m_ticker.get(), this,
+                                  EventLoop::MonitorMode::level);
+  if (status->error()) {
+    return status;
+  }
+
+  try {
+    m_thread = std::thread(&LoadClient::run, this);
+  } catch (const std::system_error &e) {
+    return LoadClientStartFailed;
+  }
+
+  return OK;
+}
+
+void LoadClient::begin() noexcept {
+  m_phase = Phase::running;
+}
+
+void LoadClient::end() noexcept {
+  m_phase = Phase::ended;
+}
+
+Status LoadClient::join() noexcept {
+  m_loop.stop();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+
+  return m_result;
+}
+
+void LoadClient::run() noexcept {
+  connect();
+  m_result = m_loop.run();
+}
+
+void LoadClient::connect() noexcept {
+  while (m_opened < m_options.connections && m_connecting < MAX_CONNECTING) {
+    const size_t index = m_options.first + m_opened++;
+    std::unique_ptr<TcpSocket> socket;
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(source_address(index));
+    address.sin_port = 0;
+
+    try {
+      socket = TcpSocket::open_ptr(SocketDomain::IPv4);
+    } catch (const SocketException &e) {
+      increment(&m_failed);
+      continue;
+    }
+
+    const int fd = socket->read_fd();
+    if (static_cast<size_t>(fd) >= m_connections.size() ||
+        socket->bind(&address) != OK ||
+        socket->connect(&m_server) != OK) {
+      increment(&m_failed);
+      continue;
+    }
+
+    auto connection = std::make_unique<ClientConnection>(
+        std::move(socket), m_options.buffer_size, &m_counters);
+    if (m_loop.monitor(connection->socket(), this,
+                       EventLoop::MonitorMode::edge) != OK) {
+      increment(&m_failed);
+      continue;
+    }
+
+    m_connections[fd] = std::move(connection);
+    m_connecting++;
+  }
+
+  if (m_connecting == 0 && m_opened == m_options.connections &&
+      m_phase.load() == Phase::connecting) {
+    m_phase = Phase::ready;
+  }
+}
+
+void LoadClient::tick() noexcept {
+  const Phase phase = m_phase.load();
+  if (phase != Phase::running) {
+    return;
+  }
+
+  const uint64_t now = now_ns();
+  if (!m_running) {
+    // with no rate, every connection sends its
+    // first request on the first tick
+    m_running = true;
+    m_start = now;
+    while (m_options.rate == 0 && !m_idle.empty()) {
+      ClientConnection *connection = m_idle.back();
+      m_idle.pop_back();
+      send(connection, now);
+    }
+  }
+
+  if (m_options.rate == 0) {
+    return;
+  }
+
+  // the requests due since the start are scheduled at evenly
+  // spaced times, whether there are idle connections or not. A
+  // backlog longer than the connections is not sent any sooner,
+  // so the requests that find it full are skipped
+  const double interval = 1e9 / m_options.rate;
+  const uint64_t due = static_cast<uint64_t>((now - m_start) / interval);
+  for (; m_scheduled < due; m_scheduled++) {
+    if (m_backlog.size() >= m_options.connections) {
+      increment(&m_skipped);
+      continue;
+    }
+
+    m_backlog.push_back(m_start + static_cast<uint64_t>(m_scheduled * interval));
+  }
+
+  while (!m_backlog.empty() && !m_idle.empty()) {
+    ClientConnection *connection = m_idle.back();
+    m_idle.pop_back();
+    const uint64_t scheduled = m_backlog.front();
+    m_backlog.pop_front();
+    send(connection, scheduled);
+  }
+}
+
+bool LoadClient::send(ClientConnection *connection,
+                      uint64_t scheduled) noexcept {
+  size_t wbytes;
+  bool flushed;
+
+  connection->busy = true;
+  connection->scheduled = scheduled;
+  connection->received = 0;
+
+  if (connection->write(m_payload.get(), m_options.message_size,
+                        &wbytes)->error() ||
+      wbytes < m_options.message_size ||
+      connection->flush(&flushed)->error()) {
+    close(connection);
+    return false;
+  }
+
+  return true;
+}
+
+void LoadClient::receive(ClientConnection *connection) noexcept {
+  for (;;) {
+    const uint8_t *data;
+    size_t pbytes;
+
+    if (connection->peek(&data, &pbytes)->error()) {
+      close(connection);
+      return;
+    }
+
+    if (pbytes == 0) {
+      return;
+    }
+
+    connection->received += connection->consume(pbytes);
+    if (connection->received >= m_options.message_size &&
+        !next(connection, now_ns())) {
+      return;
+    }
+
+    if (connection->drained()) {
+      return;
+    }
+  }
+}
+
+bool LoadClient::next(ClientConnection *connection, uint64_t now) noexcept {
+  const Phase phase = m_phase.load();
+
+  if (phase == Phase::running && connection->busy) {
+    m_histogram.record(now - connection->scheduled);
+    increment(&m_requests);
+  }
+
+  connection->busy = false;
+  connection->received = 0;
+
+  if (phase == Phase::running && m_options.rate == 0) {
+    return send(connection, now);
+  }
+
+  if (phase == Phase::running && !m_backlog.empty()) {
+    const uint64_t scheduled = m_backlog.front();
+    m_backlog.pop_front();
+    return send(connection, scheduled);
+  }
+
+  m_idle.push_back(connection);
+  return true;
+}
+
+void LoadClient::close(ClientConnection *connection) noexcept {
+  const int fd = connection->socket()->read_fd();
+
+  for (size_t i = 0; i < m_idle.size(); i++) {
+    if (m_idle[i] == connection) {
+      m_idle[i] = m_idle.back();
+      m_idle.pop_back();
+      break;
+    }
+  }
+
+  if (connection->connecting) {
+    m_connecting--;
+  } else {
+    m_connected.store(m_connected.load(std::memory_order_relaxed) - 1,
+                      std::memory_order_relaxed);
+  }
+
+  increment(&m_failed);
+  m_loop.unmonitor(connection->socket());
+  m_connections[fd].reset();
+  connect();
+}
+
+void LoadClient::on_read(EventLoop *loop, Channel *channel) noexcept {
+  (void)(loop);
+
+  if (channel == m_ticker.get()) {
+    uint64_t expirations;
+    size_t rbytes;
+    m_ticker->read(reinterpret_cast<uint8_t*>(&expirations),
+                   sizeof(expirations), &rbytes);
+    m_counters.add(&m_counters.reads, 1);
+    tick();
+    return;
+  }
+
+  ClientConnection *connection = m_connections[channel->read_fd()].get();
+  if (!connection->connecting) {
+    receive(connection);
+  }
+}
+
+void LoadClient::on_write(EventLoop *loop, Channel *channel) noexcept {
+  (void)(loop);
+
+  ClientConnection *connection = m_connections[channel->read_fd()].get();
+  bool flushed;
+
+  if (!connection->connecting) {
+    if (connection->flush(&flushed)->error()) {
+      close(connection);
+    }
+
+    return;
+  }
+
+  // the first write event of a connection tells whether it has
+  // been established. The event may also be left over from a closed
+  // connection that had the same file descriptor, in which case the
+  // connection has no peer yet and its own event is still to come
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (getsockopt(channel->write_fd(), SOL_SOCKET, SO_ERROR,
+                 &err, &len) == -1 || err != 0) {
+    close(connection);
+    return;
+  }
+
+  struct sockaddr_in peer;
+  len = sizeof(peer);
+  if (getpeername(channel->write_fd(),
+                  reinterpret_cast<struct sockaddr*>(&peer), &len) == -1) {
+    return;
+  }
+
+  connection->connecting = false;
+  m_connecting--;
+  increment(&m_connected);
+  m_idle.push_back(connection);
+  connect();
+
+  if (m_running && m_options.rate == 0) {
+    m_idle.pop_back();
+    send(connection, now_ns());
+  }
+}
+
+void LoadClient::on_hangup(EventLoop *loop, Channel *channel) noexcept {
+  (void)(loop);
+  close(m_connections[channel->read_fd()].get());
+}
+
+void LoadClient::on_error(EventLoop *loop, Channel *channel) noexcept {
+  (void)(loop);
+  close(m_connections[channel->read_fd()].get());
+}
@@ -0,0 +1,202 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef LOAD_LOADCLIENT_H_
+#define LOAD_LOADCLIENT_H_
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "connection.hpp"
+#include "histogram.hpp"
+#include "os/event_handler.hpp"
+#include "os/event_loop.hpp"
+#include "os/status.hpp"
+
+class ClientConnection;
+class Ticker;
+
+/// LoadClient opens connections to an echo server from an EventLoop
+/// that runs on its own thread, and sends requests of a fixed size on
+/// them. A request completes when all its bytes have been echoed back,
+/// and its latency is recorded in a Histogram.
+///
+/// Without a rate, each connection sends its next request as soon as
+/// the previous one completes. With a rate, requests are scheduled at
+/// evenly spaced times and sent on the first idle connection. Their
+/// latency is measured from the time they were scheduled, so the time
+/// a request waits for an idle connection when the server falls behind
+/// is part of its latency. The backlog of requests waiting for a
+/// connection holds at most one per connection, and the requests
+/// scheduled while it is full are skipped and only counted.
+///
+/// LoadClient is driven from another thread: `start` opens the
+/// connections, `begin` starts sending and recording requests once
+/// `ready`, and `end` stops it. The histogram is read after `join`
+class LoadClient final : public EventHandler {
+ public:
+  struct Options {
+    /// connections is the number of connections to open
+    size_t connections;
+
+    /// first is the index of the first connection of the client
+    /// among all the clients, which selects its source addresses
+    size_t first;
+
+    /// message_size is the size of a request, and of its response
+    size_t message_size;
+
+    /// buffer_size is the size of the buffers of each connection
+    size_t buffer_size;
+
+    /// rate is the number of requests per second the client
+    /// sends, or 0 to send them back to back on each connection
+    double rate;
+  };
+
+  /// CONNECTIONS_PER_ADDRESS is the number of connections opened from
+  /// each source address, 127.0.0.1, 127.0.0.2 and so on, so that
+  /// there are enough ephemeral ports for all of them. Only Linux
+  /// binds the addresses after 127.0.0.1, elsewhere all the
+  /// connections are opened from it
+  static const size_t CONNECTIONS_PER_ADDRESS = 16384;
+
+  /// MAX_CONNECTING is the maximum number of connections that are
+  /// being established at the same time, so that the accept queue
+  /// of the server does not overflow
+  static const size_t MAX_CONNECTING = 512;
+
+  LoadClient(const Options &options,
+             const EventLoop::Properties &properties,
+             const struct sockaddr_in *server);
+  ~LoadClient();
+
+  LoadClient(const LoadClient &client) = delete;
+  LoadClient(LoadClient &&client) = delete;
+  LoadClient& operator=(const LoadClient &client) = delete;
+  LoadClient& operator=(LoadClient &&client) = delete;
+
+  /// start starts the thread of the client,
+  /// which opens all its connections
+  Status start() noexcept;
+
+  /// ready returns true once every connection
+  /// has been established or has failed
+  inline bool ready() const noexcept {
+    return m_phase.load() != Phase::connecting;
+  }
+
+  /// begin starts sending requests and recording their latency
+  void begin() noexcept;
+
+  /// end stops sending requests and recording their latency
+  void end() noexcept;
+
+  /// join stops the loop of the client and waits for its thread
+  Status join() noexcept;
+
+  inline size_t connected() const noexcept {
+    return m_connected.load(std::memory_order_relaxed);
+  }
+
+  /// failed returns the number of connections that could not be
+  /// established, or were closed while the client was running
+  inline size_t failed() const noexcept {
+    return m_failed.load(std::memory_order_relaxed);
+  }
+
+  /// requests returns the number of requests recorded
+  inline uint64_t requests() const noexcept {
+    return m_requests.load(std::memory_order_relaxed);
+  }
+
+  /// skipped returns the number of requests that were scheduled
+  /// while the backlog was full, and were neither sent nor recorded
+  inline uint64_t skipped() const noexcept {
+    return m_skipped.load(std::memory_order_relaxed);
+  }
+
+  /// reads and writes return the system calls made by the client
+  /// to read from and write to its connections and its timer, as
+  /// estimated by the connections from the bytes they transferred
+  inline uint64_t reads() const noexcept {
+    return m_counters.reads.load(std::memory_order_relaxed);
+  }
+
+  inline uint64_t writes() const noexcept {
+    return m_counters.writes.load(std::memory_order_relaxed);
+  }
+
+  inline uint64_t wakeups() const noexcept {
+    return m_loop.wakeups();
+  }
+
+  /// histogram returns the latencies in nanoseconds
+  /// of the requests recorded, once the client is joined
+  inline const Histogram &histogram() const noexcept {
+    return m_histogram;
+  }
+
+  void on_read(EventLoop *loop, Channel *channel) noexcept override;
+  void on_write(EventLoop *loop, Channel *channel) noexcept override;
+  void on_hangup(EventLoop *loop, Channel *channel) noexcept override;
+  void on_error(EventLoop *loop, Channel *channel) noexcept override;
+
+ private:
+  enum class Phase {
+    connecting,
+    ready,
+    running,
+    ended
+  };
+
+  void run() noexcept;
+  void connect() noexcept;
+  void tick() noexcept;
+  // send and next return false if they closed the connection
+  bool send(ClientConnection *connection, uint64_t scheduled) noexcept;
+  void receive(ClientConnection *connection) noexcept;
+  bool next(ClientConnection *connection, uint64_t now) noexcept;
+  void close(ClientConnection *connection) noexcept;
+
+  template <typename T>
+  static inline void increment(std::atomic<T> *counter) noexcept {
+    counter->store(counter->load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+
+  const Options m_options;
+  struct sockaddr_in m_server;
+
+  std::atomic<Phase> m_phase;
+  std::atomic<size_t> m_connected;
+  std::atomic<size_t> m_failed;
+  std::atomic<uint64_t> m_requests;
+  std::atomic<uint64_t> m_skipped;
+  SocketCounters m_counters;
+  Status m_result;
+
+  size_t m_opened;
+  size_t m_connecting;
+  bool m_running;
+  uint64_t m_start;
+  uint64_t m_scheduled;
+
+  std::unique_ptr<uint8_t[]> m_payload;
+  Histogram m_histogram;
+  std::vector<std::unique_ptr<ClientConnection>> m_connections;
+  std::vector<ClientConnection*> m_idle;
+  std::deque<uint64_t> m_backlog;
+
+  EventLoop m_loop;
+  std::unique_ptr<Ticker> m_ticker;
+  std::thread m_thread;
+};
+
+#endif  // LOAD_LOADCLIENT_H_
@@ -0,0 +1,264 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "echo_server.hpp"
+#include "flag/flag.hpp"
+#include "histogram.hpp"
+#include "load_client.hpp"
+#include "os/aio.hpp"
+
+/// kReservedFDs is the number of file descriptors needed besides
+/// the two of each connection and the ones of the loops, for the
+/// standard streams and the descriptors opened by the runtime
+static constexpr rlim_t kReservedFDs = 64;
+
+/// kLoopFDs is the number of file descriptors needed by each loop,
+/// for its event queue and its wakeup pipe, and the listening socket
+/// of a server loop or the timer of a client loop
+static constexpr rlim_t kLoopFDs = 8;
+
+/// Counters are the system calls made by the server and the clients.
+/// Each wakeup of a loop is a call to wait for events, and is counted
+/// by the loop. Reads and writes are not counted by the sockets, but
+/// estimated by the connections from the bytes each call transferred
+struct Counters {
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t wakeups;
+};
+
+static Counters read_counters(
+    const EchoServer &server,
+    const std::vector<std::unique_ptr<LoadClient>> &clients) {
+  Counters counters = {server.reads(), server.writes(), server.wakeups()};
+  for (const auto &client : clients) {
+    counters.reads += client->reads();
+    counters.writes += client->writes();
+    counters.wakeups += client->wakeups();
+  }
+
+  return counters;
+}
+
+static uint64_t now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static double per_request(uint64_t count, uint64_t requests) {
+  return requests == 0 ? 0 : static_cast<double>(count) / requests;
+}
+
+static void print_latency(const char *name, uint64_t ns) {
+  printf("  %-8s %12.1f us\n", name, ns / 1000.0);
+}
+
+int main(int argc, const char *argv[]) {
+  uint32_t connections = 1000;
+  uint32_t client_threads = 1;
+  uint32_t server_threads = 1;
+  uint64_t rate = 0;
+  uint32_t message_size = 64;
+  uint32_t buffer_size = 4096;
+  std::chrono::nanoseconds duration = std::chrono::seconds(10);
+  bool help = false;
+
+  Flag flags;
+  flags.uint32_var(&connections, 'c', "connections",
+                   "number of connections to open");
+  flags.uint32_var(&client_threads, 't', "client-threads",
+                   "number of client threads");
+  flags.uint32_var(&server_threads, 's', "server-threads",
+                   "number of server threads");
+  flags.uint64_var(&rate, 'r', "rate",
+                   "requests per second, 0 to send them back to back");
+  flags.duration_var(&duration, 'd', "duration",
+                     "duration of the measurement");
+  flags.uint32_var(&message_size, 'm', "message-size",
+                   "size of the requests in bytes");
+  flags.uint32_var(&buffer_size, 'b', "buffer-size",
+                   "size of the buffers of each connection in bytes");
+  flags.bool_var(&help, 'h', "help", "prints this help");
+
+  if (!flags.parse(argc, argv)) {
+    fprintf(stderr, "%s\n", flags.error());
+    flags.print_help(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (help) {
+    flags.print_help(argv[0]);
+    return EXIT_SUCCESS;
+  }
+
+  if (connections == 0 || client_threads == 0 || server_threads == 0 ||
+      message_size == 0 || buffer_size == 0) {
+    fprintf(stderr, "connections, threads and sizes must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  // both ends of every connection are in this process
+  struct rlimit limit;
+  const rlim_t required = 2 * static_cast<rlim_t>(connections) + kReservedFDs +
+      kLoopFDs * (static_cast<rlim_t>(client_threads) + server_threads);
+  if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+    perror("getrlimit");
+    return EXIT_FAILURE;
+  }
+
+  // the soft limit is only raised as far as needed
+  if (limit.rlim_cur < required) {
+    limit.rlim_cur = std::min(limit.rlim_max, required);
+  }
+
+  if (setrlimit(RLIMIT_NOFILE, &limit) == -1 || limit.rlim_cur < required) {
+    fprintf(stderr, "%u connections need %lu file descriptors, "
+            "but the limit is %lu\n", connections,
+            static_cast<unsigned long>(required),
+            static_cast<unsigned long>(limit.rlim_cur));
+    return EXIT_FAILURE;
+  }
+
+  if (aio_handle_signals() == -1) {
+    perror("aio_handle_signals");
+    return EXIT_FAILURE;
+  }
+
+  // the handles of every loop and the connections of every
+  // client and server thread are indexed by descriptor, so they
+  // are sized for the descriptors the run needs, not the limit
+  const rlim_t fds = std::min(limit.rlim_cur, required);
+  const int max_fd = fds > INT32_MAX ? INT32_MAX : static_cast<int>(fds);
+  EventLoop::Properties properties = EventLoop::Properties::Builder()
+      .max_fd(max_fd)
+      .event_queue_size(1024)
+      .build();
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  EchoServer server(server_threads, properties, buffer_size);
+  Status status = server.listen(&address, 4096);
+  if (status->error()) {
+    fprintf(stderr, "%s\n", status->msg());
+    return EXIT_FAILURE;
+  }
+
+  status = server.start();
+  if (status->error()) {
+    fprintf(stderr, "%s\n", status->msg());
+    return EXIT_FAILURE;
+  }
+
+  socklen_t len;
+  struct sockaddr_in server_address;
+  memcpy(&server_address, server.local_address(&len), sizeof(server_address));
+
+  std::vector<std::unique_ptr<LoadClient>> clients;
+  size_t first = 0;
+  for (uint32_t i = 0; i < client_threads; i++) {
+    LoadClient::Options options;
+    options.connections = connections / client_threads +
+        (i < connections % client_threads ? 1 : 0);
+    options.first = first;
+    options.message_size = message_size;
+    options.buffer_size = buffer_size;
+    options.rate = static_cast<double>(rate) / client_threads;
+    first += options.connections;
+
+    clients.push_back(std::make_unique<LoadClient>(options, properties,
+                                                   &server_address));
+    status = clients.back()->start();
+    if (status->error()) {
+      fprintf(stderr, "%s\n", status->msg());
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (const auto &client : clients) {
+    while (!client->ready()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+
+  const Counters before = read_counters(server, clients);
+  const uint64_t start = now_ns();
+  for (const auto &client : clients) {
+    client->begin();
+  }
+
+  std::this_thread::sleep_for(duration);
+
+  for (const auto &client : clients) {
+    client->end();
+  }
+
+  const uint64_t elapsed = now_ns() - start;
+  const Counters after = read_counters(server, clients);
+
+  size_t connected = 0, failed = 0;
+  uint64_t requests = 0, skipped = 0;
+  for (const auto &client : clients) {
+    status = client->join();
+    if (status->error()) {
+      fprintf(stderr, "%s\n", status->msg());
+    }
+
+    connected += client->connected();
+    failed += client->failed();
+    requests += client->requests();
+    skipped += client->skipped();
+  }
+
+  Histogram histogram(clients.front()->histogram());
+  for (size_t i = 1; i < clients.size(); i++) {
+    histogram.merge(clients[i]->histogram());
+  }
+
+  server.stop();
+  server.join();
+
+  printf("connections: %zu established, %zu failed, %" PRIu64 " accepted\n",
+         connected, failed, server.accepted());
+  printf("requests:    %" PRIu64 " in %.2f s, %.0f req/s, "
+         "%" PRIu64 " skipped with a full backlog\n", requests,
+         elapsed / 1e9, requests / (elapsed / 1e9), skipped);
+  printf("latency:\n");
+  print_latency("min", histogram.min());
+  print_latency("p50", histogram.value_at(50));
+  print_latency("p90", histogram.value_at(90));
+  print_latency("p99", histogram.value_at(99));
+  print_latency("p99.9", histogram.value_at(99.9));
+  print_latency("p99.99", histogram.value_at(99.99));
+  print_latency("max", histogram.max());
+  printf("  %-8s %12.1f us\n", "mean", histogram.mean() / 1000.0);
+
+  const uint64_t reads = after.reads - before.reads;
+  const uint64_t writes = after.writes - before.writes;
+  const uint64_t wakeups = after.wakeups - before.wakeups;
+  printf("syscalls per request (reads and writes estimated by SocketRef, not traced):\n");
+  printf("  %-8s %12.2f\n", "reads", per_request(reads, requests));
+  printf("  %-8s %12.2f\n", "writes", per_request(writes, requests));
+  printf("  %-8s %12.2f\n", "wakeups", per_request(wakeups, requests));
+  printf("  %-8s %12.2f\n", "total",
+         per_request(reads + writes + wakeups, requests));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,10 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "status.hpp"
+
+Status LoadTickerFailed =
+    new StatusClass(1, "[LoadTickerFailed] load client "
+                    "failed to set up its timer");
+Status LoadClientStartFailed =
+    new StatusClass(1, "[LoadClientStartFailed] load client "
+                    "failed to start its thread");
@@ -0,0 +1,6 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "status/status.hpp"
+
+extern Status LoadTickerFailed;
+extern Status LoadClientStartFailed;
@@ -0,0 +1,640 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "async_log.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/// RecordHeader starts every record in a ring. A record with
+/// PADDING args only fills the end of the ring, so that no
+/// record wraps around it
+struct RecordHeader {
+  uint32_t size;
+  uint32_t nargs;
+  const LogSite *site;
+  uint64_t timestamp;
+};
+
+/// ArgHeader starts every argument of a record. It is followed
+/// by the 8 bytes of the value, or by the bytes of a string
+/// padded to 8 bytes
+struct ArgHeader {
+  LogArgType type;
+  uint32_t len;
+};
+
+static constexpr uint32_t PADDING = UINT32_MAX;
+static constexpr size_t MAX_STRING_LEN = 1024;
+static constexpr size_t LINE_SIZE = 2048;
+
+static inline size_t align8(size_t len) {
+  return (len + 7) & ~static_cast<size_t>(7);
+}
+
+/// Ring is the single producer, single consumer ring of
+/// a thread. The producer and the consumer offsets are on
+/// different cache lines, and the producer keeps a copy of
+/// the consumer offset so that it reads the shared one only
+/// when the ring looks full
+class Ring final {
+ public:
+  Ring():
+      m_closed(false),
+      m_dropped(0),
+      m_head(0),
+      m_cached_tail(0),
+      m_tail(0) { }
+
+  Ring(const Ring &ring) = delete;
+  Ring& operator=(const Ring &ring) = delete;
+
+  /// reserve returns memory for a record of `len` bytes,
+  /// or nullptr if the ring is full
+  uint8_t *reserve(size_t len) noexcept {
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+    const size_t offset = head & (AsyncLog::RING_SIZE - 1);
+    const size_t contiguous = AsyncLog::RING_SIZE - offset;
+    const size_t needed = contiguous < len ? contiguous + len : len;
+
+    if (head + needed - m_cached_tail > AsyncLog::RING_SIZE) {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head + needed - m_cached_tail > AsyncLog::RING_SIZE) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+    }
+
+    if (contiguous < len) {
+      RecordHeader *padding = reinterpret_cast<RecordHeader*>(m_data + offset);
+      padding->size = static_cast<uint32_t>(contiguous);
+      padding->nargs = PADDING;
+      m_head.store(head + contiguous, std::memory_order_release);
+      return m_data;
+    }
+
+    return m_data + offset;
+  }
+
+  /// commit makes the record of `len` bytes
+  /// returned by `reserve` visible to the consumer
+  void commit(size_t len) noexcept {
+    m_head.store(m_head.load(std::memory_order_relaxed) + len,
+                 std::memory_order_release);
+  }
+
+  /// drain calls `func` with every record in the ring
+  template <typename Func>
+  bool drain(Func func) noexcept {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    const uint64_t head = m_head.load(std::memory_order_acquire);
+
+    if (tail == head) {
+      return false;
+    }
+
+    while (tail < head) {
+      const RecordHeader *record = reinterpret_cast<const RecordHeader*>(
+          m_data + (tail & (AsyncLog::RING_SIZE - 1)));
+      if (record->nargs != PADDING) {
+        func(record);
+      }
+
+      tail += record->size;
+    }
+
+    m_tail.store(tail, std::memory_order_release);
+    return true;
+  }
+
+  inline bool empty() const noexcept {
+    return m_tail.load(std::memory_order_acquire) ==
+        m_head.load(std::memory_order_acquire);
+  }
+
+  std::atomic<bool> m_closed;
+  std::atomic<uint64_t> m_dropped;
+
+ private:
+  alignas(64) std::atomic<uint64_t> m_head;
+  uint64_t m_cached_tail;
+  alignas(64) std::atomic<uint64_t> m_tail;
+  alignas(64) uint8_t m_data[AsyncLog::RING_SIZE];
+};
+
+/// Backend keeps the rings of all threads and the state of
+/// the background thread. The mutex is only taken when a thread
+/// logs for the first time, and by the background thread
+struct Backend {
+  std::mutex mutex;
+  std::vector<Ring*> rings;
+  std::thread thread;
+  std::atomic<bool> running{false};
+  std::atomic<uint64_t> drained{0};
+  uint64_t dropped = 0;
+  LogOutput output = LogOutput::stderr_output;
+  FILE *file = nullptr;
+};
+
+static Backend &backend() {
+  static Backend *backend = new Backend();
+  return *backend;
+}
+
+/// RingHolder closes the ring of a thread when the thread
+/// exits, the background thread frees it once it is drained
+struct RingHolder {
+  Ring *ring = nullptr;
+
+  ~RingHolder() {
+    if (ring != nullptr) {
+      ring->m_closed.store(true, std::memory_order_release);
+    }
+  }
+};
+
+/// new_ring allocates a ring with the alignment of its
+/// cache lines, which new does not guarantee before C++17
+static Ring *new_ring() {
+  void *mem;
+  if (posix_memalign(&mem, alignof(Ring), sizeof(Ring)) != 0) {
+    return nullptr;
+  }
+
+  return new (mem) Ring();
+}
+
+static void delete_ring(Ring *ring) {
+  ring->~Ring();
+  free(ring);
+}
+
+static Ring *thread_ring() {
+  static thread_local RingHolder holder;
+
+  if (holder.ring == nullptr) {
+    holder.ring = new_ring();
+    if (holder.ring == nullptr) {
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(backend().mutex);
+    backend().rings.push_back(holder.ring);
+  }
+
+  return holder.ring;
+}
+
+void AsyncLog::write(const LogSite *site,
+                     const LogArg *args,
+                     size_t nargs) noexcept {
+  size_t len = sizeof(RecordHeader);
+  for (size_t i = 0; i < nargs; i++) {
+    len += sizeof(ArgHeader) + (args[i].type == LogArgType::string ?
+        align8(std::min(args[i].len, MAX_STRING_LEN)) : sizeof(uint64_t));
+  }
+
+  if (len > MAX_RECORD_SIZE) {
+    return;
+  }
+
+  Ring *ring = thread_ring();
+  if (ring == nullptr) {
+    return;
+  }
+
+  uint8_t *dst = ring->reserve(len);
+  if (dst == nullptr) {
+    return;
+  }
+
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  RecordHeader *record = reinterpret_cast<RecordHeader*>(dst);
+  record->size = static_cast<uint32_t>(len);
+  record->nargs = static_cast<uint32_t>(nargs);
+  record->site = site;
+  record->timestamp = static_cast<uint64_t>(ts.tv_sec) * 1000000000 +
+      static_cast<uint64_t>(ts.tv_nsec);
+  dst += sizeof(RecordHeader);
+
+  for (size_t i = 0; i < nargs; i++) {
+    ArgHeader *arg = reinterpret_cast<ArgHeader*>(dst);
+    arg->type = args[i].type;
+    dst += sizeof(ArgHeader);
+
+    if (args[i].type == LogArgType::string) {
+      const size_t slen = std::min(args[i].len, MAX_STRING_LEN);
+      arg->len = static_cast<uint32_t>(slen);
+      memcpy(dst, args[i].str, slen);
+      dst += align8(slen);
+
+    } else {
+      arg->len = sizeof(uint64_t);
+      memcpy(dst, &args[i].bits, sizeof(uint64_t));
+      dst += sizeof(uint64_t);
+    }
+  }
+
+  ring->commit(len);
+}
+
+/// Formatter appends to a line of LINE_SIZE bytes,
+/// and truncates whatever does not fit
+class Formatter final {
+ public:
+  Formatter(): m_len(0) { }
+
+  template <typename... Args>
+  void append(const char *fmt, Args... args) {
+    if (m_len >= LINE_SIZE) {
+      return;
+    }
+
+    int res = snprintf(m_line + m_len, LINE_SIZE - m_len, fmt, args...);
+    if (res > 0) {
+      m_len = std::min(m_len + static_cast<size_t>(res), LINE_SIZE - 1);
+    }
+  }
+
+  void append_value(const char *spec, const ArgHeader *arg,
+                    const uint8_t *value, const int *stars, int nstars);
+
+  inline const char *line() const noexcept {
+    return m_line;
+  }
+
+  inline size_t len() const noexcept {
+    return m_len;
+  }
+
+ private:
+  template <typename T>
+  void append_spec(const char *spec, const int *stars, int nstars, T value) {
+    switch (nstars) {
+      case 0:
+        append(spec, value);
+        break;
+      case 1:
+        append(spec, stars[0], value);
+        break;
+      default:
+        append(spec, stars[0], stars[1], value);
+        break;
+    }
+  }
+
+  char m_line[LINE_SIZE];
+  size_t m_len;
+};
+
+void Formatter::append_value(const char *spec,
+                             const ArgHeader *arg,
+                             const uint8_t *value,
+                             const int *stars,
+                             int nstars) {
+  // the conversion of the spec is rewritten to match the type in
+  // which the argument was stored, so that a value is never
+  // read as a type of a different size
+  char rewritten[32];
+  const size_t speclen = strlen(spec);
+  const char conversion = spec[speclen - 1];
+  size_t flags = strspn(spec + 1, "-+ #0123456789.*") + 1;
+  uint64_t bits;
+
+  if (flags > sizeof(rewritten) - 8) {
+    flags = sizeof(rewritten) - 8;
+  }
+
+  if (arg->type == LogArgType::string) {
+    // strings are not null terminated in the record, so their
+    // length is passed as the precision, bounded by the one
+    // of the spec if there is any
+    const char *dot = static_cast<const char*>(memchr(spec, '.', flags));
+    const size_t width = dot == nullptr ? flags : dot - spec;
+    const bool width_star = memchr(spec, '*', width) != nullptr;
+    const char *str = reinterpret_cast<const char*>(value);
+    int len = static_cast<int>(arg->len);
+
+    if (dot != nullptr) {
+      const int precision = dot[1] != '*' ? atoi(dot + 1) :
+          nstars > (width_star ? 1 : 0) ? stars[width_star ? 1 : 0] : -1;
+      if (precision >= 0 && precision < len) {
+        len = precision;
+      }
+    }
+
+    memcpy(rewritten, spec, width);
+    memcpy(rewritten + width, ".*s", 4);
+    if (width_star && nstars > 0) {
+      append(rewritten, stars[0], len, str);
+    } else {
+      append(rewritten, len, str);
+    }
+    return;
+  }
+
+  memcpy(rewritten, spec, flags);
+  memcpy(&bits, value, sizeof(bits));
+  switch (arg->type) {
+    case LogArgType::float64: {
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      const bool is_float = strchr("eEfFgGaA", conversion) != nullptr;
+      rewritten[flags] = is_float ? conversion : 'g';
+      rewritten[flags + 1] = '\0';
+      append_spec(rewritten, stars, nstars, d);
+      break;
+    }
+
+    case LogArgType::pointer:
+      rewritten[flags] = 'p';
+      rewritten[flags + 1] = '\0';
+      append_spec(rewritten, stars, nstars,
+                  reinterpret_cast<void*>(static_cast<uintptr_t>(bits)));
+      break;
+
+    default: {
+      if (conversion == 'c') {
+        rewritten[flags] = 'c';
+        rewritten[flags + 1] = '\0';
+        append_spec(rewritten, stars, nstars, static_cast<int>(bits));
+        break;
+      }
+
+      const bool is_unsigned = strchr("uxXo", conversion) != nullptr;
+      rewritten[flags] = 'l';
+      rewritten[flags + 1] = 'l';
+      rewritten[flags + 2] = is_unsigned ? conversion :
+          arg->type == LogArgType::uint64 ? 'u' : 'd';
+      rewritten[flags + 3] = '\0';
+      if (is_unsigned || arg->type == LogArgType::uint64) {
+        append_spec(rewritten, stars, nstars,
+                    static_cast<unsigned long long>(bits));  // NOLINT
+      } else {
+        append_spec(rewritten, stars, nstars,
+                    static_cast<long long>(bits));  // NOLINT
+      }
+      break;
+    }
+  }
+}
+
+static const char *level_name(int level) {
+  switch (level) {
+    case LOG_EMERG: return "EMERGENCY";
+    case LOG_ALERT: return "ALERT";
+    case LOG_CRIT: return "CRITICAL";
+    case LOG_ERR: return "ERROR";
+    case LOG_WARNING: return "WARNING";
+    case LOG_NOTICE: return "NOTICE";
+    case LOG_INFO: return "INFO";
+    default: return "DEBUG";
+  }
+}
+
+/// format_record formats a record the same way the
+/// synchronous macros do, following the format of its site
+static void format_record(const RecordHeader *record, Formatter *formatter) {
+  const LogSite *site = record->site;
+  const uint8_t *args = reinterpret_cast<const uint8_t*>(record + 1);
+  const uint8_t *end = reinterpret_cast<const uint8_t*>(record) + record->size;
+  const char *fmt = site->fmt;
+
+  formatter->append("[file %s] [line %d] [func %s] [%s] %s: ",
+                    site->file, site->line, site->function,
+                    level_name(site->level), site->call);
+
+  while (*fmt != '\0') {
+    const char *percent = strchr(fmt, '%');
+    if (percent == nullptr) {
+      formatter->append("%s", fmt);
+      break;
+    }
+
+    formatter->append("%.*s", static_cast<int>(percent - fmt), fmt);
+    if (percent[1] == '%') {
+      formatter->append("%s", "%");
+      fmt = percent + 2;
+      continue;
+    }
+
+    // a spec is the flags, width and precision, the
+    // length modifiers and a conversion
+    const char *conversion = percent + 1 +
+        strspn(percent + 1, "-+ #0123456789.*hlLqjzt");
+    if (*conversion == '\0') {
+      break;
+    }
+
+    char spec[32];
+    size_t speclen = std::min(static_cast<size_t>(conversion - percent + 1),
+                              sizeof(spec) - 1);
+    memcpy(spec, percent, speclen);
+    spec[speclen] = '\0';
+    fmt = conversion + 1;
+
+    // the star width and precision take their values from
+    // the arguments that come before the converted one
+    int stars[2];
+    int nstars = 0;
+    for (const char *c = percent; c < conversion; c++) {
+      if (*c == '*' && nstars < 2 && args < end) {
+        const ArgHeader *arg = reinterpret_cast<const ArgHeader*>(args);
+        uint64_t bits;
+        memcpy(&bits, args + sizeof(ArgHeader), sizeof(bits));
+        stars[nstars++] = static_cast<int>(bits);
+        args += sizeof(ArgHeader) + align8(arg->len);
+      }
+    }
+
+    if (args >= end) {
+      formatter->append("%s", spec);
+      continue;
+    }
+
+    const ArgHeader *arg = reinterpret_cast<const ArgHeader*>(args);
+    formatter->append_value(spec, arg, args + sizeof(ArgHeader),
+                            stars, nstars);
+    args += sizeof(ArgHeader) + align8(arg->len);
+  }
+}
+
+static void output_record(const RecordHeader *record) {
+  Backend &log = backend();
+  Formatter formatter;
+
+  if (log.output != LogOutput::syslog) {
+    char date[32];
+    struct tm tm;
+    const time_t seconds = static_cast<time_t>(record->timestamp / 1000000000);
+    gmtime_r(&seconds, &tm);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+    formatter.append("%s.%06lluZ ", date, static_cast<unsigned long long>(  // NOLINT
+        record->timestamp % 1000000000 / 1000));
+  }
+
+  format_record(record, &formatter);
+
+  if (log.output == LogOutput::syslog) {
+    syslog(record->site->level, "%s", formatter.line());
+  } else {
+    fprintf(log.file, "%s\n", formatter.line());
+  }
+}
+
+/// drain writes the records of all the rings, and frees the rings
+/// of the threads that have exited. It returns false if there
+/// were no records
+static bool drain() {
+  Backend &log = backend();
+  bool drained = false;
+  std::lock_guard<std::mutex> lock(log.mutex);
+
+  for (size_t i = 0; i < log.rings.size(); ) {
+    Ring *ring = log.rings[i];
+    const bool closed = ring->m_closed.load(std::memory_order_acquire);
+    drained |= ring->drain(output_record);
+
+    if (closed && ring->empty()) {
+      log.dropped += ring->m_dropped.load(std::memory_order_relaxed);
+      log.rings[i] = log.rings.back();
+      log.rings.pop_back();
+      delete_ring(ring);
+    } else {
+      i++;
+    }
+  }
+
+  if (drained && log.file != nullptr) {
+    fflush(log.file);
+  }
+
+  return drained;
+}
+
+static void run() {
+  Backend &log = backend();
+  auto idle = std::chrono::microseconds(50);
+
+  while (log.running.load(std::memory_order_acquire)) {
+    if (drain()) {
+      idle = std::chrono::microseconds(50);
+    } else {
+      std::this_thread::sleep_for(idle);
+      idle = std::min(idle * 2, std::chrono::microseconds(2000));
+    }
+
+    log.drained.fetch_add(1, std::memory_order_release);
+  }
+
+  drain();
+}
+
+bool AsyncLog::start(LogOutput output, const char *name) noexcept {
+  Backend &log = backend();
+  if (log.running.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  switch (output) {
+    case LogOutput::stderr_output:
+      log.file = stderr;
+      break;
+
+    case LogOutput::file:
+      log.file = fopen(name, "ae");
+      if (log.file == nullptr) {
+        return false;
+      }
+      break;
+
+    case LogOutput::syslog:
+      openlog(name, LOG_CONS | LOG_NDELAY | LOG_PID, LOG_USER);
+      log.file = nullptr;
+      break;
+  }
+
+  log.output = output;
+  log.running.store(true, std::memory_order_release);
+  try {
+    log.thread = std::thread(run);
+  } catch (const std::system_error&) {
+    log.running.store(false, std::memory_order_release);
+    return false;
+  }
+
+  return true;
+}
+
+void AsyncLog::stop() noexcept {
+  Backend &log = backend();
+  if (!log.running.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  log.running.store(false, std::memory_order_release);
+  log.thread.join();
+
+  if (log.output == LogOutput::file) {
+    fclose(log.file);
+  } else if (log.output == LogOutput::syslog) {
+    closelog();
+  }
+
+  log.file = nullptr;
+}
+
+void AsyncLog::flush() noexcept {
+  Backend &log = backend();
+  if (!log.running.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  // once every ring has been seen empty, one more pass of the
+  // background thread guarantees the last records were written
+  for (;;) {
+    bool empty = true;
+    {
+      std::lock_guard<std::mutex> lock(log.mutex);
+      for (const Ring *ring : log.rings) {
+        empty &= ring->empty();
+      }
+    }
+
+    if (empty) {
+      break;
+    }
+
+    std::this_thread::yield();
+  }
+
+  const uint64_t pass = log.drained.load(std::memory_order_acquire);
+  while (log.drained.load(std::memory_order_acquire) < pass + 2 &&
+         log.running.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+}
+
+uint64_t AsyncLog::dropped() noexcept {
+  Backend &log = backend();
+  std::lock_guard<std::mutex> lock(log.mutex);
+  uint64_t dropped = log.dropped;
+
+  for (const Ring *ring : log.rings) {
+    dropped += ring->m_dropped.load(std::memory_order_relaxed);
+  }
+
+  return dropped;
+}
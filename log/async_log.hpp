@@ -0,0 +1,157 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef LOG_ASYNCLOG_H_
+#define LOG_ASYNCLOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+
+/// LogSite is the static part of a log record, it is defined
+/// once per call site by the logging macros and the records
+/// only keep a pointer to it
+struct LogSite {
+  int level;
+  const char *file;
+  int line;
+  const char *function;
+  const char *call;
+  const char *fmt;
+};
+
+/// LogOutput selects where the background thread
+/// of the AsyncLog writes the formatted records
+enum class LogOutput {
+  stderr_output,
+  file,
+  syslog
+};
+
+/// LogArgType is the type of an argument as it is stored in a record
+enum class LogArgType : uint32_t {
+  int64,
+  uint64,
+  float64,
+  string,
+  pointer
+};
+
+/// LogArg is an argument of a log record before it is copied
+/// to the ring. Strings are copied, all other values are kept
+/// as their 64 bits
+struct LogArg {
+  LogArgType type;
+  const char *str;
+  size_t len;
+  uint64_t bits;
+};
+
+template <typename T>
+inline typename std::enable_if<
+  (std::is_integral<T>::value || std::is_enum<T>::value) &&
+  std::is_signed<T>::value, LogArg>::type
+make_log_arg(T value) noexcept {
+  return LogArg{LogArgType::int64, nullptr, 0,
+                static_cast<uint64_t>(static_cast<int64_t>(value))};
+}
+
+template <typename T>
+inline typename std::enable_if<
+  (std::is_integral<T>::value && !std::is_signed<T>::value) ||
+  (std::is_enum<T>::value && !std::is_signed<T>::value), LogArg>::type
+make_log_arg(T value) noexcept {
+  return LogArg{LogArgType::uint64, nullptr, 0,
+                static_cast<uint64_t>(value)};
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, LogArg>::type
+make_log_arg(T value) noexcept {
+  LogArg arg{LogArgType::float64, nullptr, 0, 0};
+  const double d = static_cast<double>(value);
+  memcpy(&arg.bits, &d, sizeof(d));
+  return arg;
+}
+
+inline LogArg make_log_arg(const char *value) noexcept {
+  if (value == nullptr) {
+    value = "(null)";
+  }
+
+  return LogArg{LogArgType::string, value, strlen(value), 0};
+}
+
+inline LogArg make_log_arg(char *value) noexcept {
+  return make_log_arg(static_cast<const char*>(value));
+}
+
+inline LogArg make_log_arg(const std::string &value) noexcept {
+  return LogArg{LogArgType::string, value.data(), value.size(), 0};
+}
+
+template <typename T>
+inline LogArg make_log_arg(T *value) noexcept {
+  return LogArg{LogArgType::pointer, nullptr, 0,
+                static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value))};
+}
+
+/// AsyncLog is a logging backend that keeps formatting and output
+/// off the calling thread. Each thread that logs gets its own single
+/// producer, single consumer ring of RING_SIZE bytes, into which a
+/// record is copied as a pointer to its static LogSite, a timestamp
+/// and the raw arguments, without locks nor syscalls. A background
+/// thread drains the rings, formats the records following the printf
+/// format of their site, and writes them to the output.
+///
+/// When the ring of a thread is full records are dropped rather
+/// than blocking the thread, see `dropped`. Records of the same
+/// thread keep their order, records of different threads may be
+/// written out of order.
+class AsyncLog final {
+ public:
+  static const size_t RING_SIZE = 1 << 16;
+
+  /// MAX_RECORD_SIZE is the size of the largest record, longer
+  /// string arguments are truncated
+  static const size_t MAX_RECORD_SIZE = 4096;
+
+  AsyncLog() = delete;
+
+  /// start starts the background thread. For LogOutput::file
+  /// `name` is the path of the file records are appended to, and
+  /// for LogOutput::syslog it is the ident passed to openlog. It
+  /// returns false if the backend is already running or the file
+  /// cannot be opened
+  static bool start(LogOutput output, const char *name) noexcept;
+
+  /// stop writes all the pending records and
+  /// stops the background thread
+  static void stop() noexcept;
+
+  /// flush waits until the records logged so far by
+  /// every thread have been written to the output
+  static void flush() noexcept;
+
+  /// dropped returns the number of records dropped
+  /// because the ring of their thread was full
+  static uint64_t dropped() noexcept;
+
+  /// log records the arguments for `site`. Levels are filtered
+  /// by the logging macros, before the arguments are evaluated
+  template <typename... Args>
+  static inline void log(const LogSite *site, const Args&... args) noexcept {
+    // one more element so that the array is never empty
+    const LogArg list[sizeof...(Args) + 1] = {make_log_arg(args)...};
+    write(site, list, sizeof...(Args));
+  }
+
+ private:
+  static void write(const LogSite *site,
+                    const LogArg *args,
+                    size_t nargs) noexcept;
+};
+
+#endif  // LOG_ASYNCLOG_H_
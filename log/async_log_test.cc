@@ -0,0 +1,116 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#define LOG_ASYNC
+
+#include "test/test.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "log.hpp"
+
+static std::string read_file(const char *pathname) {
+  std::string content;
+  char data[4096];
+  size_t rbytes;
+
+  FILE *file = fopen(pathname, "r");
+  while ((rbytes = fread(data, 1, sizeof(data), file)) > 0) {
+    content.append(data, rbytes);
+  }
+
+  fclose(file);
+  return content;
+}
+
+static int test_async_log_format() {
+  char pathname[] = "/tmp/async_log_XXXXXX";
+  char message[] = "message";
+
+  close(mkstemp(pathname));
+  ASSERT_TRUE(AsyncLog::start(LogOutput::file, pathname));
+  ASSERT_FALSE(AsyncLog::start(LogOutput::file, pathname));
+
+  LINFO("Format", "int: %d, long: %ld, unsigned: %zu, hex: %x",
+        -3, 40000000000L, static_cast<size_t>(7), 255u);
+  LERROR("Format", "str: %s, width: [%5s], prec: [%.3s], star: [%*d]",
+         message, "ab", "abcdef", 4, 12);
+  LWARNING("Format", "float: %.2f, char: %c, percent: 100%%", 1.5, 'z');
+
+  // strings are copied when they are logged
+  message[0] = 'M';
+  AsyncLog::flush();
+
+  const char *info = "[INFO] Format: int: -3, long: 40000000000, "
+      "unsigned: 7, hex: ff\n";
+  const char *error = "[ERROR] Format: str: message, width: [   ab], "
+      "prec: [abc], star: [  12]\n";
+  const char *warning = "[WARNING] Format: float: 1.50, char: z, "
+      "percent: 100%\n";
+  const std::string content = read_file(pathname);
+  ASSERT_TRUE(content.find(info) != std::string::npos);
+  ASSERT_TRUE(content.find(error) != std::string::npos);
+  ASSERT_TRUE(content.find(warning) != std::string::npos);
+  ASSERT_TRUE(content.find("[func test_async_log_format]") != std::string::npos);
+
+  AsyncLog::stop();
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+static int test_async_log_threads() {
+  char pathname[] = "/tmp/async_log_XXXXXX";
+  const int RECORDS = 1000;
+
+  close(mkstemp(pathname));
+  ASSERT_TRUE(AsyncLog::start(LogOutput::file, pathname));
+
+  auto producer = [](int id) {
+    for (int i = 0; i < RECORDS; i++) {
+      LNOTICE("Thread", "id: %d, record: %d", id, i);
+      if (i % 100 == 99) {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  std::thread first(producer, 1);
+  std::thread second(producer, 2);
+  first.join();
+  second.join();
+
+  // records of the masked levels are not logged
+  LOG_ENABLE_UPTO(LOG_WARNING);
+  LNOTICE("Masked", "not logged");
+  LOG_ENABLE_UPTO(LOG_DEBUG);
+  AsyncLog::stop();
+
+  const std::string content = read_file(pathname);
+  size_t lines = 0;
+  for (size_t pos = content.find('\n'); pos != std::string::npos;
+       pos = content.find('\n', pos + 1)) {
+    lines++;
+  }
+
+  ASSERT_EQ(lines + AsyncLog::dropped(), 2 * RECORDS);
+  ASSERT_TRUE(content.find("id: 2, record: 999") != std::string::npos ||
+              AsyncLog::dropped() > 0);
+  ASSERT_TRUE(content.find("Masked") == std::string::npos);
+
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_async_log_format());
+  TEST_RUN(ctx, test_async_log_threads());
+
+  return TEST_RELEASE(ctx);
+}
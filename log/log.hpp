@@ -7,76 +7,145 @@
 #include <string.h>
 #include <syslog.h>
 
+#include "log_filter.hpp"
+
+#ifdef LOG_ASYNC
+#include "async_log.hpp"
+
+// with LOG_ASYNC the macros record a static site and the raw
+// arguments in a ring of the calling thread, and an AsyncLog
+// thread formats them and writes them to syslog
+
+#define LOGINIT(prog) AsyncLog::start(LogOutput::syslog, (prog))
+
+#define LOGCLOSE() AsyncLog::stop()
+
+#define LOG_ENABLE_UPTO(level) LogFilter::set_mask(LOG_UPTO(level))
+
+#define LOG_WRITE(level, tag, call, fmt, ...)                         \
+  do {                                                                \
+    static const LogSite _log_site = {                                \
+      (level), __FILE__, __LINE__, __FUNCTION__, (call), (fmt)};      \
+    AsyncLog::log(&_log_site, ##__VA_ARGS__);                         \
+  } while (0)
+
+#define LPERR(call, fmt, ...)                                         \
+  LOG_AT(LOG_ERR, "PERR", call, fmt ", errmsg: %s",                   \
+         ##__VA_ARGS__, strerror(errno))
+
+#else
+
 #define LOGINIT(prog) openlog((prog),               \
     LOG_CONS | LOG_NDELAY | LOG_PERROR | LOG_PID,   \
     LOG_USER)
 
-#define LOG_ENABLE_UPTO(level) setlogmask(LOG_UPTO(level))
+#define LOGCLOSE() closelog()
 
-#define LDEBUG(call, fmt, ...)                                        \
-  syslog(LOG_DEBUG,                                                   \
-         "[file %s] [line %d] [func %s] [DEBUG] %s: "                 \
+#define LOG_ENABLE_UPTO(level)                      \
+  do {                                              \
+    LogFilter::set_mask(LOG_UPTO(level));           \
+    setlogmask(LOG_UPTO(level));                    \
+  } while (0)
+
+#define LOG_WRITE(level, tag, call, fmt, ...)                         \
+  syslog((level),                                                     \
+         "[file %s] [line %d] [func %s] [" tag "] %s: "               \
          fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
 
+#define LPERR(call, fmt, ...)                                         \
+  LOG_AT(LOG_ERR, "PERR", call, fmt ", errmsg: %m", ##__VA_ARGS__)
+
+#endif  // LOG_ASYNC
+
+/// LOG_AT logs a record if its level is compiled in and enabled.
+/// Both checks come before the arguments are evaluated, and the
+/// first one removes the site when the level is not compiled in
+#define LOG_AT(level, tag, call, fmt, ...)                            \
+  do {                                                                \
+    if (LogFilter::compiled(level) && LogFilter::enabled(level)) {    \
+      LOG_WRITE(level, tag, call, fmt, ##__VA_ARGS__);                \
+    }                                                                 \
+  } while (0)
+
+/// LOG_EVERY_N logs the first record of the site and then
+/// one of every `n` records, whatever the thread that logs them
+#define LOG_EVERY_N(level, tag, n, call, fmt, ...)                    \
+  do {                                                                \
+    static std::atomic<uint64_t> _log_count(0);                       \
+    if (LogFilter::compiled(level) && LogFilter::enabled(level) &&    \
+        _log_count.fetch_add(1, std::memory_order_relaxed) %          \
+        (n) == 0) {                                                   \
+      LOG_WRITE(level, tag, call, fmt, ##__VA_ARGS__);                \
+    }                                                                 \
+  } while (0)
+
+/// LOG_PER_SEC logs at most `n` records of the site per second,
+/// so that a failure that repeats in a loop does not flood the log
+#define LOG_PER_SEC(level, tag, n, call, fmt, ...)                    \
+  do {                                                                \
+    static LogRateLimiter _log_limiter;                               \
+    if (LogFilter::compiled(level) && LogFilter::enabled(level) &&    \
+        _log_limiter.allow(n)) {                                      \
+      LOG_WRITE(level, tag, call, fmt, ##__VA_ARGS__);                \
+    }                                                                 \
+  } while (0)
+
+#define LDEBUG(call, fmt, ...)                                        \
+  LOG_AT(LOG_DEBUG, "DEBUG", call, fmt, ##__VA_ARGS__)
+
 #ifndef DEBUG
 #define LTRACE(call, fmt, ...)
 #else
 #define LTRACE(call, fmt, ...)                                        \
-  syslog(LOG_DEBUG,                                                   \
-         "[file %s] [line %d] [func %s] [TRACE] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+  LOG_AT(LOG_DEBUG, "TRACE", call, fmt, ##__VA_ARGS__)
 #endif  // DEBUG
 
-#define LINFO(call, fmt, ...)                  \
-  syslog(LOG_INFO,                                         \
-         "[file %s] [line %d] [func %s] [INFO] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LINFO(call, fmt, ...)                                         \
+  LOG_AT(LOG_INFO, "INFO", call, fmt, ##__VA_ARGS__)
 
-#define LEMERGENCY(call, fmt, ...)                  \
-  syslog(LOG_EMERGENCY,                                         \
-         "[file %s] [line %d] [func %s] [EMERGENCY] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LEMERGENCY(call, fmt, ...)                                    \
+  LOG_AT(LOG_EMERG, "EMERGENCY", call, fmt, ##__VA_ARGS__)
 
-#define LALERT(call, fmt, ...)                  \
-  syslog(LOG_ALERT,                                         \
-         "[file %s] [line %d] [func %s] [ALERT] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LALERT(call, fmt, ...)                                        \
+  LOG_AT(LOG_ALERT, "ALERT", call, fmt, ##__VA_ARGS__)
 
-#define LCRITICAL(call, fmt, ...)                  \
-  syslog(LOG_CRITICAL,                                         \
-         "[file %s] [line %d] [func %s] [CRITICAL] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LCRITICAL(call, fmt, ...)                                     \
+  LOG_AT(LOG_CRIT, "CRITICAL", call, fmt, ##__VA_ARGS__)
 
-#define LERROR(call, fmt, ...)                  \
-  syslog(LOG_ERR,                                           \
-         "[file %s] [line %d] [func %s] [ERROR] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LERROR(call, fmt, ...)                                        \
+  LOG_AT(LOG_ERR, "ERROR", call, fmt, ##__VA_ARGS__)
 
-#define LPERR(call, fmt, ...)                  \
-  syslog(LOG_PERR,                                         \
-         "[file %s] [line %d] [func %s] [PERR] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LWARNING(call, fmt, ...)                                      \
+  LOG_AT(LOG_WARNING, "WARNING", call, fmt, ##__VA_ARGS__)
 
-#define LWARNING(call, fmt, ...)                  \
-  syslog(LOG_WARNING,                                         \
-         "[file %s] [line %d] [func %s] [WARNING] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LNOTICE(call, fmt, ...)                                       \
+  LOG_AT(LOG_NOTICE, "NOTICE", call, fmt, ##__VA_ARGS__)
 
-#define LNOTICE(call, fmt, ...)                  \
-  syslog(LOG_NOTICE,                                         \
-         "[file %s] [line %d] [func %s] [NOTICE] %s: "                 \
-         fmt, __FILE__, __LINE__, __FUNCTION__, call, ##__VA_ARGS__)
+#define LINFO_EVERY_N(n, call, fmt, ...)                              \
+  LOG_EVERY_N(LOG_INFO, "INFO", n, call, fmt, ##__VA_ARGS__)
 
-#define LOGCLOSE() closelog()
+#define LWARNING_EVERY_N(n, call, fmt, ...)                           \
+  LOG_EVERY_N(LOG_WARNING, "WARNING", n, call, fmt, ##__VA_ARGS__)
+
+#define LERROR_EVERY_N(n, call, fmt, ...)                             \
+  LOG_EVERY_N(LOG_ERR, "ERROR", n, call, fmt, ##__VA_ARGS__)
+
+#define LINFO_PER_SEC(n, call, fmt, ...)                              \
+  LOG_PER_SEC(LOG_INFO, "INFO", n, call, fmt, ##__VA_ARGS__)
+
+#define LWARNING_PER_SEC(n, call, fmt, ...)                           \
+  LOG_PER_SEC(LOG_WARNING, "WARNING", n, call, fmt, ##__VA_ARGS__)
+
+#define LERROR_PER_SEC(n, call, fmt, ...)                             \
+  LOG_PER_SEC(LOG_ERR, "ERROR", n, call, fmt, ##__VA_ARGS__)
 
 #ifdef DEBUG
 #define LOG_ERRNO(operation, msg)                           \
   do {                                                      \
-    int value = errno;                                      \
-    errno = 0;                                              \
-    LDEBUG(operation, "msg: %s, errno: %s, errmsg: %s",     \
-           msg, strerror(errno))                            \
-  } while(0)
+    const int _log_errno = errno;                           \
+    LDEBUG(operation, "msg: %s, errno: %d, errmsg: %s",     \
+           msg, _log_errno, strerror(_log_errno));          \
+  } while (0)
 
 #else
 #define LOG_ERRNO(operation, msg)
@@ -0,0 +1,5 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "log_filter.hpp"
+
+std::atomic<int> LogFilter::s_mask(LOG_UPTO(LOG_DEBUG));
@@ -0,0 +1,85 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef LOG_LOGFILTER_H_
+#define LOG_LOGFILTER_H_
+
+#include <stdint.h>
+#include <syslog.h>
+#include <time.h>
+
+#include <atomic>
+
+/// LOG_MIN_LEVEL is the least severe level that is compiled in.
+/// The log sites of less severe levels are removed at compile
+/// time, and their arguments are never evaluated
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_DEBUG
+#endif  // LOG_MIN_LEVEL
+
+/// LogFilter keeps the mask of the levels that are logged. The
+/// logging macros check it before evaluating their arguments
+class LogFilter final {
+ public:
+  LogFilter() = delete;
+
+  /// compiled returns true if the sites of `level` are compiled in
+  static constexpr bool compiled(int level) noexcept {
+    return level <= LOG_MIN_LEVEL;
+  }
+
+  /// enabled returns true if `level` is in the mask
+  static inline bool enabled(int level) noexcept {
+    return (s_mask.load(std::memory_order_relaxed) & LOG_MASK(level)) != 0;
+  }
+
+  /// set_mask sets the mask of the levels that are
+  /// logged, as built by LOG_MASK and LOG_UPTO
+  static inline void set_mask(int mask) noexcept {
+    s_mask.store(mask, std::memory_order_relaxed);
+  }
+
+ private:
+  static std::atomic<int> s_mask;
+};
+
+/// LOG_RATE_CLOCK is the clock the rate limiters take seconds
+/// from. The coarse monotonic clock does not need a syscall, but
+/// it is Linux only, and elsewhere the monotonic clock is used
+#ifdef CLOCK_MONOTONIC_COARSE
+#define LOG_RATE_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define LOG_RATE_CLOCK CLOCK_MONOTONIC
+#endif
+
+/// LogRateLimiter lets through at most a number of records per
+/// second for a log site. Seconds are taken from LOG_RATE_CLOCK
+class LogRateLimiter final {
+ public:
+  LogRateLimiter():
+      m_second(0),
+      m_count(0) { }
+
+  /// allow returns true if less than `limit` records
+  /// have been let through in the current second
+  inline bool allow(uint32_t limit) noexcept {
+    struct timespec ts;
+    clock_gettime(LOG_RATE_CLOCK, &ts);
+    const uint64_t now = static_cast<uint64_t>(ts.tv_sec);
+
+    // only one of the threads that see a new second resets the count
+    uint64_t second = m_second.load(std::memory_order_relaxed);
+    if (second != now &&
+        m_second.compare_exchange_strong(second, now,
+                                         std::memory_order_relaxed)) {
+      m_count.store(0, std::memory_order_relaxed);
+    }
+
+    return m_count.fetch_add(1, std::memory_order_relaxed) < limit;
+  }
+
+ private:
+  std::atomic<uint64_t> m_second;
+  std::atomic<uint32_t> m_count;
+};
+
+#endif  // LOG_LOGFILTER_H_
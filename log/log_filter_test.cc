@@ -0,0 +1,108 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#define LOG_ASYNC
+#define LOG_MIN_LEVEL LOG_INFO
+
+#include "test/test.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "log.hpp"
+
+static size_t count_lines(const char *pathname, const char *call) {
+  char line[4096];
+  size_t lines = 0;
+
+  FILE *file = fopen(pathname, "r");
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (strstr(line, call) != nullptr) {
+      lines++;
+    }
+  }
+
+  fclose(file);
+  return lines;
+}
+
+static int evaluated(int *count) {
+  (*count)++;
+  return *count;
+}
+
+static int test_log_filter_levels() {
+  char pathname[] = "/tmp/log_filter_XXXXXX";
+  int count = 0;
+
+  close(mkstemp(pathname));
+  ASSERT_TRUE(AsyncLog::start(LogOutput::file, pathname));
+
+  // the site is not compiled in
+  ASSERT_FALSE(LogFilter::compiled(LOG_DEBUG));
+  LDEBUG("Levels", "count: %d", evaluated(&count));
+  ASSERT_EQ(count, 0);
+
+  // the level is masked out at runtime
+  LOG_ENABLE_UPTO(LOG_WARNING);
+  ASSERT_FALSE(LogFilter::enabled(LOG_INFO));
+  LINFO("Levels", "count: %d", evaluated(&count));
+  ASSERT_EQ(count, 0);
+  LERROR("Levels", "count: %d", evaluated(&count));
+  ASSERT_EQ(count, 1);
+
+  LOG_ENABLE_UPTO(LOG_DEBUG);
+  LINFO("Levels", "count: %d", evaluated(&count));
+  ASSERT_EQ(count, 2);
+
+  AsyncLog::stop();
+  ASSERT_EQ(count_lines(pathname, "Levels"), 2);
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+static int test_log_filter_rate_limit() {
+  char pathname[] = "/tmp/log_filter_XXXXXX";
+
+  close(mkstemp(pathname));
+  ASSERT_TRUE(AsyncLog::start(LogOutput::file, pathname));
+
+  for (int i = 0; i < 100; i++) {
+    LWARNING_EVERY_N(10, "EveryN", "record: %d", i);
+    LERROR_PER_SEC(5, "PerSec", "record: %d", i);
+  }
+
+  AsyncLog::stop();
+  ASSERT_EQ(count_lines(pathname, "EveryN"), 10);
+
+  // the loop may run across the change of a second
+  const size_t per_sec = count_lines(pathname, "PerSec");
+  ASSERT_TRUE(per_sec == 5 || per_sec == 10);
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+static int test_log_rate_limiter() {
+  LogRateLimiter limiter;
+  int allowed = 0;
+
+  for (int i = 0; i < 10; i++) {
+    allowed += limiter.allow(3) ? 1 : 0;
+  }
+
+  ASSERT_TRUE(allowed == 3 || allowed == 6);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_log_filter_levels());
+  TEST_RUN(ctx, test_log_filter_rate_limit());
+  TEST_RUN(ctx, test_log_rate_limiter());
+
+  return TEST_RELEASE(ctx);
+}
@@ -1,6 +1,6 @@
 // Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
 
-#include "aio.h"
+#include "aio.hpp"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -327,6 +327,17 @@ int aio_bind(int sockfd,
   return 0;
 }
 
+int aio_bind_reuseport(int sockfd,
+                       const struct sockaddr* addr,
+                       socklen_t addrlen) {
+  int arr[] = {1};
+  if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, arr, sizeof(int)) == -1) {
+    return -1;
+  }
+
+  return aio_bind(sockfd, addr, addrlen);
+}
+
 int aio_listen(int sockfd,
                int backlog) {
   if (listen(sockfd, backlog) == -1) {
@@ -50,6 +50,9 @@ int aio_accept(int serverfd,
 int aio_bind(int sockfd,
              const struct sockaddr* addr,
              socklen_t addrlen);
+int aio_bind_reuseport(int sockfd,
+                       const struct sockaddr* addr,
+                       socklen_t addrlen);
 
 int aio_listen(int sockfd,
                int backlog);
@@ -0,0 +1,227 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "copy.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include <algorithm>
+
+#include "log/log.hpp"
+
+/// Endpoint is the kind of file behind a file descriptor,
+/// which decides the syscalls that can move bytes from it
+enum class Endpoint {
+  file,
+  pipe,
+  socket,
+  other
+};
+
+/// Transfer moves bytes from `in` to `out`. Its functions
+/// move up to `len` bytes with a single syscall, and return
+/// the number of bytes moved, 0 when `in` reaches its end,
+/// or -1 with errno set on error
+struct Transfer final {
+  int in;
+  int out;
+  Endpoint in_type;
+  Endpoint out_type;
+};
+
+using TransferFunc = ssize_t (*)(const Transfer *transfer, size_t len);
+
+static const size_t kBufferSize = 16384;
+static const size_t kMaxChunk = 1 << 30;
+
+static Endpoint endpoint(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    return Endpoint::other;
+  }
+
+  if (S_ISREG(st.st_mode)) {
+    return Endpoint::file;
+  } else if (S_ISFIFO(st.st_mode)) {
+    return Endpoint::pipe;
+  } else if (S_ISSOCK(st.st_mode)) {
+    return Endpoint::socket;
+  } else {
+    return Endpoint::other;
+  }
+}
+
+/// writable returns how many of `len` bytes the destination is
+/// sure to take without blocking. Regular files take them all. Any
+/// other file that polls writable takes at least PIPE_BUF bytes,
+/// which a pipe takes at once or not at all
+static size_t writable(const Transfer *transfer, size_t len) {
+  if (transfer->out_type == Endpoint::file) {
+    return len;
+  }
+
+  struct pollfd pfd = {transfer->out, POLLOUT, 0};
+  if (poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLOUT)) {
+    return 0;
+  }
+
+  return std::min(len, static_cast<size_t>(PIPE_BUF));
+}
+
+/// transfer_buffered copies the bytes through a buffer. Bytes that
+/// are read but cannot be written are given back to the source, by
+/// peeking on sockets and rewinding files, so that no bytes are
+/// lost when the destination would block. Other sources cannot give
+/// bytes back, so no more is read from them than the destination is
+/// sure to take
+static ssize_t transfer_buffered(const Transfer *transfer, size_t len) {
+  uint8_t buffer[kBufferSize];
+  const bool peek = transfer->in_type == Endpoint::socket;
+  const bool rewind = transfer->in_type == Endpoint::file;
+  size_t size = std::min(len, sizeof(buffer));
+
+  if (!peek && !rewind) {
+    size = writable(transfer, size);
+    if (size == 0) {
+      errno = EAGAIN;
+      return -1;
+    }
+  }
+
+  ssize_t rbytes = peek ? recv(transfer->in, buffer, size, MSG_PEEK) :
+      read(transfer->in, buffer, size);
+  if (rbytes <= 0) {
+    return rbytes;
+  }
+
+  ssize_t wbytes = write(transfer->out, buffer, rbytes);
+  int err = errno;
+  const size_t written = wbytes > 0 ? static_cast<size_t>(wbytes) : 0;
+
+  if (peek && written > 0) {
+    recv(transfer->in, buffer, written, 0);
+
+  } else if (!peek && written < static_cast<size_t>(rbytes)) {
+    const off_t pending = rbytes - written;
+    if (!rewind || lseek(transfer->in, -pending, SEEK_CUR) == -1) {
+      // the bytes that were not written are lost, which is an
+      // error even if the destination only reports it would block
+      err = wbytes == -1 && err != EAGAIN && err != EWOULDBLOCK ?
+          err : ENOBUFS;
+      wbytes = -1;
+    }
+  }
+
+  if (wbytes == -1) {
+    errno = err;
+    return -1;
+  }
+
+  return wbytes;
+}
+
+#ifdef __linux__
+static ssize_t transfer_copy_file_range(const Transfer *transfer, size_t len) {
+  return copy_file_range(transfer->in, nullptr,
+                         transfer->out, nullptr, len, 0);
+}
+
+static ssize_t transfer_sendfile(const Transfer *transfer, size_t len) {
+  return sendfile(transfer->out, transfer->in, nullptr, len);
+}
+
+static ssize_t transfer_splice(const Transfer *transfer, size_t len) {
+  return splice(transfer->in, nullptr, transfer->out, nullptr, len,
+                SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+}
+#endif
+
+/// transfers fills `funcs` with the functions that can move bytes
+/// between the endpoints, in order of preference. The buffered
+/// copy is always the last one
+static size_t transfers(const Transfer *transfer, TransferFunc funcs[3]) {
+  size_t len = 0;
+
+#ifdef __linux__
+  if (transfer->in_type == Endpoint::pipe ||
+      transfer->out_type == Endpoint::pipe) {
+    funcs[len++] = transfer_splice;
+
+  } else if (transfer->in_type == Endpoint::file) {
+    if (transfer->out_type == Endpoint::file) {
+      funcs[len++] = transfer_copy_file_range;
+    }
+
+    funcs[len++] = transfer_sendfile;
+  }
+#endif
+
+  funcs[len++] = transfer_buffered;
+  return len;
+}
+
+static Status copy_fd(int in, int out, size_t len, size_t *cbytes) noexcept {
+  Transfer transfer = {in, out, endpoint(in), endpoint(out)};
+  TransferFunc funcs[3];
+  const size_t nfuncs = transfers(&transfer, funcs);
+  size_t index = 0;
+
+  *cbytes = 0;
+
+  while (*cbytes < len) {
+    ssize_t res = funcs[index](&transfer,
+                               std::min(len - *cbytes, kMaxChunk));
+    if (res > 0) {
+      *cbytes += res;
+      continue;
+    }
+
+    if (res == 0 || errno == EAGAIN || errno == EWOULDBLOCK) {
+      return OK;
+    }
+
+    if (errno == EINTR) {
+      continue;
+    }
+
+    // the kernel may reject a zero-copy syscall for a particular
+    // pair of files, in which case the next one is tried
+    if ((errno == EINVAL || errno == ENOSYS || errno == EXDEV ||
+         errno == EOPNOTSUPP) && index + 1 < nfuncs) {
+      index++;
+      continue;
+    }
+
+    LTRACE("Copy", "in: %d, out: %d, msg: %s, err: %s", in, out,
+           "failed to copy between file descriptors", strerror(errno));
+    return CopyFailed;
+  }
+
+  return OK;
+}
+
+Status copy(FileStream *src, Channel *dst, size_t len, size_t *cbytes) noexcept {
+  return copy_fd(src->fd(), dst->write_fd(), len, cbytes);
+}
+
+Status copy(FileStream *src, FileStream *dst, size_t len, size_t *cbytes) noexcept {
+  return copy_fd(src->fd(), dst->fd(), len, cbytes);
+}
+
+Status copy(Channel *src, Channel *dst, size_t len, size_t *cbytes) noexcept {
+  return copy_fd(src->read_fd(), dst->write_fd(), len, cbytes);
+}
+
+Status copy(Channel *src, FileStream *dst, size_t len, size_t *cbytes) noexcept {
+  return copy_fd(src->read_fd(), dst->fd(), len, cbytes);
+}
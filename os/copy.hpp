@@ -0,0 +1,34 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef OS_COPY_H_
+#define OS_COPY_H_
+
+#include <stddef.h>
+
+#include "channel.hpp"
+#include "file_stream.hpp"
+#include "status.hpp"
+
+/// copy copies up to `len` bytes between two file descriptor
+/// backed endpoints without moving them through user space when
+/// the kernel allows it. Depending on the endpoints, the bytes are
+/// moved with copy_file_range (file to file), sendfile (file to
+/// anything else) or splice (when either end is a pipe). Any other
+/// combination, or a kernel that rejects the zero-copy syscalls,
+/// falls back to copying through a buffer on the stack.
+///
+/// copy returns when `len` bytes have been copied, the source
+/// reaches its end or either endpoint would block. In all those
+/// cases it returns OK and sets `cbytes` to the bytes copied.
+/// copy never blocks on non-blocking endpoints: when the bytes go
+/// through the buffer and the source cannot give back the ones the
+/// destination does not take, it reads no more than PIPE_BUF bytes
+/// at a time once the destination is writable.
+/// Bytes are read from files and sockets at their current
+/// position, which copy moves forward by `cbytes`
+Status copy(FileStream *src, Channel *dst, size_t len, size_t *cbytes) noexcept;
+Status copy(FileStream *src, FileStream *dst, size_t len, size_t *cbytes) noexcept;
+Status copy(Channel *src, Channel *dst, size_t len, size_t *cbytes) noexcept;
+Status copy(Channel *src, FileStream *dst, size_t len, size_t *cbytes) noexcept;
+
+#endif  // OS_COPY_H_
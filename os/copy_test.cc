@@ -0,0 +1,145 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "copy.hpp"
+#include "file_stream.hpp"
+#include "pipe.hpp"
+#include "socket.hpp"
+
+static const uint8_t data[] = "some content to copy";
+static const size_t kDataLen = 20;
+
+static std::unique_ptr<FileStream> create_file(const uint8_t *content,
+                                               size_t len) {
+  char path[] = "/tmp/copy_test.XXXXXX";
+  int fd = mkstemp(path);
+  close(fd);
+
+  auto file = FileStream::open_ptr(path, O_RDWR | O_TRUNC, 0600);
+  unlink(path);
+
+  size_t wbytes;
+  file->write(content, len, &wbytes);
+  lseek(file->fd(), 0, SEEK_SET);
+  return file;
+}
+
+static int test_copy_file_to_file() {
+  auto src = create_file(data, kDataLen);
+  auto dst = create_file(nullptr, 0);
+  uint8_t readdata[kDataLen];
+  size_t cbytes, rbytes;
+
+  ASSERT_EQ(copy(src.get(), dst.get(), kDataLen << 1, &cbytes), OK);
+  ASSERT_EQ(cbytes, kDataLen);
+
+  lseek(dst->fd(), 0, SEEK_SET);
+  ASSERT_EQ(dst->read(readdata, kDataLen, &rbytes), OK);
+  ASSERT_EQ(rbytes, kDataLen);
+  ASSERT_MEM_EQ(readdata, data, kDataLen);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_copy_file_to_pipe_to_file() {
+  auto src = create_file(data, kDataLen);
+  auto dst = create_file(nullptr, 0);
+  Pipe pipe;
+  uint8_t readdata[kDataLen];
+  size_t cbytes, rbytes;
+
+  ASSERT_EQ(copy(src.get(), &pipe, 5, &cbytes), OK);
+  ASSERT_EQ(cbytes, 5);
+  ASSERT_EQ(copy(src.get(), &pipe, kDataLen, &cbytes), OK);
+  ASSERT_EQ(cbytes, kDataLen - 5);
+
+  ASSERT_EQ(copy(&pipe, dst.get(), kDataLen << 1, &cbytes), OK);
+  ASSERT_EQ(cbytes, kDataLen);
+
+  lseek(dst->fd(), 0, SEEK_SET);
+  ASSERT_EQ(dst->read(readdata, kDataLen, &rbytes), OK);
+  ASSERT_EQ(rbytes, kDataLen);
+  ASSERT_MEM_EQ(readdata, data, kDataLen);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_copy_pipe_to_pipe() {
+  Pipe src;
+  Pipe dst;
+  uint8_t readdata[kDataLen];
+  size_t wbytes, cbytes, rbytes;
+
+  ASSERT_EQ(src.write(data, kDataLen, &wbytes), OK);
+  ASSERT_EQ(copy(&src, &dst, kDataLen << 1, &cbytes), OK);
+  ASSERT_EQ(cbytes, kDataLen);
+
+  ASSERT_EQ(dst.read(readdata, kDataLen, &rbytes), OK);
+  ASSERT_EQ(rbytes, kDataLen);
+  ASSERT_MEM_EQ(readdata, data, kDataLen);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_copy_device_to_full_socket() {
+  auto src = FileStream::open_read_ptr("/dev/zero");
+  struct sockaddr_in address;
+  uint8_t buffer[4096];
+  size_t wbytes, cbytes, rbytes;
+  size_t filled = 0, drained = 0;
+  int fds[2];
+
+  memset(&address, 0, sizeof(address));
+  memset(buffer, 0, sizeof(buffer));
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  auto writer = TcpSocket::adopt_ptr(fds[0], &address, 0);
+  auto reader = TcpSocket::adopt_ptr(fds[1], &address, 0);
+
+  do {
+    ASSERT_EQ(writer->write(buffer, sizeof(buffer), &wbytes), OK);
+    filled += wbytes;
+  } while (wbytes > 0);
+
+  // the bytes read from the device cannot be given back,
+  // so none are read while the socket is full
+  ASSERT_EQ(copy(src.get(), writer.get(), 1 << 20, &cbytes), OK);
+  ASSERT_EQ(cbytes, 0);
+
+  do {
+    ASSERT_EQ(reader->read(buffer, sizeof(buffer), &rbytes), OK);
+    drained += rbytes;
+  } while (rbytes > 0);
+  ASSERT_EQ(drained, filled);
+
+  // once there is room, the bytes copied are all
+  // written, up to where the socket is full again
+  ASSERT_EQ(copy(src.get(), writer.get(), 1 << 20, &cbytes), OK);
+  ASSERT_TRUE(cbytes > 0);
+
+  drained = 0;
+  do {
+    ASSERT_EQ(reader->read(buffer, sizeof(buffer), &rbytes), OK);
+    drained += rbytes;
+  } while (rbytes > 0);
+  ASSERT_EQ(drained, cbytes);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_copy_file_to_file());
+  TEST_RUN(ctx, test_copy_file_to_pipe_to_file());
+  TEST_RUN(ctx, test_copy_pipe_to_pipe());
+  TEST_RUN(ctx, test_copy_device_to_full_socket());
+
+  return TEST_RELEASE(ctx);
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef OS_EVENTHANDLER_H_
+#define OS_EVENTHANDLER_H_
+
+#include "channel.hpp"
+
+class EventLoop;
+
+/// EventHandler receives the events that an EventLoop
+/// detects on a monitored Channel. Handlers are invoked from
+/// the thread that runs the loop, and they are allowed to
+/// monitor or unmonitor channels on that same loop, including
+/// the channel for which the event is being dispatched
+class EventHandler {
+ public:
+  /// Operation identifies an I/O operation submitted
+  /// to the loop, whose result is delivered to `on_complete`
+  enum class Operation {
+    read,
+    write,
+    accept,
+    connect
+  };
+
+  EventHandler() = default;
+  virtual ~EventHandler() = default;
+
+  /// on_read is called when the channel has data available
+  /// to be read without blocking
+  virtual void on_read(EventLoop *loop, Channel *channel) noexcept = 0;
+
+  /// on_write is called when the channel can be written
+  /// to without blocking
+  virtual void on_write(EventLoop *loop, Channel *channel) noexcept = 0;
+
+  /// on_hangup is called when the peer has closed the channel,
+  /// or the channel has been closed for both reading and writing
+  virtual void on_hangup(EventLoop *loop, Channel *channel) noexcept = 0;
+
+  /// on_error is called when an error has been detected on the
+  /// channel. No other callbacks are invoked for that event
+  virtual void on_error(EventLoop *loop, Channel *channel) noexcept = 0;
+
+  /// on_timeout is called when no events have been dispatched for the
+  /// channel during the inactivity period of the loop. The channel
+  /// remains monitored, and the inactivity timer is armed again on
+  /// its next event. Handlers of loops without an inactivity
+  /// period do not need to override it
+  virtual void on_timeout(EventLoop *loop, Channel *channel) noexcept {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  /// on_complete is called when an operation submitted to the loop
+  /// for the channel completes. `result` holds the value the equivalent
+  /// syscall would have returned, or the negated errno if it failed.
+  /// Handlers that do not submit operations do not need to override it
+  virtual void on_complete(EventLoop *loop,
+                           Channel *channel,
+                           Operation operation,
+                           int result) noexcept {
+    (void)(loop);
+    (void)(channel);
+    (void)(operation);
+    (void)(result);
+  }
+};
+
+#endif  // OS_EVENTHANDLER_H_
@@ -3,11 +3,68 @@
 #include "event_loop.hpp"
 
 #include <errno.h>
+#include <poll.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "log/log.hpp"
 
+/// Operations tag the user data of the uring operations. The
+/// user data keeps the id of the handle in the lower 32 bits,
+/// the generation of the handle in the next 16 bits, then the
+/// operation and the monitored events in a byte each
+enum UringOperation : uint32_t {
+  UringPoll = 0,
+  UringRead = 1,
+  UringWrite = 2,
+  UringAccept = 3,
+  UringConnect = 4,
+  UringCancel = 5
+};
+
+static const uint32_t UringPollEdge = 0x80;
+
+static uint32_t poll_mask(bool read, bool write) {
+  uint32_t mask = POLLRDHUP;
+  mask |= read ? POLLIN : 0;
+  mask |= write ? POLLOUT : 0;
+  return mask;
+}
+
+/// WakeupHandler drains the pipe used to interrupt
+/// the loop while it waits for events
+class WakeupHandler final : public EventHandler {
+ public:
+  void on_read(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    uint8_t data[64];
+    size_t rbytes;
+
+    do {
+      channel->read(data, sizeof(data), &rbytes);
+    } while (rbytes == sizeof(data));
+  }
+
+  void on_write(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  void on_hangup(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  void on_error(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+    LTRACE("WakeupError", "fd: %d, msg: %s", channel->read_fd(),
+           "error on wakeup pipe");
+  }
+};
+
 EventLoop::EventLoop():
     EventLoop(EventLoop::Properties::Builder().build()) { }
 
@@ -15,14 +72,55 @@ EventLoop::EventLoop(const EventLoop::Properties &properties):
     m_timeout(properties.timeout()),
     m_inactivity(properties.inactivity()),
     m_max_fd(properties.max_fd()),
-    m_event_queue_size(properties.event_queue_size())
+    m_event_queue_size(properties.event_queue_size()),
+    m_timer_resolution(std::max(properties.timer_resolution(),
+                                std::chrono::milliseconds(1))),
+    m_origin(std::chrono::steady_clock::now()),
+    m_tick(0),
+    m_wheel(new TimerWheel()),
+    m_handles(properties.max_fd())
 {
-  const int fd = aio_create();
-  if (fd == -1) {
-    throw EventLoopException("failed to open fd for event loop", errno);
+  m_fd = -1;
+  m_stop = false;
+  m_wakeups = 0;
+
+  if (properties.backend() == Backend::uring) {
+    m_uring = Uring::open(m_event_queue_size);
+    if (m_uring) {
+      m_completions.reset(new Uring::Completion[m_event_queue_size]);
+    } else {
+      LTRACE("UringSetup", "msg: %s",
+             "io_uring not supported, falling back to aio");
+    }
+  }
+
+  if (!m_uring) {
+    const int fd = aio_create();
+    if (fd == -1) {
+      throw EventLoopException("failed to open fd for event loop", errno);
+    }
+
+    m_fd = fd;
+    m_events.reset(new aio_event_t[m_event_queue_size]);
+  }
+
+  try {
+    m_wakeup = std::make_unique<Pipe>();
+  } catch (const PipeException &e) {
+    if (m_fd > -1) {
+      ::close(m_fd);
+    }
+    throw EventLoopException("failed to open wakeup pipe", e.err());
   }
 
-  m_fd = fd;
+  m_wakeup_handler = std::make_unique<WakeupHandler>();
+  if (rmonitor(m_wakeup.get(), m_wakeup_handler.get(),
+               MonitorMode::level)->error()) {
+    if (m_fd > -1) {
+      ::close(m_fd);
+    }
+    throw EventLoopException("failed to monitor wakeup pipe", errno);
+  }
 }
 
 EventLoop::~EventLoop() {
@@ -31,14 +129,143 @@ EventLoop::~EventLoop() {
   }
 }
 
-Status EventLoop::monitor(Channel *channel, MonitorMode mode) noexcept {
-  if (channel->write_fd() < 0 || channel->read_fd() < 0) {
+Status EventLoop::attach(int id,
+                         Channel *channel,
+                         EventHandler *handler) noexcept {
+  if (id < 0 || id >= m_max_fd) {
+    return ArgInvalidFD;
+  }
+
+  m_handles[id].channel = channel;
+  m_handles[id].handler = handler;
+  m_tick = clock_tick();
+  rearm(&m_handles[id]);
+  return OK;
+}
+
+void EventLoop::detach(int id) noexcept {
+  if (id > -1 && id < m_max_fd) {
+    m_wheel->cancel(&m_handles[id].timer);
+    m_handles[id].channel = nullptr;
+    m_handles[id].handler = nullptr;
+    m_handles[id].generation++;
+  }
+}
+
+uint64_t EventLoop::user_data(int id,
+                              uint32_t op,
+                              uint32_t flags) const noexcept {
+  const uint64_t generation = id < 0 ? 0 : m_handles[id].generation;
+  return static_cast<uint32_t>(id) | (generation << 32) |
+      (static_cast<uint64_t>(op) << 48) | (static_cast<uint64_t>(flags) << 56);
+}
+
+int EventLoop::monit(int fd, int id, uint32_t events, bool edge) noexcept {
+  if (!m_uring) {
+    if (events == (EventRead | EventWrite)) {
+      return aio_monit(m_fd, fd, id, edge);
+    }
+
+    return events == EventRead ? aio_rmonit(m_fd, fd, id, edge) :
+        aio_wmonit(m_fd, fd, id, edge);
+  }
+
+  // a file descriptor can only be monitored once, as with epoll
+  if (handle(id) != nullptr) {
+    errno = EEXIST;
+    return -1;
+  }
+
+  // edge triggered monitoring maps to a multishot poll, which
+  // posts a completion for every wakeup on the file. Level
+  // triggered monitoring uses one shot polls, armed again after
+  // every completion, so that a file that remains ready keeps
+  // posting completions
+  const uint32_t mask = poll_mask(events & EventRead, events & EventWrite);
+  const uint32_t flags = events | (edge ? UringPollEdge : 0);
+  if (!m_uring->poll(fd, mask, edge, user_data(id, UringPoll, flags))) {
+    return -1;
+  }
+
+  return 0;
+}
+
+int EventLoop::unmonit(int fd, uint32_t events) noexcept {
+  if (!m_uring) {
+    if (events == (EventRead | EventWrite)) {
+      return aio_unmonit(m_fd, fd);
+    }
+
+    return events == EventRead ? aio_runmonit(m_fd, fd) :
+        aio_wunmonit(m_fd, fd);
+  }
+
+  // cancelling by file descriptor removes the polls and the
+  // submitted operations of the file. Their completions are
+  // discarded as the handle is detached
+  return m_uring->cancel(fd, user_data(-1, UringCancel, 0)) ? 0 : -1;
+}
+
+void EventLoop::touch(Channel *channel) noexcept {
+  // a channel is registered under its read fd, its write fd or
+  // both, depending on how it is monitored
+  const int ids[] = {channel->read_fd(), channel->write_fd()};
+
+  m_tick = clock_tick();
+  for (size_t i = 0; i < 2; i++) {
+    const int id = ids[i];
+    if (id < 0 || id >= m_max_fd || (i == 1 && id == ids[0])) {
+      continue;
+    }
+
+    Handle *handle = this->handle(id);
+    if (handle != nullptr && handle->channel == channel) {
+      rearm(handle);
+    }
+  }
+}
+
+uint64_t EventLoop::clock_tick() const noexcept {
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - m_origin);
+  return elapsed.count() / m_timer_resolution.count();
+}
+
+int64_t EventLoop::wait_timeout() const noexcept {
+  int64_t timeout = m_timeout.count() > 0 ? m_timeout.count() : -1;
+  int64_t ticks = m_wheel->next();
+
+  if (ticks > -1) {
+    // wait until the start of the tick in which
+    // the next deadline falls
+    int64_t next = ticks * m_timer_resolution.count();
+    timeout = timeout == -1 ? next : std::min(timeout, next);
+  }
+
+  return timeout;
+}
+
+void EventLoop::expire() noexcept {
+  m_wheel->advance(m_tick);
+
+  TimerWheel::Timer *timer;
+  while ((timer = m_wheel->expire()) != nullptr) {
+    Handle *handle = reinterpret_cast<Handle*>(timer);
+    handle->handler->on_timeout(this, handle->channel);
+  }
+}
+
+Status EventLoop::monitor(Channel *channel,
+                          EventHandler *handler,
+                          MonitorMode mode) noexcept {
+  if (channel->write_fd() < 0 || channel->read_fd() < 0 ||
+      channel->write_fd() >= m_max_fd || channel->read_fd() >= m_max_fd) {
     return ArgInvalidFD;
   }
 
   const auto edge = mode == MonitorMode::edge;
   if (channel->write_fd() != channel->read_fd()) {
-    int res = aio_wmonit(m_fd, channel->write_fd(), channel->read_fd(), mode == MonitorMode::edge);
+    int res = monit(channel->write_fd(), channel->read_fd(), EventWrite, edge);
     if (res == -1) {
       LTRACE("MonitWriteFD", "fd: %d, msg: %s, err: %s",
              channel->write_fd(),
@@ -46,17 +273,17 @@ Status EventLoop::monitor(Channel *channel, MonitorMode mode) noexcept {
       return EventLoopMonitorFDFailed;
     }
 
-    res = aio_rmonit(m_fd, channel->read_fd(), channel->read_fd(), mode == MonitorMode::edge);
+    res = monit(channel->read_fd(), channel->read_fd(), EventRead, edge);
     if (res == -1) {
       LTRACE("MonitReadFD", "fd: %d, msg: %s, err: %s",
              channel->read_fd(),
              "failed to monitor read file descriptor", strerror(errno));
-      aio_wunmonit(m_fd, channel->write_fd());
+      unmonit(channel->write_fd(), EventWrite);
       return EventLoopMonitorFDFailed;
     }
 
   } else {
-    int res = aio_monit(m_fd, channel->read_fd(), channel->read_fd(), edge);
+    int res = monit(channel->read_fd(), channel->read_fd(), EventRead | EventWrite, edge);
     if (res == -1) {
       LTRACE("MonitFD", "fd: %d, msg: %s, err: %s",
              channel->read_fd(),
@@ -65,7 +292,7 @@ Status EventLoop::monitor(Channel *channel, MonitorMode mode) noexcept {
     }
   }
 
-  return OK;
+  return attach(channel->read_fd(), channel, handler);
 }
 
 Status EventLoop::unmonitor(Channel *channel) noexcept {
@@ -74,15 +301,19 @@ Status EventLoop::unmonitor(Channel *channel) noexcept {
   }
 
   if (channel->write_fd() != channel->read_fd()) {
-    int res = aio_wunmonit(m_fd, channel->write_fd());
-    res = res == -1 && (res = aio_runmonit(
-        m_fd, channel->read_fd())) == 0 ? -1 : res;
-    if (res == -1) {
-      return EventLoopMonitorFDFailed;
+    // the channel may be monitored for reading, writing or
+    // both, so it only fails if neither fd was monitored
+    const int wres = unmonit(channel->write_fd(), EventWrite);
+    const int rres = unmonit(channel->read_fd(), EventRead);
+    detach(channel->write_fd());
+    detach(channel->read_fd());
+    if (wres == -1 && rres == -1) {
+      return EventLoopUnmonitorFDFailed;
     }
 
   } else {
-    int res = aio_unmonit(m_fd, channel->read_fd());
+    int res = unmonit(channel->read_fd(), EventRead | EventWrite);
+    detach(channel->read_fd());
     if (res == -1) {
       return EventLoopUnmonitorFDFailed;
     }
@@ -91,32 +322,38 @@ Status EventLoop::unmonitor(Channel *channel) noexcept {
   return OK;
 }
 
-Status EventLoop::rmonitor(Channel *channel, MonitorMode mode) noexcept {
-  if (channel->read_fd() < 0) {
+Status EventLoop::rmonitor(Channel *channel,
+                           EventHandler *handler,
+                           MonitorMode mode) noexcept {
+  if (channel->read_fd() < 0 || channel->read_fd() >= m_max_fd) {
     return ArgInvalidFD;
   }
 
   auto edge = MonitorMode::edge == mode;
-  const int res = aio_rmonit(m_fd, channel->read_fd(), channel->read_fd(), edge);
+  const int res = monit(channel->read_fd(), channel->read_fd(),
+                        EventRead, edge);
   if (res == -1) {
     return EventLoopUnmonitorFDFailed;
   }
 
-  return OK;
+  return attach(channel->read_fd(), channel, handler);
 }
 
-Status EventLoop::wmonitor(Channel *channel, MonitorMode mode) noexcept {
-  if (channel->write_fd() < 0) {
+Status EventLoop::wmonitor(Channel *channel,
+                           EventHandler *handler,
+                           MonitorMode mode) noexcept {
+  if (channel->write_fd() < 0 || channel->write_fd() >= m_max_fd) {
     return ArgInvalidFD;
   }
 
   auto edge = MonitorMode::edge == mode;
-  const int res = aio_wmonit(m_fd, channel->write_fd(), channel->write_fd(), edge);
+  const int res = monit(channel->write_fd(), channel->write_fd(),
+                        EventWrite, edge);
   if (res == -1) {
     return EventLoopUnmonitorFDFailed;
   }
 
-  return OK;
+  return attach(channel->write_fd(), channel, handler);
 }
 
 Status EventLoop::runmonitor(Channel *channel) noexcept {
@@ -124,7 +361,8 @@ Status EventLoop::runmonitor(Channel *channel) noexcept {
     return ArgInvalidFD;
   }
 
-  const int res = aio_runmonit(m_fd, channel->read_fd());
+  const int res = unmonit(channel->read_fd(), EventRead);
+  detach(channel->read_fd());
   if (res == -1) {
     return EventLoopUnmonitorFDFailed;
   }
@@ -137,7 +375,8 @@ Status EventLoop::wunmonitor(Channel *channel) noexcept {
     return ArgInvalidFD;
   }
 
-  int res = aio_runmonit(m_fd, channel->write_fd());
+  int res = unmonit(channel->write_fd(), EventWrite);
+  detach(channel->write_fd());
   if (res == -1) {
     return EventLoopUnmonitorFDFailed;
   }
@@ -145,6 +384,297 @@ Status EventLoop::wunmonitor(Channel *channel) noexcept {
   return OK;
 }
 
+void EventLoop::dispatch(int id, uint32_t events) noexcept {
+  if (id < 0 || id >= m_max_fd) {
+    return;
+  }
+
+  // a handler may unmonitor any channel while events are being
+  // dispatched, so the handle needs to be looked up again
+  // before every callback
+  Handle *handle = this->handle(id);
+  if (handle == nullptr) {
+    return;
+  }
+
+  rearm(handle);
+
+  if (events & EventError) {
+    handle->handler->on_error(this, handle->channel);
+    return;
+  }
+
+  if (events & EventRead) {
+    handle->handler->on_read(this, handle->channel);
+  }
+
+  if ((events & EventWrite) && (handle = this->handle(id)) != nullptr) {
+    handle->handler->on_write(this, handle->channel);
+  }
+
+  if ((events & EventHangup) && (handle = this->handle(id)) != nullptr) {
+    handle->handler->on_hangup(this, handle->channel);
+  }
+}
+
+void EventLoop::complete(const Uring::Completion *completion) noexcept {
+  const int id = static_cast<int>(completion->user_data & 0xffffffff);
+  const uint16_t generation = (completion->user_data >> 32) & 0xffff;
+  const uint32_t op = (completion->user_data >> 48) & 0xff;
+  const uint32_t flags = completion->user_data >> 56;
+
+  if (op == UringCancel || id < 0 || id >= m_max_fd) {
+    return;
+  }
+
+  Handle *handle = this->handle(id);
+  if (handle == nullptr || handle->generation != generation) {
+    return;
+  }
+
+  if (op != UringPoll) {
+    EventHandler::Operation operation;
+    switch (op) {
+      case UringRead:
+        operation = EventHandler::Operation::read;
+        break;
+      case UringWrite:
+        operation = EventHandler::Operation::write;
+        break;
+      case UringAccept:
+        operation = EventHandler::Operation::accept;
+        break;
+      default:
+        operation = EventHandler::Operation::connect;
+        break;
+    }
+
+    rearm(handle);
+    handle->handler->on_complete(this, handle->channel,
+                                 operation, completion->res);
+    return;
+  }
+
+  uint32_t events = 0;
+  if (completion->res < 0) {
+    events = EventError;
+  } else {
+    if (completion->res & POLLERR) {
+      events |= EventError;
+    }
+    if (completion->res & POLLIN) {
+      events |= EventRead;
+    }
+    if (completion->res & POLLOUT) {
+      events |= EventWrite;
+    }
+    if (completion->res & (POLLHUP | POLLRDHUP)) {
+      events |= EventHangup;
+    }
+  }
+
+  dispatch(id, events);
+
+  // polls that do not post any more completions are armed
+  // again as long as the channel remains monitored
+  handle = this->handle(id);
+  if (!completion->more && handle != nullptr &&
+      handle->generation == generation) {
+    const int fd = (flags & (EventRead | EventWrite)) == EventWrite ?
+        handle->channel->write_fd() : handle->channel->read_fd();
+    const uint32_t mask = poll_mask(flags & EventRead, flags & EventWrite);
+    if (!m_uring->poll(fd, mask, (flags & UringPollEdge) != 0,
+                       completion->user_data)) {
+      LTRACE("UringPoll", "fd: %d, msg: %s, err: %s", fd,
+             "failed to arm poll", strerror(errno));
+      handle->handler->on_error(this, handle->channel);
+    }
+  }
+}
+
+int EventLoop::operation_id(Channel *channel) noexcept {
+  const int ids[] = {channel->read_fd(), channel->write_fd()};
+
+  for (const int id : ids) {
+    if (id > -1 && id < m_max_fd) {
+      Handle *handle = this->handle(id);
+      if (handle != nullptr && handle->channel == channel) {
+        return id;
+      }
+    }
+  }
+
+  return -1;
+}
+
+Status EventLoop::bind(Channel *channel, EventHandler *handler) noexcept {
+  if (!m_uring) {
+    return EventLoopSubmitUnsupported;
+  }
+
+  if (channel->read_fd() < 0 || channel->read_fd() >= m_max_fd) {
+    return ArgInvalidFD;
+  }
+
+  return attach(channel->read_fd(), channel, handler);
+}
+
+Status EventLoop::submit_read(Channel *channel,
+                              uint8_t *dst,
+                              size_t len) noexcept {
+  if (!m_uring) {
+    return EventLoopSubmitUnsupported;
+  }
+
+  const int id = operation_id(channel);
+  if (id == -1) {
+    return ArgInvalidFD;
+  }
+
+  if (!m_uring->read(channel->read_fd(), dst, len,
+                     user_data(id, UringRead, 0))) {
+    return EventLoopSubmitFailed;
+  }
+
+  return OK;
+}
+
+Status EventLoop::submit_write(Channel *channel,
+                               const uint8_t *src,
+                               size_t len) noexcept {
+  if (!m_uring) {
+    return EventLoopSubmitUnsupported;
+  }
+
+  const int id = operation_id(channel);
+  if (id == -1) {
+    return ArgInvalidFD;
+  }
+
+  if (!m_uring->write(channel->write_fd(), src, len,
+                      user_data(id, UringWrite, 0))) {
+    return EventLoopSubmitFailed;
+  }
+
+  return OK;
+}
+
+Status EventLoop::submit_accept(Channel *channel,
+                                struct sockaddr_in *address,
+                                socklen_t *len) noexcept {
+  if (!m_uring) {
+    return EventLoopSubmitUnsupported;
+  }
+
+  const int id = operation_id(channel);
+  if (id == -1) {
+    return ArgInvalidFD;
+  }
+
+  if (!m_uring->accept(channel->read_fd(),
+                       reinterpret_cast<struct sockaddr*>(address), len,
+                       user_data(id, UringAccept, 0))) {
+    return EventLoopSubmitFailed;
+  }
+
+  return OK;
+}
+
+Status EventLoop::submit_connect(Channel *channel,
+                                 const struct sockaddr_in *address) noexcept {
+  if (!m_uring) {
+    return EventLoopSubmitUnsupported;
+  }
+
+  const int id = operation_id(channel);
+  if (id == -1) {
+    return ArgInvalidFD;
+  }
+
+  if (!m_uring->connect(channel->write_fd(),
+                        reinterpret_cast<const struct sockaddr*>(address),
+                        sizeof(struct sockaddr_in),
+                        user_data(id, UringConnect, 0))) {
+    return EventLoopSubmitFailed;
+  }
+
+  return OK;
+}
+
+void EventLoop::stop() noexcept {
+  m_stop = true;
+  wakeup();
+}
+
+void EventLoop::wakeup() noexcept {
+  const uint8_t data = 0;
+  size_t wbytes;
+
+  // if the pipe is full there is already a wakeup pending
+  m_wakeup->write(&data, 1, &wbytes);
+}
+
+int EventLoop::wait(int64_t timeout_ms) noexcept {
+  if (!m_uring) {
+    return aio_wait(m_fd, m_events.get(), m_event_queue_size, timeout_ms);
+  }
+
+  // completions that are already posted are drained
+  // without waiting for new ones
+  size_t count = m_uring->complete(m_completions.get(), m_event_queue_size);
+  if (count == 0 || m_uring->queued() > 0) {
+    if (m_uring->submit(count == 0, timeout_ms) == -1) {
+      return -1;
+    }
+
+    count += m_uring->complete(m_completions.get() + count,
+                               m_event_queue_size - count);
+  }
+
+  return static_cast<int>(count);
+}
+
 Status EventLoop::run() noexcept {
-  
+  while (!m_stop) {
+    int nevents = wait(wait_timeout());
+    m_wakeups.store(m_wakeups.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    if (nevents == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      LTRACE("WaitEvents", "fd: %d, msg: %s, err: %s", m_fd,
+             "failed to wait for events", strerror(errno));
+      return EventLoopWaitFailed;
+    }
+
+    m_tick = clock_tick();
+    for (int i = 0; i < nevents; i++) {
+      if (m_uring) {
+        complete(&m_completions[i]);
+      } else {
+        const aio_event_t *event = &m_events[i];
+        uint32_t events = 0;
+        if (aio_iserror(event)) {
+          events |= EventError;
+        }
+        if (aio_isread(event)) {
+          events |= EventRead;
+        }
+        if (aio_iswrite(event)) {
+          events |= EventWrite;
+        }
+        if (aio_isclosed(event) || aio_ispeer_closed(event)) {
+          events |= EventHangup;
+        }
+        dispatch(aio_getid(event), events);
+      }
+    }
+
+    expire();
+  }
+
+  m_stop = false;
+  return OK;
 }
@@ -5,9 +5,16 @@
 
 #include "aio.hpp"
 #include "channel.hpp"
+#include "event_handler.hpp"
+#include "pipe.hpp"
 #include "status.hpp"
+#include "timer_wheel.hpp"
+#include "uring.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <memory>
+#include <vector>
 
 class EventLoopException final {
  public:
@@ -35,6 +42,18 @@ class EventLoop final {
     edge
   };
 
+  /// Backend selects the kernel interface the loop waits on.
+  /// `aio` uses the aio_* functions (epoll or kqueue). `uring`
+  /// uses io_uring, which batches the changes to the monitored
+  /// channels and the submitted operations with the wait for
+  /// events into a single syscall. A loop created with the
+  /// `uring` backend falls back to `aio` if the kernel lacks
+  /// support for it
+  enum class Backend {
+    aio,
+    uring
+  };
+
   struct Properties final {
     struct Builder final {
 
@@ -58,25 +77,43 @@ class EventLoop final {
         return *this;
       }
 
+      Builder &timer_resolution(std::chrono::milliseconds timer_resolution) {
+        m_timer_resolution = timer_resolution;
+        return *this;
+      }
+
+      Builder &backend(Backend backend) {
+        m_backend = backend;
+        return *this;
+      }
+
       Properties build() {
         return Properties(m_timeout, m_inactivity,
-                          m_max_fd, m_event_queue_size);
+                          m_max_fd, m_event_queue_size,
+                          m_timer_resolution, m_backend);
       }
 
-      std::chrono::milliseconds m_timeout;
-      std::chrono::milliseconds m_inactivity;
+      std::chrono::milliseconds m_timeout = std::chrono::milliseconds(0);
+      std::chrono::milliseconds m_inactivity = std::chrono::milliseconds(0);
       int m_max_fd = 1024;
       size_t m_event_queue_size = 512;
+      std::chrono::milliseconds m_timer_resolution =
+          std::chrono::milliseconds(10);
+      Backend m_backend = Backend::aio;
     };
 
     Properties(const std::chrono::milliseconds &timeout,
                const std::chrono::milliseconds &inactivity,
                const int max_fd,
-               const size_t event_queue_size):
+               const size_t event_queue_size,
+               const std::chrono::milliseconds &timer_resolution,
+               const Backend backend):
         m_timeout(timeout),
         m_inactivity(inactivity),
         m_max_fd(max_fd),
-        m_event_queue_size(event_queue_size) { }
+        m_event_queue_size(event_queue_size),
+        m_timer_resolution(timer_resolution),
+        m_backend(backend) { }
 
     inline std::chrono::milliseconds timeout() const noexcept {
       return m_timeout;
@@ -94,10 +131,20 @@ class EventLoop final {
       return m_event_queue_size;
     }
 
+    inline std::chrono::milliseconds timer_resolution() const noexcept {
+      return m_timer_resolution;
+    }
+
+    inline Backend backend() const noexcept {
+      return m_backend;
+    }
+
     const std::chrono::milliseconds m_timeout;
     const std::chrono::milliseconds m_inactivity;
     const int m_max_fd;
     const size_t m_event_queue_size;
+    const std::chrono::milliseconds m_timer_resolution;
+    const Backend m_backend;
   };
 
   EventLoop();
@@ -106,10 +153,22 @@ class EventLoop final {
 
   EventLoop(const EventLoop &loop) = delete;
   EventLoop(EventLoop &&loop):
+      m_stop(loop.m_stop.load()),
+      m_wakeups(loop.m_wakeups.load()),
       m_timeout(loop.m_timeout),
       m_inactivity(loop.m_inactivity),
       m_max_fd(loop.m_max_fd),
-      m_event_queue_size(loop.m_event_queue_size)
+      m_event_queue_size(loop.m_event_queue_size),
+      m_timer_resolution(loop.m_timer_resolution),
+      m_origin(loop.m_origin),
+      m_tick(loop.m_tick),
+      m_wheel(std::move(loop.m_wheel)),
+      m_uring(std::move(loop.m_uring)),
+      m_events(std::move(loop.m_events)),
+      m_completions(std::move(loop.m_completions)),
+      m_handles(std::move(loop.m_handles)),
+      m_wakeup(std::move(loop.m_wakeup)),
+      m_wakeup_handler(std::move(loop.m_wakeup_handler))
   {
     m_fd = loop.m_fd;
     loop.m_fd = -1;
@@ -119,21 +178,35 @@ class EventLoop final {
   EventLoop& operator=(EventLoop &&loop) = delete;
 
   /// monitor monitors the channel for read and write events
-  /// with the specified MonitorMode
-  Status monitor(Channel *channel, MonitorMode mode) noexcept;
+  /// with the specified MonitorMode. Events are dispatched
+  /// to `handler` by `run`
+  Status monitor(Channel *channel,
+                 EventHandler *handler,
+                 MonitorMode mode) noexcept;
 
   /// rmonitor monitors the channel for read events
-  /// with the specified MonitorMode
-  Status rmonitor(Channel *channel, MonitorMode mode) noexcept;
+  /// with the specified MonitorMode. Events are dispatched
+  /// to `handler` by `run`
+  Status rmonitor(Channel *channel,
+                  EventHandler *handler,
+                  MonitorMode mode) noexcept;
 
   /// wmonitor monitors the channel for write events
-  /// with the specified MonitorMode
-  Status wmonitor(Channel *channel, MonitorMode mode) noexcept;
+  /// with the specified MonitorMode. Events are dispatched
+  /// to `handler` by `run`
+  Status wmonitor(Channel *channel,
+                  EventHandler *handler,
+                  MonitorMode mode) noexcept;
 
   /// unmonitor the event loop stops
   /// monitoring any events for that channel
   Status unmonitor(Channel *channel) noexcept;
 
+  /// touch restarts the inactivity period of a monitored channel.
+  /// Dispatching an event for a channel restarts its inactivity
+  /// period, touch is meant for activity the loop does not see
+  void touch(Channel *channel) noexcept;
+
   /// runmonitor the event loop stops
   /// monitoring read events for that channel
   Status runmonitor(Channel *channel) noexcept;
@@ -143,16 +216,159 @@ class EventLoop final {
   Status wunmonitor(Channel *channel) noexcept;
 
   /// run the event loop and starts processing
-  /// events for the monitored channels
+  /// events for the monitored channels. Each wakeup drains
+  /// up to `event_queue_size` events with a single call to
+  /// aio_wait, or to io_uring_enter with the `uring` backend,
+  /// which also submits the operations queued since the last
+  /// wakeup. If the loop has an inactivity period, the
+  /// channels for which no events are dispatched during that
+  /// period are notified through `on_timeout`. aio_wait blocks
+  /// until the next inactivity deadline, and never longer than
+  /// `timeout` if set. run returns once `stop` has been called
   Status run() noexcept;
 
+  /// stop makes `run` return once the events of the
+  /// current iteration have been dispatched. stop can be
+  /// called from any thread. If it is called before `run`,
+  /// the next call to `run` returns right away
+  void stop() noexcept;
+
+  /// wakeup interrupts a blocked call to aio_wait in `run`.
+  /// It can be called from any thread
+  void wakeup() noexcept;
+
+  /// wakeups returns the number of times `run` has waited for
+  /// events, each of them a call to aio_wait or io_uring_enter.
+  /// It can be called from any thread
+  inline uint64_t wakeups() const noexcept {
+    return m_wakeups.load(std::memory_order_relaxed);
+  }
+
+  /// backend returns the backend the loop runs on, which is
+  /// `aio` when the `uring` backend could not be set up
+  inline Backend backend() const noexcept {
+    return m_uring ? Backend::uring : Backend::aio;
+  }
+
+  /// bind registers the channel with the loop without monitoring
+  /// any events, so that operations can be submitted for it with
+  /// their results delivered to `handler`. A bound channel is
+  /// released with `unmonitor`. Binding requires the `uring` backend
+  Status bind(Channel *channel, EventHandler *handler) noexcept;
+
+  /// submit_read submits a read of up to len bytes from the
+  /// channel into dst. The operations submitted before an
+  /// iteration of `run` are handed to the kernel together, and
+  /// their results are delivered to the `on_complete` callback
+  /// of the handler of the channel. The channel must be
+  /// monitored by or bound to the loop, and dst must remain valid until
+  /// the operation completes or the channel is unmonitored.
+  /// Submitting operations requires the `uring` backend
+  Status submit_read(Channel *channel, uint8_t *dst, size_t len) noexcept;
+
+  /// submit_write submits a write of up to len bytes from src
+  /// to the channel. See `submit_read`
+  Status submit_write(Channel *channel,
+                      const uint8_t *src,
+                      size_t len) noexcept;
+
+  /// submit_accept submits the acceptance of a connection on a
+  /// listening socket. The result is the file descriptor of the
+  /// accepted socket, and the peer address is stored in address,
+  /// which must remain valid until the operation completes.
+  /// See `submit_read`
+  Status submit_accept(Channel *channel,
+                       struct sockaddr_in *address,
+                       socklen_t *len) noexcept;
+
+  /// submit_connect submits the connection of a socket to
+  /// address, which must remain valid until the operation
+  /// completes. See `submit_read`
+  Status submit_connect(Channel *channel,
+                        const struct sockaddr_in *address) noexcept;
+
  private:
+  /// Handle binds a monitored channel with the handler
+  /// that receives its events. Handles are indexed by
+  /// the id with which the file descriptor is registered
+  /// in the queue, so that events are mapped back to their
+  /// channel in constant time
+  struct Handle final {
+    Handle():
+        channel(nullptr),
+        handler(nullptr),
+        generation(0) { }
+
+    // timer needs to be the first member, so that
+    // an expired timer can be converted to its Handle
+    TimerWheel::Timer timer;
+    Channel *channel;
+    EventHandler *handler;
+    // generation changes every time the handle is detached,
+    // so that the completions of the operations submitted
+    // for a previous channel are told apart
+    uint16_t generation;
+  };
+
+  /// Event flags are the events `dispatch` delivers
+  /// to the handler of a channel
+  enum Event : uint32_t {
+    EventRead = 1,
+    EventWrite = 2,
+    EventHangup = 4,
+    EventError = 8
+  };
+
+  Status attach(int id, Channel *channel, EventHandler *handler) noexcept;
+  void detach(int id) noexcept;
+  void dispatch(int id, uint32_t events) noexcept;
+  void complete(const Uring::Completion *completion) noexcept;
+  int monit(int fd, int id, uint32_t events, bool edge) noexcept;
+  int unmonit(int fd, uint32_t events) noexcept;
+  int wait(int64_t timeout_ms) noexcept;
+  int operation_id(Channel *channel) noexcept;
+  uint64_t user_data(int id, uint32_t op, uint32_t flags) const noexcept;
+  void expire() noexcept;
+  int64_t wait_timeout() const noexcept;
+  uint64_t clock_tick() const noexcept;
+
+  inline void rearm(Handle *handle) noexcept {
+    if (m_inactivity.count() > 0) {
+      m_wheel->arm(&handle->timer, m_tick + inactivity_ticks());
+    }
+  }
+
+  inline uint64_t inactivity_ticks() const noexcept {
+    uint64_t ticks = m_inactivity.count() / m_timer_resolution.count();
+    return ticks > 0 ? ticks : 1;
+  }
+
+  inline Handle *handle(int id) noexcept {
+    Handle *handle = &m_handles[id];
+    return handle->channel == nullptr ? nullptr : handle;
+  }
+
   int m_fd;
+  std::atomic<bool> m_stop;
+  std::atomic<uint64_t> m_wakeups;
 
   const std::chrono::milliseconds m_timeout;
   const std::chrono::milliseconds m_inactivity;
   const int m_max_fd;
   const size_t m_event_queue_size;
+  const std::chrono::milliseconds m_timer_resolution;
+
+  std::chrono::steady_clock::time_point m_origin;
+  uint64_t m_tick;
+  std::unique_ptr<TimerWheel> m_wheel;
+
+  std::unique_ptr<Uring> m_uring;
+  std::unique_ptr<aio_event_t[]> m_events;
+  std::unique_ptr<Uring::Completion[]> m_completions;
+  std::vector<Handle> m_handles;
+
+  std::unique_ptr<Pipe> m_wakeup;
+  std::unique_ptr<EventHandler> m_wakeup_handler;
 };
 
 #endif  // OS_EVENTLOOP_H_
@@ -0,0 +1,251 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "event_loop_group.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <system_error>
+
+#include "log/log.hpp"
+
+/// Acceptor accepts the connections of the listening socket
+/// owned by a loop, and hands them over to the AcceptFunc. It keeps
+/// a spare file descriptor, so that when the process runs out of
+/// them it can still accept the pending connections to close them.
+/// Otherwise they would stay in the queue, and the listening socket,
+/// monitored in level mode, would wake up the loop over and over
+class EventLoopGroup::Acceptor final : public EventHandler {
+ public:
+  Acceptor(std::unique_ptr<TcpSocket> &&socket,
+           AcceptFunc accept_func):
+      m_socket(std::move(socket)),
+      m_accept_func(accept_func),
+      m_spare(open_spare()) { }
+
+  ~Acceptor() {
+    if (m_spare > -1) {
+      ::close(m_spare);
+    }
+  }
+
+  Acceptor(const Acceptor &acceptor) = delete;
+  Acceptor& operator=(const Acceptor &acceptor) = delete;
+
+  inline TcpSocket *socket() const noexcept {
+    return m_socket.get();
+  }
+
+  void on_read(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(channel);
+
+    // drain the accept queue to reduce the number of
+    // wakeups when many connections arrive at once
+    for (;;) {
+      std::unique_ptr<TcpSocket> socket;
+      Status status = m_socket->accept(&socket);
+      if (status->error()) {
+        const int err = m_socket->err();
+        if ((err == EMFILE || err == ENFILE) && shed()) {
+          LWARNING_PER_SEC(1, "Accept", "fd: %d, msg: %s, err: %s",
+                           m_socket->read_fd(),
+                           "out of file descriptors, closed connection",
+                           strerror(err));
+          continue;
+        }
+
+        LWARNING_PER_SEC(1, "Accept", "fd: %d, msg: %s, err: %s",
+                         m_socket->read_fd(), "failed to accept connection",
+                         strerror(err));
+        return;
+      }
+
+      if (!socket) {
+        return;
+      }
+
+      m_accept_func(loop, std::move(socket));
+    }
+  }
+
+  void on_write(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  void on_hangup(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  void on_error(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+    LTRACE("Accept", "fd: %d, msg: %s", channel->read_fd(),
+           "error on listening socket");
+  }
+
+ private:
+  static inline int open_spare() noexcept {
+    return ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+  }
+
+  /// shed closes the spare file descriptor to accept the first
+  /// pending connection and close it, then opens the spare again.
+  /// It returns false if no connection could be accepted
+  bool shed() noexcept {
+    std::unique_ptr<TcpSocket> socket;
+
+    if (m_spare > -1) {
+      ::close(m_spare);
+    }
+
+    const bool accepted = m_socket->accept(&socket) == OK && socket;
+    socket.reset();
+    m_spare = open_spare();
+    return accepted;
+  }
+
+  std::unique_ptr<TcpSocket> m_socket;
+  AcceptFunc m_accept_func;
+  int m_spare;
+};
+
+EventLoopGroup::EventLoopGroup(size_t size,
+                               const EventLoop::Properties &properties,
+                               bool pin):
+    m_pin(pin),
+    m_results(size, OK) {
+  for (size_t i = 0; i < size; i++) {
+    m_loops.push_back(std::make_unique<EventLoop>(properties));
+  }
+}
+
+EventLoopGroup::~EventLoopGroup() {
+  stop();
+  join();
+}
+
+Status EventLoopGroup::listen(const struct sockaddr_in *address,
+                              int backlog,
+                              AcceptFunc accept_func) noexcept {
+  struct sockaddr_in bind_address;
+  memcpy(&bind_address, address, sizeof(struct sockaddr_in));
+
+  for (size_t i = 0; i < m_loops.size(); i++) {
+    std::unique_ptr<TcpSocket> socket;
+    try {
+      socket = TcpSocket::open_ptr(SocketDomain::IPv4);
+    } catch (const SocketException &e) {
+      LTRACE("Listen", "msg: %s, err: %s", e.msg(), strerror(e.err()));
+      return SocketListenFailed;
+    }
+
+    Status status = socket->bind(&bind_address, true);
+    if (status->error()) {
+      return status;
+    }
+
+    status = socket->listen(backlog);
+    if (status->error()) {
+      return status;
+    }
+
+    // the rest of the sockets need to share the port
+    // with the first one
+    socklen_t len;
+    bind_address.sin_port = socket->local_address(&len)->sin_port;
+
+    auto acceptor = std::make_unique<Acceptor>(std::move(socket),
+                                               accept_func);
+    status = m_loops[i]->rmonitor(acceptor->socket(), acceptor.get(),
+                                  EventLoop::MonitorMode::level);
+    if (status->error()) {
+      return status;
+    }
+
+    m_acceptors.push_back(std::move(acceptor));
+  }
+
+  return OK;
+}
+
+const struct sockaddr_in *EventLoopGroup::local_address(
+    socklen_t *len) const noexcept {
+  if (m_acceptors.empty()) {
+    *len = 0;
+    return nullptr;
+  }
+
+  return m_acceptors[0]->socket()->local_address(len);
+}
+
+void EventLoopGroup::run_loop(size_t index) noexcept {
+#ifdef __linux__
+  if (m_pin) {
+    cpu_set_t cpuset;
+    unsigned int ncpus = std::thread::hardware_concurrency();
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(ncpus > 0 ? index % ncpus : 0, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(),
+                               sizeof(cpu_set_t), &cpuset) != 0) {
+      LTRACE("PinThread", "loop: %zu, msg: %s", index,
+             "failed to pin loop thread to core");
+    }
+  }
+#endif
+
+  m_results[index] = m_loops[index]->run();
+}
+
+Status EventLoopGroup::start() noexcept {
+  if (!m_threads.empty()) {
+    return OK;
+  }
+
+  try {
+    for (size_t i = 0; i < m_loops.size(); i++) {
+      m_threads.emplace_back(&EventLoopGroup::run_loop, this, i);
+    }
+  } catch (const std::system_error &e) {
+    LTRACE("StartLoop", "msg: %s", e.what());
+    stop();
+    join();
+    return EventLoopGroupStartFailed;
+  }
+
+  return OK;
+}
+
+void EventLoopGroup::stop() noexcept {
+  for (auto &loop : m_loops) {
+    loop->stop();
+  }
+}
+
+Status EventLoopGroup::join() noexcept {
+  Status status = OK;
+
+  for (auto &thread : m_threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  m_threads.clear();
+
+  for (auto result : m_results) {
+    if (result->error() && status->ok()) {
+      status = result;
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef OS_EVENTLOOPGROUP_H_
+#define OS_EVENTLOOPGROUP_H_
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "event_loop.hpp"
+#include "socket.hpp"
+#include "status.hpp"
+
+/// EventLoopGroup runs a set of EventLoop, each one of them on
+/// its own thread. When listening for connections, every loop
+/// owns its own listening socket bound to the same address with
+/// SO_REUSEPORT, so that the kernel spreads the incoming connections
+/// between the loops and a connection is always handled by the
+/// thread of the loop that accepted it
+class EventLoopGroup final {
+ public:
+  /// AcceptFunc is called from the thread of `loop` for every
+  /// connection accepted by that loop. The callee takes ownership
+  /// of the socket, and it is expected to monitor it in `loop`
+  using AcceptFunc = std::function<void(EventLoop *loop,
+                                        std::unique_ptr<TcpSocket> &&socket)>;
+
+  /// EventLoopGroup creates `size` loops with the provided
+  /// properties. If `pin` is set, the thread of the loop with
+  /// index i is pinned to the core i modulo the number of cores
+  EventLoopGroup(size_t size,
+                 const EventLoop::Properties &properties,
+                 bool pin = true);
+  ~EventLoopGroup();
+
+  EventLoopGroup(const EventLoopGroup &group) = delete;
+  EventLoopGroup(EventLoopGroup &&group) = delete;
+  EventLoopGroup& operator=(const EventLoopGroup &group) = delete;
+  EventLoopGroup& operator=(EventLoopGroup &&group) = delete;
+
+  inline size_t size() const noexcept {
+    return m_loops.size();
+  }
+
+  inline EventLoop *loop(size_t index) const noexcept {
+    return m_loops[index].get();
+  }
+
+  /// listen opens a listening socket for each loop in the group
+  /// bound to `address`. If the port in `address` is 0, the port
+  /// picked by the kernel for the first socket is used for the rest,
+  /// and it can be retrieved with `local_address`. listen must be
+  /// called before `start`
+  Status listen(const struct sockaddr_in *address,
+                int backlog,
+                AcceptFunc accept_func) noexcept;
+
+  /// local_address returns the address the listening sockets
+  /// are bound to
+  const struct sockaddr_in *local_address(socklen_t *len) const noexcept;
+
+  /// start starts running each loop on its own thread
+  Status start() noexcept;
+
+  /// stop signals all the loops to stop. It can be called
+  /// from any thread, including the threads of the loops
+  void stop() noexcept;
+
+  /// join waits until all the loops have stopped running. It
+  /// returns the first error returned by a loop, if any
+  Status join() noexcept;
+
+ private:
+  class Acceptor;
+
+  void run_loop(size_t index) noexcept;
+
+  bool m_pin;
+  std::vector<std::unique_ptr<EventLoop>> m_loops;
+  std::vector<std::unique_ptr<Acceptor>> m_acceptors;
+  std::vector<std::thread> m_threads;
+  std::vector<Status> m_results;
+};
+
+#endif  // OS_EVENTLOOPGROUP_H_
@@ -0,0 +1,503 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "event_loop.hpp"
+#include "event_loop_group.hpp"
+#include "pipe.hpp"
+#include "socket.hpp"
+
+class CountHandler final : public EventHandler {
+ public:
+  void on_read(EventLoop *loop, Channel *channel) noexcept override {
+    uint8_t data[16];
+    size_t rbytes;
+
+    reads++;
+    channel->read(data, sizeof(data), &rbytes);
+    rbytes_total += rbytes;
+    loop->stop();
+  }
+
+  void on_write(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(channel);
+    writes++;
+    loop->stop();
+  }
+
+  void on_hangup(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+    hangups++;
+  }
+
+  void on_error(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(channel);
+    errors++;
+    loop->stop();
+  }
+
+  void on_timeout(EventLoop *loop, Channel *channel) noexcept override {
+    timeouts++;
+    loop->unmonitor(channel);
+    loop->stop();
+  }
+
+  void on_complete(EventLoop *loop,
+                   Channel *channel,
+                   Operation operation,
+                   int result) noexcept override {
+    (void)(channel);
+    completions++;
+    last_operation = operation;
+    last_result = result;
+    loop->stop();
+  }
+
+  int timeouts = 0;
+  int reads = 0;
+  int writes = 0;
+  int hangups = 0;
+  int errors = 0;
+  int completions = 0;
+  Operation last_operation = Operation::read;
+  int last_result = 0;
+  size_t rbytes_total = 0;
+};
+
+static int test_event_loop_dispatch_read() {
+  EventLoop loop;
+  Pipe pipe;
+  CountHandler handler;
+  size_t wbytes;
+  const uint8_t data[] = "content";
+
+  ASSERT_EQ(loop.rmonitor(&pipe, &handler, EventLoop::MonitorMode::level), OK);
+  ASSERT_EQ(pipe.write(data, 7, &wbytes), OK);
+  ASSERT_EQ(wbytes, 7);
+  ASSERT_EQ(loop.wakeups(), 0);
+
+  ASSERT_EQ(loop.run(), OK);
+  ASSERT_EQ(handler.reads, 1);
+  ASSERT_EQ(handler.rbytes_total, 7);
+  ASSERT_EQ(handler.errors, 0);
+  ASSERT_EQ(loop.wakeups(), 1);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_dispatch_write() {
+  EventLoop loop;
+  Pipe pipe;
+  CountHandler handler;
+
+  ASSERT_EQ(loop.wmonitor(&pipe, &handler, EventLoop::MonitorMode::level), OK);
+  ASSERT_EQ(loop.run(), OK);
+  ASSERT_EQ(handler.writes, 1);
+  ASSERT_EQ(handler.reads, 0);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_unmonitor() {
+  EventLoop loop;
+  Pipe pipe1, pipe2;
+  CountHandler handler1, handler2;
+  size_t wbytes;
+  const uint8_t data[] = "content";
+
+  ASSERT_EQ(loop.rmonitor(&pipe1, &handler1, EventLoop::MonitorMode::level), OK);
+  ASSERT_EQ(loop.rmonitor(&pipe2, &handler2, EventLoop::MonitorMode::level), OK);
+  ASSERT_EQ(loop.runmonitor(&pipe1), OK);
+
+  ASSERT_EQ(pipe1.write(data, 7, &wbytes), OK);
+  ASSERT_EQ(pipe2.write(data, 7, &wbytes), OK);
+
+  ASSERT_EQ(loop.run(), OK);
+  ASSERT_EQ(handler1.reads, 0);
+  ASSERT_EQ(handler2.reads, 1);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_max_fd() {
+  auto properties = EventLoop::Properties::Builder().max_fd(64).build();
+  EventLoop loop(properties);
+  std::vector<std::unique_ptr<Pipe>> pipes;
+  CountHandler handler;
+
+  // open pipes until one gets file descriptors above max_fd
+  do {
+    pipes.push_back(std::make_unique<Pipe>());
+  } while (pipes.back()->read_fd() < 64);
+
+  ASSERT_EQ(loop.rmonitor(pipes.back().get(), &handler,
+                          EventLoop::MonitorMode::level),
+            ArgInvalidFD);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_max_fd_too_low() {
+  auto properties = EventLoop::Properties::Builder().max_fd(1).build();
+  bool thrown = false;
+
+  try {
+    EventLoop loop(properties);
+  } catch (const EventLoopException &e) {
+    thrown = true;
+  }
+
+  ASSERT_TRUE(thrown);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_stop_before_run() {
+  EventLoop loop;
+
+  loop.stop();
+  ASSERT_EQ(loop.run(), OK);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_inactivity() {
+  auto properties = EventLoop::Properties::Builder()
+      .inactivity(std::chrono::milliseconds(20))
+      .timer_resolution(std::chrono::milliseconds(1))
+      .build();
+  EventLoop loop(properties);
+  Pipe pipe;
+  CountHandler handler;
+
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(loop.rmonitor(&pipe, &handler, EventLoop::MonitorMode::level), OK);
+  ASSERT_EQ(loop.run(), OK);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(handler.timeouts, 1);
+  ASSERT_EQ(handler.reads, 0);
+  ASSERT_TRUE(elapsed >= std::chrono::milliseconds(19));
+
+  return EXIT_SUCCESS;
+}
+
+/// TouchHandler touches a channel every time it reads
+class TouchHandler final : public EventHandler {
+ public:
+  explicit TouchHandler(Channel *touched):
+      m_touched(touched) { }
+
+  void on_read(EventLoop *loop, Channel *channel) noexcept override {
+    uint8_t data[16];
+    size_t rbytes;
+
+    channel->read(data, sizeof(data), &rbytes);
+    loop->touch(m_touched);
+  }
+
+  void on_write(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  void on_hangup(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  void on_error(EventLoop *loop, Channel *channel) noexcept override {
+    (void)(loop);
+    (void)(channel);
+  }
+
+  void on_timeout(EventLoop *loop, Channel *channel) noexcept override {
+    loop->unmonitor(channel);
+  }
+
+ private:
+  Channel *m_touched;
+};
+
+static int test_event_loop_touch_write() {
+  auto properties = EventLoop::Properties::Builder()
+      .inactivity(std::chrono::milliseconds(40))
+      .timer_resolution(std::chrono::milliseconds(1))
+      .build();
+  EventLoop loop(properties);
+  Pipe wpipe, rpipe;
+  CountHandler handler;
+  TouchHandler touch_handler(&wpipe);
+  uint8_t data[4096];
+  size_t wbytes;
+
+  // a full pipe is not writable, so the loop
+  // only sees it through the touches
+  memset(data, 0, sizeof(data));
+  do {
+    ASSERT_EQ(wpipe.write(data, sizeof(data), &wbytes), OK);
+  } while (wbytes == sizeof(data));
+
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(loop.wmonitor(&wpipe, &handler, EventLoop::MonitorMode::level),
+            OK);
+  ASSERT_EQ(loop.rmonitor(&rpipe, &touch_handler,
+                          EventLoop::MonitorMode::level), OK);
+
+  std::thread writer([&rpipe]() {
+    const uint8_t byte = 0;
+    size_t wbytes;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    rpipe.write(&byte, 1, &wbytes);
+  });
+
+  Status status = loop.run();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  writer.join();
+
+  ASSERT_EQ(status, OK);
+  ASSERT_EQ(handler.timeouts, 1);
+  ASSERT_EQ(handler.writes, 0);
+  ASSERT_TRUE(elapsed >= std::chrono::milliseconds(69));
+
+  return EXIT_SUCCESS;
+}
+
+static EventLoop::Properties uring_properties() {
+  return EventLoop::Properties::Builder()
+      .backend(EventLoop::Backend::uring)
+      .build();
+}
+
+static int test_event_loop_uring_dispatch_read() {
+  EventLoop loop(uring_properties());
+  Pipe pipe;
+  CountHandler handler;
+  size_t wbytes;
+  const uint8_t data[] = "content";
+
+  ASSERT_EQ(loop.rmonitor(&pipe, &handler, EventLoop::MonitorMode::level), OK);
+  ASSERT_EQ(pipe.write(data, 7, &wbytes), OK);
+  ASSERT_EQ(loop.run(), OK);
+  ASSERT_EQ(handler.reads, 1);
+  ASSERT_EQ(handler.rbytes_total, 7);
+
+  // level triggered polls are armed again after every event
+  ASSERT_EQ(pipe.write(data, 7, &wbytes), OK);
+  ASSERT_EQ(loop.run(), OK);
+  ASSERT_EQ(handler.reads, 2);
+  ASSERT_EQ(handler.rbytes_total, 14);
+  ASSERT_EQ(handler.errors, 0);
+
+  ASSERT_EQ(loop.unmonitor(&pipe), OK);
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_uring_submit() {
+  EventLoop loop(uring_properties());
+  if (loop.backend() != EventLoop::Backend::uring) {
+    ASSERT_EQ(loop.bind(nullptr, nullptr), EventLoopSubmitUnsupported);
+    return EXIT_SUCCESS;
+  }
+
+  Pipe pipe;
+  CountHandler handler;
+  uint8_t dst[16];
+  const uint8_t data[] = "content";
+
+  ASSERT_EQ(loop.bind(&pipe, &handler), OK);
+  ASSERT_EQ(loop.submit_read(&pipe, dst, sizeof(dst)), OK);
+  ASSERT_EQ(loop.submit_write(&pipe, data, 7), OK);
+
+  // the write and the read are submitted with the same
+  // call, and the read completes once the write has
+  while (handler.completions < 2) {
+    ASSERT_EQ(loop.run(), OK);
+  }
+
+  ASSERT_EQ(handler.last_operation, EventHandler::Operation::read);
+  ASSERT_EQ(handler.last_result, 7);
+  ASSERT_EQ(memcmp(dst, data, 7), 0);
+  ASSERT_EQ(handler.reads, 0);
+
+  ASSERT_EQ(loop.unmonitor(&pipe), OK);
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_uring_submit_accept() {
+  EventLoop loop(uring_properties());
+  if (loop.backend() != EventLoop::Backend::uring) {
+    return EXIT_SUCCESS;
+  }
+
+  TcpSocket server(SocketDomain::IPv4);
+  TcpSocket client(SocketDomain::IPv4);
+  CountHandler handler;
+  struct sockaddr_in address;
+  struct sockaddr_in remote;
+  socklen_t remote_len = sizeof(remote);
+  socklen_t len;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(server.bind(&address), OK);
+  ASSERT_EQ(server.listen(4), OK);
+  ASSERT_EQ(loop.bind(&server, &handler), OK);
+  ASSERT_EQ(loop.submit_accept(&server, &remote, &remote_len), OK);
+  ASSERT_EQ(client.connect(server.local_address(&len)), OK);
+
+  ASSERT_EQ(loop.run(), OK);
+  ASSERT_EQ(handler.completions, 1);
+  ASSERT_EQ(handler.last_operation, EventHandler::Operation::accept);
+  ASSERT_TRUE(handler.last_result > -1);
+
+  auto accepted = TcpSocket::adopt_ptr(handler.last_result,
+                                       &remote, remote_len);
+  ASSERT_EQ(accepted->read_fd(), handler.last_result);
+  ASSERT_EQ(loop.unmonitor(&server), OK);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_group_accept() {
+  auto properties = EventLoop::Properties::Builder().build();
+  EventLoopGroup group(2, properties);
+  std::atomic<int> accepted(0);
+  struct sockaddr_in address;
+  socklen_t len;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(group.listen(&address, 16,
+                         [&](EventLoop *loop,
+                             std::unique_ptr<TcpSocket> &&socket) {
+                           (void)(loop);
+                           (void)(socket);
+                           if (++accepted == 4) {
+                             group.stop();
+                           }
+                         }), OK);
+  ASSERT_TRUE(group.local_address(&len)->sin_port != 0);
+  ASSERT_EQ(group.start(), OK);
+
+  TcpSocket clients[4] = {
+    TcpSocket(SocketDomain::IPv4), TcpSocket(SocketDomain::IPv4),
+    TcpSocket(SocketDomain::IPv4), TcpSocket(SocketDomain::IPv4)
+  };
+
+  for (auto &client : clients) {
+    ASSERT_EQ(client.connect(group.local_address(&len)), OK);
+  }
+
+  ASSERT_EQ(group.join(), OK);
+  ASSERT_EQ(accepted.load(), 4);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_event_loop_group_accept_out_of_fds() {
+  auto properties = EventLoop::Properties::Builder().build();
+  EventLoopGroup group(1, properties);
+  std::atomic<int> accepted(0);
+  struct sockaddr_in address;
+  struct rlimit limit, lowered;
+  socklen_t len;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(group.listen(&address, 16,
+                         [&](EventLoop *loop,
+                             std::unique_ptr<TcpSocket> &&socket) {
+                           (void)(loop);
+                           (void)(socket);
+                           accepted++;
+                         }), OK);
+  ASSERT_EQ(group.start(), OK);
+
+  TcpSocket clients[4] = {
+    TcpSocket(SocketDomain::IPv4), TcpSocket(SocketDomain::IPv4),
+    TcpSocket(SocketDomain::IPv4), TcpSocket(SocketDomain::IPv4)
+  };
+
+  // the lowest free descriptor is the first one the
+  // process cannot open once the limit is lowered to it
+  const int free_fd = open("/dev/null", O_RDONLY);
+  ASSERT_TRUE(free_fd > -1);
+  close(free_fd);
+  ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+  lowered = limit;
+  lowered.rlim_cur = static_cast<rlim_t>(free_fd);
+  ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+
+  for (auto &client : clients) {
+    ASSERT_EQ(client.connect(group.local_address(&len)), OK);
+  }
+
+  // the pending connections are accepted with the
+  // spare descriptor and closed
+  for (auto &client : clients) {
+    struct pollfd pfd = {client.read_fd(), POLLIN, 0};
+    uint8_t data;
+
+    ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+    ASSERT_TRUE(recv(client.read_fd(), &data, sizeof(data), 0) <= 0);
+  }
+
+  // and the listening socket does not wake up the loop again
+  const uint64_t wakeups = group.loop(0)->wakeups();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const uint64_t spins = group.loop(0)->wakeups() - wakeups;
+
+  ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+  group.stop();
+  ASSERT_EQ(group.join(), OK);
+  ASSERT_EQ(accepted.load(), 0);
+  ASSERT_TRUE(spins < 10);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_event_loop_dispatch_read());
+  TEST_RUN(ctx, test_event_loop_dispatch_write());
+  TEST_RUN(ctx, test_event_loop_unmonitor());
+  TEST_RUN(ctx, test_event_loop_max_fd());
+  TEST_RUN(ctx, test_event_loop_max_fd_too_low());
+  TEST_RUN(ctx, test_event_loop_stop_before_run());
+  TEST_RUN(ctx, test_event_loop_inactivity());
+  TEST_RUN(ctx, test_event_loop_touch_write());
+  TEST_RUN(ctx, test_event_loop_uring_dispatch_read());
+  TEST_RUN(ctx, test_event_loop_uring_submit());
+  TEST_RUN(ctx, test_event_loop_uring_submit_accept());
+  TEST_RUN(ctx, test_event_loop_group_accept());
+  TEST_RUN(ctx, test_event_loop_group_accept_out_of_fds());
+
+  return TEST_RELEASE(ctx);
+}
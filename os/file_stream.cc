@@ -4,6 +4,8 @@
 
 #include "status.hpp"
 
+#include "io/iovec.hpp"
+
 FileStream FileStream::open(
     const char *name,
     int flags,
@@ -41,11 +43,60 @@ FileStream FileStream::create_tmp(const char *dir) {
 std::unique_ptr<FileStream> FileStream::create_tmp_ptr(const char *dir) {
   return open_ptr(dir, O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
 }
+
+FileStream FileStream::open_direct(const char *name, size_t block_size) {
+  FileStream file(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT,
+                  0666);
+  file.m_block_size = block_size;
+  return file;
+}
+
+std::unique_ptr<FileStream> FileStream::open_direct_ptr(const char *name,
+                                                        size_t block_size) {
+  auto file = open_ptr(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT,
+                       0666);
+  file->m_block_size = block_size;
+  return file;
+}
 #endif
 
+Status FileStream::write_direct(const uint8_t *src,
+                                size_t len,
+                                size_t *wbytes) noexcept {
+  const size_t blocks = len / m_block_size * m_block_size;
+  const size_t padded = (len + m_block_size - 1) / m_block_size * m_block_size;
+  ssize_t res = ::pwrite(m_fd, src, padded, m_offset);
+
+  if (res < 0) {
+    m_err = errno;
+    *wbytes = 0;
+    return FileWriteFailed;
+  }
+
+  const size_t written = static_cast<size_t>(res) / m_block_size * m_block_size;
+  *wbytes = written < blocks ? written : blocks;
+
+  // the padding of the tail block is cut so that the file keeps
+  // its length, and the offset stays at the start of the block
+  // so that the next write completes it
+  if (static_cast<size_t>(res) == padded && padded > blocks &&
+      ftruncate(m_fd, m_offset + static_cast<off_t>(len)) == -1) {
+    m_err = errno;
+    *wbytes = 0;
+    return FileWriteFailed;
+  }
+
+  m_offset += static_cast<off_t>(*wbytes);
+  return OK;
+}
+
 Status FileStream::write(const uint8_t *src,
                          size_t len,
                          size_t *wbytes) noexcept {
+  if (m_block_size > 0) {
+    return write_direct(src, len, wbytes);
+  }
+
   ssize_t res = ::write(m_fd, src, len);
 
   if (res < 0) {
@@ -74,3 +125,48 @@ Status FileStream::read(uint8_t *dst,
     return OK;
   }
 }
+
+Status FileStream::write_v(const struct iovec *iov,
+                           size_t iovcnt,
+                           size_t *wbytes) noexcept {
+  // each region has to follow the rules of a direct write
+  if (m_block_size > 0) {
+    return Sink::write_v(iov, iovcnt, wbytes);
+  }
+
+  IovCursor cursor(iov, iovcnt);
+  int count;
+
+  const struct iovec *batch = cursor.batch(&count);
+  ssize_t res = ::writev(m_fd, batch, count);
+
+  if (res < 0) {
+    m_err = errno;
+    *wbytes = 0;
+    return FileWriteFailed;
+
+  } else {
+    *wbytes = static_cast<size_t>(res);
+    return OK;
+  }
+}
+
+Status FileStream::read_v(const struct iovec *iov,
+                          size_t iovcnt,
+                          size_t *rbytes) noexcept {
+  IovCursor cursor(iov, iovcnt);
+  int count;
+
+  const struct iovec *batch = cursor.batch(&count);
+  ssize_t res = ::readv(m_fd, batch, count);
+
+  if (res < 0) {
+    m_err = errno;
+    *rbytes = 0;
+    return FileReadFailed;
+
+  } else {
+    *rbytes = static_cast<size_t>(res);
+    return OK;
+  }
+}
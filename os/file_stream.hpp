@@ -35,8 +35,14 @@ class FileException {
 
 class FileStream final : public Sink, public Source {
  public:
+  /// DIRECT_BLOCK_SIZE is the default block size of the
+  /// files opened with `open_direct`
+  static constexpr size_t DIRECT_BLOCK_SIZE = 4096;
+
   FileStream(const char *pathname, int flags, mode_t mode):
-      m_err(0) {
+      m_err(0),
+      m_block_size(0),
+      m_offset(0) {
     m_fd = ::open(pathname, flags, mode);
     if (m_fd == -1) {
       throw FileException("failed to open file", errno);
@@ -54,6 +60,8 @@ class FileStream final : public Sink, public Source {
   FileStream(FileStream &&file) {
     this->m_fd = file.m_fd;
     this->m_err = file.m_err;
+    this->m_block_size = file.m_block_size;
+    this->m_offset = file.m_offset;
     file.m_fd = -1;
   }
 
@@ -77,19 +85,55 @@ class FileStream final : public Sink, public Source {
   static FileStream create_tmp(const char *dir);
   static std::unique_ptr<FileStream> create_tmp_ptr(const char *dir);
 
+  /// open_direct opens a file for writing with O_DIRECT, so that
+  /// writes bypass the page cache. In this mode `src` must be aligned
+  /// to `block_size`. When `len` is not a multiple of the block size
+  /// the memory of `src` must extend to the end of the last block.
+  /// That block is written whole, and the file is truncated back to
+  /// its length. `wbytes` only counts whole blocks, and the tail is
+  /// expected again at the start of the next write, which rewrites
+  /// its block. A BufferedWriter with a block size does all this
+  static FileStream open_direct(
+      const char *pathname, size_t block_size = DIRECT_BLOCK_SIZE);
+  static std::unique_ptr<FileStream> open_direct_ptr(
+      const char *pathname, size_t block_size = DIRECT_BLOCK_SIZE);
+
   inline int err() const noexcept {
     return m_err;
   }
 
+  /// fd returns the file descriptor of the file
+  inline int fd() const noexcept {
+    return m_fd;
+  }
+
+  /// block_size returns the block size of a file opened
+  /// with `open_direct` and 0 for any other file
+  inline size_t block_size() const noexcept {
+    return m_block_size;
+  }
+
   Status write(const uint8_t *src,
                size_t len,
                size_t *wbytes) noexcept;
   Status read(uint8_t *src,
               size_t len,
               size_t *rbytes) noexcept;
+  Status write_v(const struct iovec *iov,
+                 size_t iovcnt,
+                 size_t *wbytes) noexcept;
+  Status read_v(const struct iovec *iov,
+                size_t iovcnt,
+                size_t *rbytes) noexcept;
  private:
+  Status write_direct(const uint8_t *src,
+                      size_t len,
+                      size_t *wbytes) noexcept;
+
   int m_err;
   int m_fd;
+  size_t m_block_size;
+  off_t m_offset;
 };
 
 
@@ -0,0 +1,74 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer/buffer_pool.hpp"
+#include "buffer/buffered_writer.hpp"
+#include "file_stream.hpp"
+
+static int test_file_stream_direct_buffered_writer() {
+  char pathname[] = "/tmp/file_stream_XXXXXX";
+  char record[1000], readdata[8 * 1024];
+  size_t wbytes, fbytes, rbytes;
+  struct stat st;
+
+  close(mkstemp(pathname));
+
+  {
+    BufferedWriter writer(FileStream::open_direct_ptr(pathname),
+                          BufferPool::make_stream_buffer(16 * 1024),
+                          FileStream::DIRECT_BLOCK_SIZE);
+
+    for (int i = 0; i < 5; i++) {
+      memset(record, 'a' + i, sizeof(record));
+      ASSERT_EQ(writer.write(reinterpret_cast<const uint8_t*>(record),
+                             sizeof(record), &wbytes), OK);
+      ASSERT_EQ(wbytes, sizeof(record));
+    }
+
+    // the unaligned tail is written padded and the file is cut
+    // back to its length, but only the whole block is reported
+    ASSERT_EQ(writer.flush(&fbytes), OK);
+    ASSERT_EQ(fbytes, FileStream::DIRECT_BLOCK_SIZE);
+    ASSERT_EQ(stat(pathname, &st), 0);
+    ASSERT_EQ(st.st_size, 5000);
+
+    for (int i = 5; i < 8; i++) {
+      memset(record, 'a' + i, sizeof(record));
+      ASSERT_EQ(writer.write(reinterpret_cast<const uint8_t*>(record),
+                             sizeof(record), &wbytes), OK);
+    }
+
+    // the tail of the first flush is written again, and
+    // it still does not fill a block
+    ASSERT_EQ(writer.flush(&fbytes), OK);
+    ASSERT_EQ(fbytes, 0);
+    ASSERT_EQ(stat(pathname, &st), 0);
+    ASSERT_EQ(st.st_size, 8000);
+  }
+
+  auto file = FileStream::open_read(pathname);
+  ASSERT_EQ(file.read(reinterpret_cast<uint8_t*>(readdata),
+                      sizeof(readdata), &rbytes), OK);
+  ASSERT_EQ(rbytes, 8000);
+  for (int i = 0; i < 8; i++) {
+    memset(record, 'a' + i, sizeof(record));
+    ASSERT_MEM_EQ(readdata + i * sizeof(record), record, sizeof(record));
+  }
+
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_file_stream_direct_buffered_writer());
+
+  return TEST_RELEASE(ctx);
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "file_watcher.hpp"
+
+#include <limits.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+
+// IN_CREATE is left out on purpose, a created file is
+// reported once it is closed after being written
+static constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+FileWatcher::FileWatcher(const char *pathname):
+    m_fd(-1),
+    m_wd(-1),
+    m_err(0) {
+  const char *slash = strrchr(pathname, '/');
+  m_dir = slash == nullptr ? std::string(".") :
+      slash == pathname ? std::string("/") :
+      std::string(pathname, slash - pathname);
+  m_name = slash == nullptr ? pathname : slash + 1;
+
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_fd == -1) {
+    throw FileException("failed to create inotify instance", errno);
+  }
+
+  m_wd = inotify_add_watch(m_fd, m_dir.c_str(), WATCH_MASK);
+  if (m_wd == -1) {
+    int err = errno;
+    close(m_fd);
+    m_fd = -1;
+    throw FileException("failed to watch file directory", err);
+  }
+}
+
+Status FileWatcher::poll(bool *changed) noexcept {
+  alignas(struct inotify_event) char events[4096];
+
+  *changed = false;
+  for (;;) {
+    ssize_t res = ::read(m_fd, events, sizeof(events));
+    if (res == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        m_err = errno;
+        return FileWatchFailed;
+      }
+
+      // the watch is gone once the directory has been removed,
+      // and it is added again once the directory is back, at
+      // which point the file may have been written
+      if (m_wd == -1) {
+        m_wd = inotify_add_watch(m_fd, m_dir.c_str(), WATCH_MASK);
+        if (m_wd == -1) {
+          m_err = errno;
+          return FileWatchFailed;
+        }
+
+        *changed = true;
+      }
+
+      return OK;
+    }
+
+    for (ssize_t offset = 0; offset < res; ) {
+      const struct inotify_event *event =
+          reinterpret_cast<const struct inotify_event*>(events + offset);
+
+      // events were dropped when the queue overflowed, and
+      // any of them may have been a write of the file
+      if (event->mask & IN_Q_OVERFLOW) {
+        *changed = true;
+      } else if ((event->mask & IN_IGNORED) && event->wd == m_wd) {
+        m_wd = -1;
+      } else if (event->len > 0 && m_name.compare(event->name) == 0) {
+        *changed = true;
+      }
+
+      offset += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
+
+#else
+
+FileWatcher::FileWatcher(const char *pathname):
+    m_fd(-1),
+    m_wd(-1),
+    m_err(ENOSYS) {
+  (void)(pathname);
+  throw FileException("file watching is not supported", ENOSYS);
+}
+
+Status FileWatcher::poll(bool *changed) noexcept {
+  *changed = false;
+  m_err = ENOSYS;
+  return FileWatchFailed;
+}
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef OS_FILEWATCHER_H_
+#define OS_FILEWATCHER_H_
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "file_stream.hpp"
+#include "status.hpp"
+
+/// FileWatcher uses inotify to find out when a file has been
+/// written, so that it can be reloaded without polling it. It
+/// watches the directory of the file rather than the file itself,
+/// so that it keeps working when the file is replaced with a
+/// rename, as most editors and deployment tools do. The
+/// descriptor is non blocking and can be monitored by an EventLoop.
+/// Where inotify is not available the constructor throws a
+/// FileException with ENOSYS
+class FileWatcher final {
+ public:
+  explicit FileWatcher(const char *pathname);
+
+  ~FileWatcher() {
+    if (m_fd > -1) {
+      close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+  FileWatcher(const FileWatcher &watcher) = delete;
+  FileWatcher(FileWatcher &&watcher):
+      m_fd(watcher.m_fd),
+      m_wd(watcher.m_wd),
+      m_err(watcher.m_err),
+      m_dir(std::move(watcher.m_dir)),
+      m_name(std::move(watcher.m_name)) {
+    watcher.m_fd = -1;
+  }
+
+  FileWatcher& operator=(const FileWatcher &watcher) = delete;
+  FileWatcher& operator=(FileWatcher &&watcher) = delete;
+
+  /// fd returns the inotify descriptor, which becomes
+  /// readable when there are events to poll
+  inline int fd() const noexcept {
+    return m_fd;
+  }
+
+  inline int err() const noexcept {
+    return m_err;
+  }
+
+  /// poll reads all the pending events without blocking and
+  /// sets `changed` to true if the file was written and closed,
+  /// or renamed into place, since the last call. It is also set
+  /// when events were lost to an overflow of the queue. Once the
+  /// directory is removed, poll fails until it is created again
+  Status poll(bool *changed) noexcept;
+
+ private:
+  int m_fd;
+  int m_wd;
+  int m_err;
+  std::string m_dir;
+  std::string m_name;
+};
+
+#endif  // OS_FILEWATCHER_H_
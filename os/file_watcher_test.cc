@@ -0,0 +1,161 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_watcher.hpp"
+
+#ifdef __linux__
+static int write_file(const char *pathname, const char *content) {
+  size_t wbytes;
+  auto file = FileStream::open_write(pathname);
+  ASSERT_EQ(file.write(reinterpret_cast<const uint8_t*>(content),
+                       strlen(content), &wbytes), OK);
+  return EXIT_SUCCESS;
+}
+
+static int test_file_watcher_poll() {
+  char dir[] = "/tmp/file_watcher_XXXXXX";
+  char pathname[64], other[64], tmp[64];
+  bool changed;
+
+  ASSERT_TRUE(mkdtemp(dir) != nullptr);
+  snprintf(pathname, sizeof(pathname), "%s/config", dir);
+  snprintf(other, sizeof(other), "%s/other", dir);
+  snprintf(tmp, sizeof(tmp), "%s/config.tmp", dir);
+
+  FileWatcher watcher(pathname);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_FALSE(changed);
+
+  ASSERT_EQ(write_file(other, "key value"), EXIT_SUCCESS);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_FALSE(changed);
+
+  ASSERT_EQ(write_file(pathname, "key value"), EXIT_SUCCESS);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_TRUE(changed);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_FALSE(changed);
+
+  ASSERT_EQ(write_file(tmp, "key other"), EXIT_SUCCESS);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_FALSE(changed);
+  ASSERT_EQ(rename(tmp, pathname), 0);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_TRUE(changed);
+
+  unlink(pathname);
+  unlink(other);
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
+
+static int test_file_watcher_overflow() {
+  char dir[] = "/tmp/file_watcher_XXXXXX";
+  char pathname[64], others[2][64];
+  unsigned long queued = 0;
+  bool changed;
+
+  // the queue overflows once it holds more events than the limit
+  FILE *limit = fopen("/proc/sys/fs/inotify/max_queued_events", "r");
+  if (limit == nullptr) {
+    return EXIT_SUCCESS;
+  }
+  const int scanned = fscanf(limit, "%lu", &queued);
+  fclose(limit);
+  if (scanned != 1 || queued > 65536) {
+    return EXIT_SUCCESS;
+  }
+
+  ASSERT_TRUE(mkdtemp(dir) != nullptr);
+  snprintf(pathname, sizeof(pathname), "%s/config", dir);
+  snprintf(others[0], sizeof(others[0]), "%s/other0", dir);
+  snprintf(others[1], sizeof(others[1]), "%s/other1", dir);
+
+  // the files alternate, because an event that repeats
+  // the last one in the queue is merged with it
+  FileWatcher watcher(pathname);
+  for (unsigned long i = 0; i <= queued; i++) {
+    const int fd = open(others[i & 1], O_WRONLY | O_CREAT, 0600);
+    ASSERT_TRUE(fd > -1);
+    close(fd);
+  }
+
+  // the events of other files fill the queue, and the write of
+  // the file could have been one of the events that were dropped
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_TRUE(changed);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_FALSE(changed);
+
+  unlink(others[0]);
+  unlink(others[1]);
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
+
+static int test_file_watcher_dir_removed() {
+  char dir[] = "/tmp/file_watcher_XXXXXX";
+  char pathname[64];
+  bool changed;
+
+  ASSERT_TRUE(mkdtemp(dir) != nullptr);
+  snprintf(pathname, sizeof(pathname), "%s/config", dir);
+
+  FileWatcher watcher(pathname);
+  ASSERT_EQ(rmdir(dir), 0);
+  ASSERT_EQ(watcher.poll(&changed), FileWatchFailed);
+  ASSERT_EQ(watcher.err(), ENOENT);
+  ASSERT_EQ(watcher.poll(&changed), FileWatchFailed);
+
+  // the file may have been written before the watch is back
+  ASSERT_EQ(mkdir(dir, 0700), 0);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_TRUE(changed);
+
+  ASSERT_EQ(write_file(pathname, "key value"), EXIT_SUCCESS);
+  ASSERT_EQ(watcher.poll(&changed), OK);
+  ASSERT_TRUE(changed);
+
+  unlink(pathname);
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
+
+#else
+
+static int test_file_watcher_unsupported() {
+  bool thrown = false;
+
+  try {
+    FileWatcher watcher("/tmp/config");
+  } catch (const FileException &e) {
+    thrown = e.err() == ENOSYS;
+  }
+
+  ASSERT_TRUE(thrown);
+  return EXIT_SUCCESS;
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+#ifdef __linux__
+  TEST_RUN(ctx, test_file_watcher_poll());
+  TEST_RUN(ctx, test_file_watcher_overflow());
+  TEST_RUN(ctx, test_file_watcher_dir_removed());
+#else
+  TEST_RUN(ctx, test_file_watcher_unsupported());
+#endif
+
+  return TEST_RELEASE(ctx);
+}
@@ -0,0 +1,534 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+// io_bench measures the throughput and latency of moving bytes
+// through the os endpoints with copy(), the buffered readers and
+// writers and the Scanner. Each benchmark is named after its
+// parameters, so that `-b` selects a single family or size, e.g.
+//
+//   io_bench -b "bench_pipe<64 * KB"
+//   io_bench -b bench_scanner -f csv
+//
+// and the results of different buffer sizes for the same workload
+// can be compared side by side.
+//
+// Unless stated otherwise an operation moves one message, and the
+// reported throughput is the size of the message over its median
+// time. Transfers run in lockstep on a single thread over non
+// blocking endpoints, so the time of an operation is its latency
+// with both ends of the channel included
+
+#include "test/test.hpp"
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "buffer/buffered_reader.hpp"
+#include "buffer/buffered_writer.hpp"
+#include "buffer/msg_buffer.hpp"
+#include "buffer/scanner.hpp"
+#include "buffer/stream_buffer.hpp"
+#include "io/copy.hpp"
+#include "copy.hpp"
+#include "file_stream.hpp"
+#include "mmap_file_reader.hpp"
+#include "pipe.hpp"
+#include "socket.hpp"
+
+static constexpr size_t KB = 1024;
+static constexpr size_t MB = 1024 * KB;
+
+/// kMaxMessage is the size of the largest message of the benchmarks
+static constexpr size_t kMaxMessage = 1 * MB;
+
+/// kFileLimit is the size at which the files written by
+/// the benchmarks are truncated back to empty
+static constexpr size_t kFileLimit = 256 * MB;
+
+/// kSourceFileSize is the size of the files that are read by the
+/// benchmarks, which start reading them again when they reach the end
+static constexpr size_t kSourceFileSize = 64 * MB;
+
+/// kUdpBatchBytes bounds the bytes of the datagrams of a batch, so
+/// that a batch fits in the default receive buffer of a socket and
+/// no datagram is dropped on loopback
+static constexpr size_t kUdpBatchBytes = 64 * KB;
+
+/// kPollTimeout is the time in milliseconds that a transfer waits
+/// for its channel to make progress before it is considered failed
+static constexpr int kPollTimeout = 1000;
+
+static const char *kDir = "/tmp";
+
+static uint8_t kPayload[kMaxMessage];
+
+#define IO_BENCH(ctx, bytes, ...) \
+  bench_run_bytes(&ctx, #__VA_ARGS__, __VA_ARGS__, bytes)
+
+static void init_payload() {
+  for (size_t i = 0; i < kMaxMessage; i++) {
+    kPayload[i] = static_cast<uint8_t>('a' + i % 26);
+  }
+}
+
+/// wait_readable waits until `fd` has bytes to read, and
+/// returns false if it does not within kPollTimeout
+static bool wait_readable(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  return poll(&pfd, 1, kPollTimeout) == 1;
+}
+
+/// transfer moves `len` bytes of the payload from `sink` to
+/// `source`, which are the two ends of a non blocking stream
+/// channel. The bytes are staged in `wbuffer` before copy()
+/// writes them to the channel, and are copied from the channel
+/// to `rbuffer`, which is drained, so the size of the buffers
+/// bounds the bytes moved by each syscall
+static int transfer(Sink *sink, Source *source, int read_fd,
+                    StreamBuffer *wbuffer, StreamBuffer *rbuffer,
+                    size_t len) {
+  const uint8_t *data;
+  size_t written = 0, received = 0;
+  size_t wbytes, cbytes, pbytes;
+
+  while (received < len) {
+    if (written < len) {
+      ASSERT_EQ(wbuffer->write(kPayload + written, len - written, &wbytes), OK);
+      written += wbytes;
+    }
+
+    ASSERT_EQ(copy(static_cast<Reader*>(wbuffer), sink, &cbytes), OK);
+    ASSERT_EQ(copy(source, static_cast<Writer*>(rbuffer), &cbytes), OK);
+
+    ASSERT_EQ(rbuffer->peek(&data, 0, &pbytes), OK);
+    if (pbytes == 0) {
+      // the bytes written may not have reached the other end yet
+      ASSERT_TRUE(wait_readable(read_fd));
+      continue;
+    }
+
+    received += rbuffer->consume(pbytes);
+  }
+
+  ASSERT_EQ(received, len);
+  return EXIT_SUCCESS;
+}
+
+/// bench_pipe moves messages of M bytes through a
+/// pipe, with buffers of B bytes on each end
+template <size_t B, size_t M>
+static int bench_pipe(int n) {
+  Pipe pipe;
+  StreamBuffer wbuffer(B);
+  StreamBuffer rbuffer(B);
+
+  for (int i = 0; i < n; i++) {
+    if (transfer(&pipe, &pipe, pipe.read_fd(),
+                 &wbuffer, &rbuffer, M) == EXIT_FAILURE) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// TcpPair is a connected pair of loopback TCP sockets. It is
+/// set up once and shared by all the TCP benchmarks, so that
+/// the handshake is not part of the measurements
+struct TcpPair {
+  TcpPair():
+      listener(SocketDomain::IPv4),
+      client(SocketDomain::IPv4) { }
+
+  TcpSocket listener;
+  TcpSocket client;
+  std::unique_ptr<TcpSocket> server;
+};
+
+static TcpPair* make_tcp_pair() {
+  auto pair = std::make_unique<TcpPair>();
+  struct sockaddr_in address;
+  socklen_t len;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  if (pair->listener.bind(&address) != OK ||
+      pair->listener.listen(1) != OK ||
+      pair->client.connect(pair->listener.local_address(&len)) != OK) {
+    return nullptr;
+  }
+
+  while (!pair->server) {
+    if (pair->listener.accept(&pair->server) != OK ||
+        (!pair->server && !wait_readable(pair->listener.read_fd()))) {
+      return nullptr;
+    }
+  }
+
+  return pair.release();
+}
+
+static TcpPair* tcp_pair() {
+  static TcpPair *pair = make_tcp_pair();
+  return pair;
+}
+
+/// bench_tcp moves messages of M bytes through a loopback TCP
+/// connection, with buffers of B bytes on each end
+template <size_t B, size_t M>
+static int bench_tcp(int n) {
+  TcpPair *pair = tcp_pair();
+  StreamBuffer wbuffer(B);
+  StreamBuffer rbuffer(B);
+
+  ASSERT_TRUE(pair != nullptr);
+
+  for (int i = 0; i < n; i++) {
+    if (transfer(&pair->client, pair->server.get(), pair->server->read_fd(),
+                 &wbuffer, &rbuffer, M) == EXIT_FAILURE) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// udp_batch returns the number of datagrams of `size`
+/// bytes that the UDP benchmarks send with each syscall
+static constexpr size_t udp_batch(size_t size) {
+  return kUdpBatchBytes / size > UdpSocket::MAX_BATCH ? UdpSocket::MAX_BATCH :
+      kUdpBatchBytes / size > 0 ? kUdpBatchBytes / size : 1;
+}
+
+/// bench_udp sends a batch of datagrams of M bytes over loopback
+/// with a single syscall, and receives it with another. An operation
+/// is a whole batch, see udp_batch
+template <size_t M>
+static int bench_udp(int n) {
+  const size_t batch = udp_batch(M);
+  const size_t capacity = batch * (M + UdpSocket::HEADER_SIZE);
+  UdpSocket server(SocketDomain::IPv4);
+  UdpSocket client(SocketDomain::IPv4);
+  MsgBuffer wbuffer(UdpSocket::HEADER_SIZE, new uint8_t[capacity],
+                    capacity, DisposeFunc::array_delete());
+  MsgBuffer rbuffer(UdpSocket::HEADER_SIZE, new uint8_t[capacity],
+                    capacity, DisposeFunc::array_delete());
+  struct sockaddr_in address;
+  socklen_t len;
+  size_t wmsgs, rmsgs;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(server.bind(&address), OK);
+  ASSERT_EQ(client.bind(&address), OK);
+  const struct sockaddr_in *server_address = server.local_address(&len);
+
+  for (int i = 0; i < n; i++) {
+    for (size_t k = 0; k < batch; k++) {
+      uint8_t *dst;
+      size_t pbytes;
+
+      ASSERT_EQ(wbuffer.provide(&dst, M, &pbytes), OK);
+      ASSERT_TRUE(pbytes >= M);
+      memcpy(dst, kPayload, M);
+      memcpy(wbuffer.metadata(dst), server_address, sizeof(*server_address));
+      ASSERT_EQ(wbuffer.extend(M), M);
+    }
+
+    while (wbuffer.messages() > 0) {
+      ASSERT_EQ(client.write_batch(&wbuffer, batch, &wmsgs), OK);
+    }
+
+    for (size_t received = 0; received < batch; received += rmsgs) {
+      ASSERT_EQ(server.read_batch(&rbuffer, batch, M, &rmsgs), OK);
+      if (rmsgs == 0) {
+        ASSERT_TRUE(wait_readable(server.read_fd()));
+        continue;
+      }
+
+      ASSERT_EQ(rbuffer.consume_messages(rmsgs), rmsgs);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// truncate_file empties the file written through `fd`
+static int truncate_file(int fd) {
+  ASSERT_EQ(ftruncate(fd, 0), 0);
+  ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+  return EXIT_SUCCESS;
+}
+
+/// bench_buffered_writer writes messages of M bytes to a file
+/// through a BufferedWriter with a buffer of B bytes. The writer
+/// flushes when its buffer is full, and also after every message
+/// when FLUSH is set, which is the cost of a flush per message
+template <size_t B, size_t M, bool FLUSH>
+static int bench_buffered_writer(int n) {
+  auto file = FileStream::create_tmp_ptr(kDir);
+  const int fd = file->fd();
+  BufferedWriter writer(std::move(file), std::make_unique<StreamBuffer>(B));
+  size_t written = 0;
+  size_t cbytes, fbytes;
+
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(copy(kPayload, M, &writer, &cbytes), OK);
+    ASSERT_EQ(cbytes, M);
+    if (FLUSH) {
+      ASSERT_EQ(writer.flush(&fbytes), OK);
+    }
+
+    written += M;
+    if (written >= kFileLimit) {
+      ASSERT_EQ(writer.flush(&fbytes), OK);
+      if (truncate_file(fd) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+      }
+
+      written = 0;
+    }
+  }
+
+  ASSERT_EQ(writer.flush(&fbytes), OK);
+  return EXIT_SUCCESS;
+}
+
+/// source_file returns the path of a file of kSourceFileSize
+/// bytes of lines of L bytes, created the first time it is needed
+/// and removed when the program exits
+template <size_t L>
+static const char* source_file() {
+  static std::string pathname;
+  if (!pathname.empty()) {
+    return pathname.c_str();
+  }
+
+  char tmp[] = "/tmp/io_bench_XXXXXX";
+  const int fd = mkstemp(tmp);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  uint8_t line[L];
+  memcpy(line, kPayload, L - 1);
+  line[L - 1] = '\n';
+  for (size_t size = 0; size < kSourceFileSize; size += L) {
+    if (::write(fd, line, L) != static_cast<ssize_t>(L)) {
+      close(fd);
+      unlink(tmp);
+      return nullptr;
+    }
+  }
+
+  close(fd);
+  pathname = tmp;
+  atexit([]() { unlink(source_file<L>()); });
+  return pathname.c_str();
+}
+
+/// bench_copy_file copies chunks of M bytes from a file to another
+/// with copy(), which uses copy_file_range
+template <size_t M>
+static int bench_copy_file(int n) {
+  const char *pathname = source_file<128>();
+  ASSERT_TRUE(pathname != nullptr);
+
+  auto src = FileStream::open_read(pathname);
+  auto dst = FileStream::create_tmp(kDir);
+  size_t copied = 0;
+  size_t cbytes;
+
+  for (int i = 0; i < n; i++) {
+    for (size_t chunk = 0; chunk < M; chunk += cbytes) {
+      ASSERT_EQ(copy(&src, &dst, M - chunk, &cbytes), OK);
+      ASSERT_TRUE(cbytes > 0);
+    }
+
+    copied += M;
+    if (copied + M > kSourceFileSize) {
+      ASSERT_EQ(lseek(src.fd(), 0, SEEK_SET), 0);
+      if (truncate_file(dst.fd()) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+      }
+
+      copied = 0;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// bench_copy_file_pipe copies chunks of M bytes from a file to
+/// another through a pipe with copy(), which splices them on both
+/// sides. Chunks larger than the pipe take several round trips
+template <size_t M>
+static int bench_copy_file_pipe(int n) {
+  const char *pathname = source_file<128>();
+  ASSERT_TRUE(pathname != nullptr);
+
+  auto src = FileStream::open_read(pathname);
+  auto dst = FileStream::create_tmp(kDir);
+  Pipe pipe;
+  size_t copied = 0;
+  size_t cbytes;
+
+  for (int i = 0; i < n; i++) {
+    for (size_t chunk = 0; chunk < M; ) {
+      ASSERT_EQ(copy(&src, &pipe, M - chunk, &cbytes), OK);
+      ASSERT_TRUE(cbytes > 0);
+      chunk += cbytes;
+
+      for (size_t moved = 0; moved < cbytes; ) {
+        size_t pbytes;
+        ASSERT_EQ(copy(&pipe, &dst, cbytes - moved, &pbytes), OK);
+        ASSERT_TRUE(pbytes > 0);
+        moved += pbytes;
+      }
+    }
+
+    copied += M;
+    if (copied + M > kSourceFileSize) {
+      ASSERT_EQ(lseek(src.fd(), 0, SEEK_SET), 0);
+      if (truncate_file(dst.fd()) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+      }
+
+      copied = 0;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// scan_lines scans `n` lines of L bytes with the scanners
+/// returned by `make_scanner`, which is called again each
+/// time a scanner reaches the end of the file. The scanner
+/// is kept from one run to the next, so that its setup is
+/// not part of the time of the lines
+template <size_t L, typename F>
+static int scan_lines(int n, F make_scanner) {
+  static std::unique_ptr<Scanner> scanner;
+  const uint8_t *line;
+  size_t len;
+
+  if (!scanner) {
+    scanner = make_scanner();
+  }
+
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(scanner->peek(&line, 0, &len), OK);
+    if (len == 0) {
+      scanner = make_scanner();
+      i--;
+      continue;
+    }
+
+    ASSERT_EQ(len, L - 1);
+    ASSERT_EQ(scanner->consume(len), len);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// bench_scanner_mmap scans lines of L bytes from a file
+/// mapped in memory by a MmapFileReader. An operation is a line
+template <size_t L>
+static int bench_scanner_mmap(int n) {
+  const char *pathname = source_file<L>();
+  ASSERT_TRUE(pathname != nullptr);
+
+  return scan_lines<L>(n, [pathname]() {
+    return std::make_unique<Scanner>(
+        std::make_unique<MmapFileReader>(pathname));
+  });
+}
+
+/// bench_scanner_buffered scans lines of L bytes from a file read
+/// into a buffer of B bytes. An operation is a line
+template <size_t B, size_t L>
+static int bench_scanner_buffered(int n) {
+  const char *pathname = source_file<L>();
+  ASSERT_TRUE(pathname != nullptr);
+
+  return scan_lines<L>(n, [pathname]() {
+    return std::make_unique<Scanner>(
+        std::make_unique<RecovererBufferedReader>(
+            FileStream::open_read_ptr(pathname),
+            std::make_unique<StreamBuffer>(B)));
+  });
+}
+
+#define IO_BENCH_STREAM(ctx, bench, B)                        \
+  do {                                                        \
+    IO_BENCH(ctx, 16, bench<B, 16>);                          \
+    IO_BENCH(ctx, 1 * KB, bench<B, 1 * KB>);                  \
+    IO_BENCH(ctx, 64 * KB, bench<B, 64 * KB>);                \
+    IO_BENCH(ctx, 1 * MB, bench<B, 1 * MB>);                  \
+  } while (0)
+
+#define IO_BENCH_BUFFERED_WRITER(ctx, B, FLUSH)               \
+  do {                                                        \
+    IO_BENCH(ctx, 16, bench_buffered_writer<B, 16, FLUSH>);   \
+    IO_BENCH(ctx, 1 * KB, bench_buffered_writer<B, 1 * KB, FLUSH>); \
+    IO_BENCH(ctx, 64 * KB, bench_buffered_writer<B, 64 * KB, FLUSH>); \
+  } while (0)
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  init_payload();
+
+  IO_BENCH_STREAM(ctx, bench_pipe, 4 * KB);
+  IO_BENCH_STREAM(ctx, bench_pipe, 64 * KB);
+  IO_BENCH_STREAM(ctx, bench_pipe, 1 * MB);
+  IO_BENCH_STREAM(ctx, bench_pipe, 4 * MB);
+
+  IO_BENCH_STREAM(ctx, bench_tcp, 4 * KB);
+  IO_BENCH_STREAM(ctx, bench_tcp, 64 * KB);
+  IO_BENCH_STREAM(ctx, bench_tcp, 1 * MB);
+  IO_BENCH_STREAM(ctx, bench_tcp, 4 * MB);
+
+  IO_BENCH(ctx, udp_batch(16) * 16, bench_udp<16>);
+  IO_BENCH(ctx, udp_batch(1 * KB) * 1 * KB, bench_udp<1 * KB>);
+  IO_BENCH(ctx, udp_batch(8 * KB) * 8 * KB, bench_udp<8 * KB>);
+  IO_BENCH(ctx, udp_batch(32 * KB) * 32 * KB, bench_udp<32 * KB>);
+
+  IO_BENCH_BUFFERED_WRITER(ctx, 4 * KB, false);
+  IO_BENCH_BUFFERED_WRITER(ctx, 64 * KB, false);
+  IO_BENCH_BUFFERED_WRITER(ctx, 1 * MB, false);
+  IO_BENCH_BUFFERED_WRITER(ctx, 4 * MB, false);
+  IO_BENCH_BUFFERED_WRITER(ctx, 64 * KB, true);
+
+  IO_BENCH(ctx, 4 * KB, bench_copy_file<4 * KB>);
+  IO_BENCH(ctx, 64 * KB, bench_copy_file<64 * KB>);
+  IO_BENCH(ctx, 1 * MB, bench_copy_file<1 * MB>);
+  IO_BENCH(ctx, 4 * KB, bench_copy_file_pipe<4 * KB>);
+  IO_BENCH(ctx, 64 * KB, bench_copy_file_pipe<64 * KB>);
+  IO_BENCH(ctx, 1 * MB, bench_copy_file_pipe<1 * MB>);
+
+  IO_BENCH(ctx, 16, bench_scanner_mmap<16>);
+  IO_BENCH(ctx, 128, bench_scanner_mmap<128>);
+  IO_BENCH(ctx, 1 * KB, bench_scanner_mmap<1 * KB>);
+  IO_BENCH(ctx, 16, bench_scanner_buffered<4 * KB, 16>);
+  IO_BENCH(ctx, 128, bench_scanner_buffered<4 * KB, 128>);
+  IO_BENCH(ctx, 128, bench_scanner_buffered<64 * KB, 128>);
+  IO_BENCH(ctx, 1 * KB, bench_scanner_buffered<64 * KB, 1 * KB>);
+
+  return TEST_RELEASE(ctx);
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "mmap_file_reader.hpp"
+
+#include <string.h>
+#include <sys/mman.h>
+
+MmapFileReader::MmapFileReader(const char *pathname, size_t window):
+    m_fd(-1),
+    m_err(0),
+    m_size(0),
+    m_page(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+    m_window(0),
+    m_offset(0),
+    m_map_offset(0),
+    m_map_len(0),
+    m_map(nullptr) {
+  m_window = (window + m_page - 1) / m_page * m_page;
+  if (m_window < 2 * m_page) {
+    m_window = 2 * m_page;
+  }
+
+  m_fd = ::open(pathname, O_RDONLY | O_CLOEXEC);
+  if (m_fd == -1) {
+    throw FileException("failed to open file", errno);
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) == -1) {
+    int err = errno;
+    close(m_fd);
+    throw FileException("failed to stat file", err);
+  }
+
+  m_size = static_cast<size_t>(st.st_size);
+#ifdef __linux__
+  posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  if (m_size > 0 && map()->error()) {
+    close(m_fd);
+    throw FileException("failed to map file", m_err);
+  }
+}
+
+MmapFileReader::~MmapFileReader() {
+  unmap();
+  if (m_fd > -1) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+MmapFileReader::MmapFileReader(MmapFileReader &&reader):
+    m_fd(reader.m_fd),
+    m_err(reader.m_err),
+    m_size(reader.m_size),
+    m_page(reader.m_page),
+    m_window(reader.m_window),
+    m_offset(reader.m_offset),
+    m_map_offset(reader.m_map_offset),
+    m_map_len(reader.m_map_len),
+    m_map(reader.m_map) {
+  reader.m_fd = -1;
+  reader.m_map = nullptr;
+  reader.m_map_len = 0;
+}
+
+Status MmapFileReader::map() noexcept {
+  const size_t offset = m_offset / m_page * m_page;
+  const size_t len = m_size - offset > m_window ? m_window : m_size - offset;
+
+  // there is nothing to map past the end of the file, and
+  // the current window is kept for the bytes to recover
+  if (len == 0) {
+    return OK;
+  }
+
+  unmap();
+  void *map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, m_fd,
+                   static_cast<off_t>(offset));
+  if (map == MAP_FAILED) {
+    m_err = errno;
+    return FileMapFailed;
+  }
+
+  m_map = static_cast<uint8_t*>(map);
+  m_map_offset = offset;
+  m_map_len = len;
+
+  // the window is read once from start to end, let the kernel
+  // read ahead of the offset and drop the pages behind it
+  madvise(m_map, m_map_len, MADV_SEQUENTIAL);
+  madvise(m_map, m_map_len, MADV_WILLNEED);
+  return OK;
+}
+
+void MmapFileReader::unmap() noexcept {
+  if (m_map != nullptr) {
+    munmap(m_map, m_map_len);
+    m_map = nullptr;
+    m_map_len = 0;
+  }
+}
+
+Status MmapFileReader::peek(const uint8_t **dst,
+                            size_t intent,
+                            size_t *pbytes) noexcept {
+  // the offset may have been consumed past the window up to the
+  // end of the file, where there is nothing left to map
+  if (m_offset >= m_size) {
+    *dst = m_map;
+    *pbytes = 0;
+    return OK;
+  }
+
+  const size_t map_end = m_map_offset + m_map_len;
+  size_t available = map_end > m_offset ? map_end - m_offset : 0;
+
+  // slide the window when less than half of it or less than
+  // `intent` bytes are left, so that unless the end of the file is
+  // near a peek always returns at least half a window
+  const size_t wanted = intent > m_window / 2 ? intent : m_window / 2;
+  if (map_end < m_size && available < wanted) {
+    Status status = map();
+    if (status->error()) {
+      *pbytes = 0;
+      return status;
+    }
+
+    available = m_map_offset + m_map_len - m_offset;
+  }
+
+  // like a buffer, peek returns all the bytes it can provide
+  // at once, which a Scanner relies on to find the end of
+  // the input
+  *dst = m_map + (m_offset - m_map_offset);
+  *pbytes = available;
+  return OK;
+}
+
+Status MmapFileReader::read(uint8_t *dst,
+                            size_t len,
+                            size_t *rbytes) noexcept {
+  *rbytes = 0;
+
+  while (len > 0) {
+    const uint8_t *src;
+    size_t pbytes;
+
+    Status status = peek(&src, len, &pbytes);
+    if (status->error()) {
+      return status;
+    }
+
+    if (pbytes == 0) {
+      break;
+    }
+
+    if (pbytes > len) {
+      pbytes = len;
+    }
+
+    memcpy(dst, src, pbytes);
+    consume(pbytes);
+    dst += pbytes;
+    len -= pbytes;
+    *rbytes += pbytes;
+  }
+
+  return OK;
+}
+
+size_t MmapFileReader::consume(size_t len) noexcept {
+  const size_t remaining = m_size - m_offset;
+  const size_t cbytes = len > remaining ? remaining : len;
+  m_offset += cbytes;
+  return cbytes;
+}
+
+size_t MmapFileReader::recover(size_t len) noexcept {
+  const size_t recoverable = m_offset - m_map_offset;
+  const size_t rbytes = len > recoverable ? recoverable : len;
+  m_offset -= rbytes;
+  return rbytes;
+}
+
+size_t MmapFileReader::recoverable() const noexcept {
+  return m_offset - m_map_offset;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef OS_MMAPFILEREADER_H_
+#define OS_MMAPFILEREADER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "io/recoverer.hpp"
+
+#include "file_stream.hpp"
+#include "status.hpp"
+
+/// MmapFileReader is a RecovererReader over a read only mapping
+/// of a file, so peek returns pointers into the page cache and
+/// neither read nor a Scanner on top of it copy the file into a
+/// buffer first. Files larger than the window are mapped one window
+/// at a time, and the window slides forward when less than half of
+/// it is left. Recovering bytes is free while they are still mapped,
+/// which is always the case for the bytes returned by the last peek.
+/// As with a buffer, a Scanner on top of this reader needs tokens
+/// that fit in half the window
+class MmapFileReader final : public RecovererReader {
+ public:
+  static constexpr size_t DEFAULT_WINDOW = 256 * 1024 * 1024;
+
+  /// the window is rounded up to a multiple of the
+  /// page size, with a minimum of two pages
+  explicit MmapFileReader(const char *pathname,
+                          size_t window = DEFAULT_WINDOW);
+
+  ~MmapFileReader();
+
+  MmapFileReader(const MmapFileReader &reader) = delete;
+  MmapFileReader(MmapFileReader &&reader);
+
+  MmapFileReader& operator=(const MmapFileReader &reader) = delete;
+  MmapFileReader& operator=(MmapFileReader &&reader) = delete;
+
+  /// size returns the size of the file when it was opened
+  inline size_t size() const noexcept {
+    return m_size;
+  }
+
+  inline int err() const noexcept {
+    return m_err;
+  }
+
+  Status read(uint8_t *dst, size_t len, size_t *rbytes) noexcept override;
+  Status peek(const uint8_t **dst, size_t intent, size_t *pbytes) noexcept override;
+  size_t consume(size_t len) noexcept override;
+  size_t recover(size_t len) noexcept override;
+  size_t recoverable() const noexcept override;
+
+ private:
+  /// map maps the window that starts at the page
+  /// that contains the read offset
+  Status map() noexcept;
+
+  void unmap() noexcept;
+
+  int m_fd;
+  int m_err;
+  size_t m_size;
+  size_t m_page;
+  size_t m_window;
+  size_t m_offset;
+  size_t m_map_offset;
+  size_t m_map_len;
+  uint8_t *m_map;
+};
+
+#endif  // OS_MMAPFILEREADER_H_
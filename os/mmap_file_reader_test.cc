@@ -0,0 +1,133 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include "buffer/scanner.hpp"
+#include "mmap_file_reader.hpp"
+
+static constexpr int LINES = 3000;
+static constexpr size_t LINE_LEN = 11;
+
+static int write_lines(const char *pathname) {
+  char line[LINE_LEN + 1];
+  size_t wbytes;
+  auto file = FileStream::open_write(pathname);
+
+  for (int i = 0; i < LINES; i++) {
+    snprintf(line, sizeof(line), "line %05d\n", i);
+    ASSERT_EQ(file.write(reinterpret_cast<const uint8_t*>(line),
+                         LINE_LEN, &wbytes), OK);
+    ASSERT_EQ(wbytes, LINE_LEN);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static int test_mmap_file_reader_scan_lines() {
+  char pathname[] = "/tmp/mmap_file_reader_XXXXXX";
+  char expected[LINE_LEN + 1];
+  const uint8_t *line;
+  size_t len;
+
+  close(mkstemp(pathname));
+  ASSERT_EQ(write_lines(pathname), EXIT_SUCCESS);
+
+  // a window of two pages makes the scanner slide it many times
+  auto reader = std::make_unique<MmapFileReader>(pathname, 1);
+  ASSERT_EQ(reader->size(), LINES * LINE_LEN);
+  Scanner scanner(std::move(reader));
+
+  for (int i = 0; i < LINES; i++) {
+    snprintf(expected, sizeof(expected), "line %05d\n", i);
+    ASSERT_EQ(scanner.peek(&line, 0, &len), OK);
+    ASSERT_EQ(len, LINE_LEN - 1);
+    ASSERT_MEM_EQ(line, expected, LINE_LEN - 1);
+    ASSERT_EQ(scanner.consume(len), len);
+  }
+
+  ASSERT_EQ(scanner.peek(&line, 0, &len), OK);
+  ASSERT_EQ(len, 0);
+
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+static int test_mmap_file_reader_read_recover() {
+  char pathname[] = "/tmp/mmap_file_reader_XXXXXX";
+  uint8_t data[LINES * LINE_LEN];
+  const uint8_t *peeked;
+  size_t rbytes, pbytes;
+
+  close(mkstemp(pathname));
+  ASSERT_EQ(write_lines(pathname), EXIT_SUCCESS);
+
+  MmapFileReader reader(pathname, 1);
+  ASSERT_EQ(reader.read(data, 3, &rbytes), OK);
+  ASSERT_EQ(rbytes, 3);
+  ASSERT_EQ(reader.recoverable(), 3);
+  ASSERT_EQ(reader.recover(5), 3);
+
+  ASSERT_EQ(reader.read(data, sizeof(data), &rbytes), OK);
+  ASSERT_EQ(rbytes, sizeof(data));
+  ASSERT_MEM_EQ(data, "line 00000\n", LINE_LEN);
+  ASSERT_MEM_EQ(data + (LINES - 1) * LINE_LEN, "line 02999\n", LINE_LEN);
+  ASSERT_EQ(reader.read(data, sizeof(data), &rbytes), OK);
+  ASSERT_EQ(rbytes, 0);
+
+  ASSERT_EQ(reader.recover(LINE_LEN), LINE_LEN);
+  ASSERT_EQ(reader.peek(&peeked, 1, &pbytes), OK);
+  ASSERT_EQ(pbytes, LINE_LEN);
+  ASSERT_MEM_EQ(peeked, "line 02999\n", LINE_LEN);
+
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+static int test_mmap_file_reader_consume_past_window() {
+  char pathname[] = "/tmp/mmap_file_reader_XXXXXX";
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  std::unique_ptr<uint8_t[]> data(new uint8_t[3 * page]);
+  const uint8_t *peeked;
+  size_t wbytes, pbytes;
+
+  close(mkstemp(pathname));
+  memset(data.get(), 'x', 3 * page);
+  {
+    auto file = FileStream::open_write(pathname);
+    ASSERT_EQ(file.write(data.get(), 3 * page, &wbytes), OK);
+    ASSERT_EQ(wbytes, 3 * page);
+  }
+
+  // the window holds two of the three pages, and the whole
+  // file is consumed without being peeked past the window
+  MmapFileReader reader(pathname, 2 * page);
+  ASSERT_EQ(reader.consume(3 * page), 3 * page);
+  ASSERT_EQ(reader.peek(&peeked, 0, &pbytes), OK);
+  ASSERT_EQ(pbytes, 0);
+
+  ASSERT_EQ(reader.recover(page), page);
+  ASSERT_EQ(reader.peek(&peeked, 0, &pbytes), OK);
+  ASSERT_EQ(pbytes, page);
+  ASSERT_EQ(peeked[0], 'x');
+
+  unlink(pathname);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_mmap_file_reader_scan_lines());
+  TEST_RUN(ctx, test_mmap_file_reader_read_recover());
+  TEST_RUN(ctx, test_mmap_file_reader_consume_past_window());
+
+  return TEST_RELEASE(ctx);
+}
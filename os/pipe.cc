@@ -2,6 +2,8 @@
 
 #include "pipe.hpp"
 
+#include "io/iovec.hpp"
+
 Status Pipe::write(const uint8_t *src,
                    size_t len,
                    size_t *wbytes) noexcept {
@@ -25,6 +27,7 @@ Status Pipe::write(const uint8_t *src,
 
       default:
         *wbytes += res;
+        src += res;
         len -= res;
         break;
     }
@@ -56,6 +59,7 @@ Status Pipe::read(uint8_t *dst,
 
       default:
         *rbytes += res;
+        dst += res;
         len -= res;
         break;
     }
@@ -64,3 +68,72 @@ Status Pipe::read(uint8_t *dst,
   return OK;
 }
 
+Status Pipe::write_v(const struct iovec *iov,
+                    size_t iovcnt,
+                    size_t *wbytes) noexcept {
+  IovCursor cursor(iov, iovcnt);
+  int count;
+
+  *wbytes = 0;
+
+  while (!cursor.done()) {
+    const struct iovec *batch = cursor.batch(&count);
+    ssize_t res = ::writev(m_fd[1], batch, count);
+
+    switch (res) {
+      case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          m_wait_write_event = true;
+          return OK;
+
+        } else {
+          m_err = errno;
+          return PipeWriteFailed;
+        }
+      case 0:
+        return OK;
+
+      default:
+        *wbytes += res;
+        cursor.advance(res);
+        break;
+    }
+  }
+
+  return OK;
+}
+
+Status Pipe::read_v(const struct iovec *iov,
+                   size_t iovcnt,
+                   size_t *rbytes) noexcept {
+  IovCursor cursor(iov, iovcnt);
+  int count;
+
+  *rbytes = 0;
+
+  while (!cursor.done()) {
+    const struct iovec *batch = cursor.batch(&count);
+    ssize_t res = ::readv(m_fd[0], batch, count);
+
+    switch (res) {
+      case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          m_wait_read_event = true;
+          return OK;
+        } else {
+          m_err = errno;
+          return PipeReadFailed;
+        }
+
+      case 0:
+        return OK;
+
+      default:
+        *rbytes += res;
+        cursor.advance(res);
+        break;
+    }
+  }
+
+  return OK;
+}
@@ -39,7 +39,7 @@ class Pipe final : public Channel {
       m_wait_write_event(false),
       m_wait_read_event(false),
       m_err(0) {
-    int res = pipe(m_fd);
+    int res = aio_pipe(m_fd);
     if (res == -1) {
       m_fd[0] = -1;
       m_fd[1] = -1;
@@ -137,6 +137,12 @@ class Pipe final : public Channel {
   Status read(uint8_t *src,
               size_t len,
               size_t *rbytes) noexcept override;
+  Status write_v(const struct iovec *iov,
+                 size_t iovcnt,
+                 size_t *wbytes) noexcept override;
+  Status read_v(const struct iovec *iov,
+                size_t iovcnt,
+                size_t *rbytes) noexcept override;
  private:
   bool m_wait_write_event;
   bool m_wait_read_event;
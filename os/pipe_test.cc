@@ -0,0 +1,48 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include "pipe.hpp"
+
+static int test_pipe_write_v_read_v() {
+  Pipe pipe;
+  const uint8_t header[] = "head";
+  const uint8_t payload[] = "some content";
+  uint8_t first[6];
+  uint8_t second[32];
+  size_t wbytes, rbytes;
+
+  struct iovec wiov[3];
+  wiov[0].iov_base = const_cast<uint8_t*>(header);
+  wiov[0].iov_len = 4;
+  wiov[1].iov_base = nullptr;
+  wiov[1].iov_len = 0;
+  wiov[2].iov_base = const_cast<uint8_t*>(payload);
+  wiov[2].iov_len = 12;
+
+  ASSERT_EQ(pipe.write_v(wiov, 3, &wbytes), OK);
+  ASSERT_EQ(wbytes, 16);
+
+  struct iovec riov[2];
+  riov[0].iov_base = first;
+  riov[0].iov_len = sizeof(first);
+  riov[1].iov_base = second;
+  riov[1].iov_len = sizeof(second);
+
+  ASSERT_EQ(pipe.read_v(riov, 2, &rbytes), OK);
+  ASSERT_EQ(rbytes, 16);
+  ASSERT_MEM_EQ(first, "headso", 6);
+  ASSERT_MEM_EQ(second, "me content", 10);
+  ASSERT_TRUE(pipe.wait_read_event());
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_pipe_write_v_read_v());
+
+  return TEST_RELEASE(ctx);
+}
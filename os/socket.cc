@@ -2,6 +2,14 @@
 
 #include "socket.hpp"
 
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+
+#include "io/iovec.hpp"
+
 UdpSocket UdpSocket::open(const SocketDomain& domain) {
   return UdpSocket(domain);
 }
@@ -92,6 +100,368 @@ Status UdpSocket::read(uint8_t *dst,
   return OK;
 }
 
+Status UdpSocket::bind(const struct sockaddr_in *address) noexcept {
+  int res = aio_bind(m_sockfd,
+                     reinterpret_cast<const struct sockaddr*>(address),
+                     sizeof(struct sockaddr_in));
+  if (res == -1) {
+    m_err = errno;
+    return SocketBindFailed;
+  }
+
+  // the port may have been picked by the kernel
+  m_local_address_len = sizeof(struct sockaddr_in);
+  res = getsockname(m_sockfd,
+                    reinterpret_cast<struct sockaddr*>(&m_local_address),
+                    &m_local_address_len);
+  if (res == -1) {
+    m_err = errno;
+    return SocketBindFailed;
+  }
+
+  return OK;
+}
+
+Status UdpSocket::read_batch(MsgBuffer *buffer,
+                             size_t count,
+                             size_t max_len,
+                             size_t *rmsgs) noexcept {
+  *rmsgs = 0;
+
+#ifdef __linux__
+  struct mmsghdr msgs[MAX_BATCH];
+  struct iovec iov[MAX_BATCH];
+  const bool addresses = buffer->metadata_size() >= sizeof(struct sockaddr_in);
+  const size_t stride = max_len + buffer->header_size();
+  uint8_t *base;
+  size_t pbytes;
+
+  // the intent makes the buffer reclaim the space of the
+  // messages consumed when there is no room for a datagram
+  buffer->provide(&base, max_len, &pbytes);
+
+  // each datagram is received in a slot that fits the largest
+  // datagram. The last slot only needs room for the payload,
+  // since the header of the next message is not written
+  count = count > MAX_BATCH ? MAX_BATCH : count;
+  if (pbytes < max_len) {
+    return OK;
+  }
+  count = std::min(count, (pbytes - max_len) / stride + 1);
+
+  memset(msgs, 0, count * sizeof(struct mmsghdr));
+  for (size_t i = 0; i < count; i++) {
+    uint8_t *slot = base + i * stride;
+    iov[i].iov_base = slot;
+    iov[i].iov_len = max_len;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (addresses) {
+      msgs[i].msg_hdr.msg_name = buffer->metadata(slot);
+      msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+  }
+
+  int res = recvmmsg(m_sockfd, msgs, count, 0, nullptr);
+  if (res == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      m_wait_read_event = true;
+      return OK;
+    }
+
+    m_err = errno;
+    return SocketReadFailed;
+  }
+
+  // datagrams shorter than their slot leave gaps in the
+  // buffer, so the following ones are moved back to be
+  // right after the message before them. Datagrams that
+  // did not fit in their slot are dropped
+  const size_t metadata_size = buffer->metadata_size();
+  for (int i = 0; i < res; i++) {
+    uint8_t *slot = base + i * stride;
+    uint8_t *dst;
+
+    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      continue;
+    }
+
+    buffer->provide(&dst, 0, &pbytes);
+    if (dst != slot) {
+      memmove(buffer->metadata(dst), buffer->metadata(slot),
+              metadata_size + msgs[i].msg_len);
+    }
+
+    buffer->extend(msgs[i].msg_len);
+    (*rmsgs)++;
+  }
+
+  return OK;
+#else
+  (void)(buffer);
+  (void)(count);
+  (void)(max_len);
+  m_err = ENOSYS;
+  return SocketReadFailed;
+#endif
+}
+
+Status UdpSocket::write_batch(MsgBuffer *buffer,
+                              size_t count,
+                              size_t *wmsgs) noexcept {
+  *wmsgs = 0;
+
+#ifdef __linux__
+  struct mmsghdr msgs[MAX_BATCH];
+  struct iovec iov[MAX_BATCH];
+  const bool addresses = buffer->metadata_size() >= sizeof(struct sockaddr_in);
+
+  count = count > MAX_BATCH ? MAX_BATCH : count;
+  count = std::min(count, buffer->messages());
+  if (count == 0) {
+    return OK;
+  }
+
+  memset(msgs, 0, count * sizeof(struct mmsghdr));
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t *msg;
+    size_t len;
+
+    buffer->peek_message(i, &msg, &len);
+    iov[i].iov_base = const_cast<uint8_t*>(msg);
+    iov[i].iov_len = len;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_name = addresses
+        ? static_cast<void*>(buffer->metadata(msg))
+        : static_cast<void*>(&m_remote_address);
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+  }
+
+  int res = sendmmsg(m_sockfd, msgs, count, 0);
+  if (res == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      m_wait_write_event = true;
+      return OK;
+    }
+
+    m_err = errno;
+    return SocketWriteFailed;
+  }
+
+  buffer->consume_messages(res);
+  *wmsgs = res;
+  return OK;
+#else
+  (void)(buffer);
+  (void)(count);
+  m_err = ENOSYS;
+  return SocketWriteFailed;
+#endif
+}
+
+Status UdpSocket::set_gro(bool enable) noexcept {
+#ifdef UDP_GRO
+  int value = enable ? 1 : 0;
+  if (setsockopt(m_sockfd, IPPROTO_UDP, UDP_GRO,
+                 &value, sizeof(value)) == -1) {
+    m_err = errno;
+    return SocketOptionFailed;
+  }
+
+  return OK;
+#else
+  (void)(enable);
+  m_err = ENOPROTOOPT;
+  return SocketOptionFailed;
+#endif
+}
+
+Status UdpSocket::write_segments(MsgBuffer *buffer, size_t *wmsgs) noexcept {
+  *wmsgs = 0;
+
+#ifdef UDP_SEGMENT
+  struct iovec iov[MAX_SEGMENTS];
+  const bool addresses = buffer->metadata_size() >= sizeof(struct sockaddr_in);
+  const size_t messages = std::min(buffer->messages(),
+                                   static_cast<size_t>(MAX_SEGMENTS));
+  const uint8_t *address = nullptr;
+  size_t segment = 0, total = 0, count = 0;
+
+  for (; count < messages; count++) {
+    const uint8_t *msg;
+    size_t len;
+
+    buffer->peek_message(count, &msg, &len);
+    if (count == 0) {
+      segment = len;
+      address = buffer->metadata(msg);
+
+    } else if (segment == 0 || len > segment ||
+               total + len > MAX_DATAGRAM_SIZE ||
+               (addresses && memcmp(address, buffer->metadata(msg),
+                                    sizeof(struct sockaddr_in)) != 0)) {
+      break;
+    }
+
+    iov[count].iov_base = const_cast<uint8_t*>(msg);
+    iov[count].iov_len = len;
+    total += len;
+
+    // only the last segment can be shorter than the others
+    if (len < segment) {
+      count++;
+      break;
+    }
+  }
+
+  if (count == 0) {
+    return OK;
+  }
+
+  union {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = addresses ? const_cast<uint8_t*>(address)
+                           : reinterpret_cast<uint8_t*>(&m_remote_address);
+  msg.msg_namelen = sizeof(struct sockaddr_in);
+  msg.msg_iov = iov;
+  msg.msg_iovlen = count;
+
+  // a single message is sent as a regular datagram
+  if (count > 1 && segment > 0) {
+    uint16_t size = static_cast<uint16_t>(segment);
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(size));
+    memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+  }
+
+  if (sendmsg(m_sockfd, &msg, 0) == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      m_wait_write_event = true;
+      return OK;
+    }
+
+    m_err = errno;
+    return SocketWriteFailed;
+  }
+
+  buffer->consume_messages(count);
+  *wmsgs = count;
+  return OK;
+#else
+  (void)(buffer);
+  m_err = ENOSYS;
+  return SocketWriteFailed;
+#endif
+}
+
+Status UdpSocket::read_segments(MsgBuffer *buffer,
+                                size_t max_len,
+                                size_t *rmsgs) noexcept {
+  *rmsgs = 0;
+
+#ifdef UDP_GRO
+  const bool addresses = buffer->metadata_size() >= sizeof(struct sockaddr_in);
+  const size_t header_size = buffer->header_size();
+  uint8_t *base;
+  size_t pbytes;
+
+  buffer->provide(&base, max_len + (MAX_SEGMENTS - 1) * header_size, &pbytes);
+  if (pbytes < max_len + (MAX_SEGMENTS - 1) * header_size) {
+    return OK;
+  }
+
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct sockaddr_in address;
+  struct iovec iov;
+  struct msghdr msg;
+
+  iov.iov_base = base;
+  iov.iov_len = max_len;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &address;
+  msg.msg_namelen = sizeof(address);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  ssize_t res = recvmsg(m_sockfd, &msg, 0);
+  if (res == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      m_wait_read_event = true;
+      return OK;
+    }
+
+    m_err = errno;
+    return SocketReadFailed;
+  }
+
+  // a datagram longer than max_len has lost the end of its
+  // last segments, so it is dropped rather than stored truncated
+  if (msg.msg_flags & MSG_TRUNC) {
+    return OK;
+  }
+
+  const size_t len = static_cast<size_t>(res);
+  size_t segment = len;
+
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int size;
+      memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+      segment = size > 0 ? static_cast<size_t>(size) : len;
+    }
+  }
+
+  // the segments are moved forward, starting from the
+  // last one, to make room for the header of each message
+  // the headers of more segments than MAX_SEGMENTS would not fit
+  // in the room provided, so such a datagram is dropped too
+  const size_t count = segment == 0 ? 1 : (len + segment - 1) / segment;
+  if (count > MAX_SEGMENTS) {
+    return OK;
+  }
+
+  for (size_t i = count; i-- > 1;) {
+    memmove(base + i * (segment + header_size), base + i * segment,
+            std::min(segment, len - i * segment));
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    uint8_t *dst;
+
+    buffer->provide(&dst, 0, &pbytes);
+    if (addresses) {
+      memcpy(buffer->metadata(dst), &address, sizeof(address));
+    }
+
+    buffer->extend(std::min(segment, len - i * segment));
+  }
+
+  *rmsgs = count;
+  return OK;
+#else
+  (void)(buffer);
+  (void)(max_len);
+  m_err = ENOSYS;
+  return SocketReadFailed;
+#endif
+}
 
 TcpSocket TcpSocket::open(const SocketDomain& domain) {
   return TcpSocket(domain);
@@ -117,6 +487,84 @@ std::unique_ptr<TcpSocket> TcpSocket::open_ipv6_ptr() {
   return TcpSocket::open_ptr(SocketDomain::IPv6);
 }
 
+std::unique_ptr<TcpSocket> TcpSocket::adopt_ptr(
+    int sockfd,
+    const struct sockaddr_in *remote_address,
+    socklen_t remote_address_len) {
+  return std::unique_ptr<TcpSocket>(
+      new TcpSocket(sockfd, remote_address, remote_address_len));
+}
+
+Status TcpSocket::bind(const struct sockaddr_in *address,
+                       bool reuse_port) noexcept {
+  const struct sockaddr *addr =
+      reinterpret_cast<const struct sockaddr*>(address);
+  int res = reuse_port
+      ? aio_bind_reuseport(m_sockfd, addr, sizeof(struct sockaddr_in))
+      : aio_bind(m_sockfd, addr, sizeof(struct sockaddr_in));
+  if (res == -1) {
+    m_err = errno;
+    return SocketBindFailed;
+  }
+
+  // the port may have been picked by the kernel
+  m_local_address_len = sizeof(struct sockaddr_in);
+  res = getsockname(m_sockfd,
+                    reinterpret_cast<struct sockaddr*>(&m_local_address),
+                    &m_local_address_len);
+  if (res == -1) {
+    m_err = errno;
+    return SocketBindFailed;
+  }
+
+  return OK;
+}
+
+Status TcpSocket::listen(int backlog) noexcept {
+  if (aio_listen(m_sockfd, backlog) == -1) {
+    m_err = errno;
+    return SocketListenFailed;
+  }
+
+  return OK;
+}
+
+Status TcpSocket::accept(std::unique_ptr<TcpSocket> *socket) noexcept {
+  struct sockaddr_in address;
+  socklen_t socklen = sizeof(struct sockaddr_in);
+
+  socket->reset();
+
+  int sockfd = aio_accept(m_sockfd,
+                          reinterpret_cast<struct sockaddr*>(&address),
+                          &socklen);
+  if (sockfd == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      m_wait_read_event = true;
+      return OK;
+    }
+
+    m_err = errno;
+    return SocketAcceptFailed;
+  }
+
+  socket->reset(new TcpSocket(sockfd, &address, socklen));
+  return OK;
+}
+
+Status TcpSocket::connect(const struct sockaddr_in *address) noexcept {
+  int res = aio_connect(m_sockfd,
+                        reinterpret_cast<const struct sockaddr*>(address),
+                        sizeof(struct sockaddr_in));
+  if (res == -1) {
+    m_err = errno;
+    return SocketConnectFailed;
+  }
+
+  memcpy(&m_remote_address, address, sizeof(struct sockaddr_in));
+  m_remote_address_len = sizeof(struct sockaddr_in);
+  return OK;
+}
 
 Status TcpSocket::write(const uint8_t *src,
                         size_t len,
@@ -141,6 +589,7 @@ Status TcpSocket::write(const uint8_t *src,
 
       default:
         *wbytes += res;
+        src += res;
         len -= res;
         break;
     }
@@ -172,6 +621,7 @@ Status TcpSocket::read(uint8_t *dst,
 
       default:
         *rbytes += res;
+        dst += res;
         len -= res;
         break;
     }
@@ -180,3 +630,72 @@ Status TcpSocket::read(uint8_t *dst,
   return OK;
 }
 
+Status TcpSocket::write_v(const struct iovec *iov,
+                         size_t iovcnt,
+                         size_t *wbytes) noexcept {
+  IovCursor cursor(iov, iovcnt);
+  int count;
+
+  *wbytes = 0;
+
+  while (!cursor.done()) {
+    const struct iovec *batch = cursor.batch(&count);
+    ssize_t res = ::writev(m_sockfd, batch, count);
+
+    switch (res) {
+      case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          m_wait_write_event = true;
+          return OK;
+
+        } else {
+          m_err = errno;
+          return SocketWriteFailed;
+        }
+      case 0:
+        return OK;
+
+      default:
+        *wbytes += res;
+        cursor.advance(res);
+        break;
+    }
+  }
+
+  return OK;
+}
+
+Status TcpSocket::read_v(const struct iovec *iov,
+                        size_t iovcnt,
+                        size_t *rbytes) noexcept {
+  IovCursor cursor(iov, iovcnt);
+  int count;
+
+  *rbytes = 0;
+
+  while (!cursor.done()) {
+    const struct iovec *batch = cursor.batch(&count);
+    ssize_t res = ::readv(m_sockfd, batch, count);
+
+    switch (res) {
+      case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          m_wait_read_event = true;
+          return OK;
+        } else {
+          m_err = errno;
+          return SocketReadFailed;
+        }
+
+      case 0:
+        return OK;
+
+      default:
+        *rbytes += res;
+        cursor.advance(res);
+        break;
+    }
+  }
+
+  return OK;
+}
@@ -10,6 +10,7 @@
 #include <memory>
 
 #include "aio.hpp"
+#include "buffer/msg_buffer.hpp"
 #include "channel.hpp"
 #include "status.hpp"
 
@@ -44,18 +45,20 @@ class Socket : public Channel {
 
   /// wait_write_event returns true if writing to the socket asynchronously
   /// would block
-  bool wait_write_event() const noexcept;
+  bool wait_write_event() const noexcept override = 0;
   /// wait_read_event returns true if read from the socket asynchronously
   /// would block
-  bool wait_read_event() const noexcept;
+  bool wait_read_event() const noexcept override = 0;
 
   /// local_address returns the local address of the socket
   /// if bound to interface and port
-  const struct sockaddr_in *local_address(socklen_t *len) const noexcept;
+  const struct sockaddr_in *local_address(
+      socklen_t *len) const noexcept override = 0;
 
   /// remote_address returns the remote address the socket
   /// has last interacted with
-  const struct sockaddr_in *remote_address(socklen_t *len) const noexcept;
+  const struct sockaddr_in *remote_address(
+      socklen_t *len) const noexcept override = 0;
 };
 
 class UdpSocket final : public Socket {
@@ -145,6 +148,73 @@ class UdpSocket final : public Socket {
   Status read(uint8_t *src,
               size_t len,
               size_t *rbytes) noexcept;
+
+  /// HEADER_SIZE is the header size of the MsgBuffers that keep the
+  /// peer address of each datagram in the metadata of its header
+  static const size_t HEADER_SIZE = 4 + sizeof(struct sockaddr_in);
+
+  /// MAX_BATCH is the maximum number of datagrams
+  /// sent or received with a single syscall
+  static const size_t MAX_BATCH = 64;
+
+  /// MAX_SEGMENTS is the maximum number of datagrams sent
+  /// or received at once with segmentation offload
+  static const size_t MAX_SEGMENTS = 64;
+
+  /// MAX_DATAGRAM_SIZE is the maximum payload of an IPv4 datagram
+  static const size_t MAX_DATAGRAM_SIZE = 65507;
+
+  /// bind binds the socket to `address`
+  Status bind(const struct sockaddr_in *address) noexcept;
+
+  /// set_gro makes the kernel coalesce the datagrams received
+  /// from the same peer with the same size into a single datagram,
+  /// which `read_segments` splits back into messages
+  Status set_gro(bool enable) noexcept;
+
+  /// read_batch receives up to `count` datagrams of up to `max_len`
+  /// bytes each with a single syscall, and writes each of them to
+  /// `buffer` as a message. No more datagrams are received than
+  /// fit in the buffer. If the header of the buffer has room for
+  /// it, the peer address of each datagram is stored in the metadata
+  /// of its header, otherwise the addresses are discarded.
+  /// Datagrams longer than `max_len` are dropped rather than stored
+  /// truncated. `rmsgs` is set to the number of datagrams stored
+  Status read_batch(MsgBuffer *buffer,
+                    size_t count,
+                    size_t max_len,
+                    size_t *rmsgs) noexcept;
+
+  /// write_batch sends up to `count` messages from `buffer` as
+  /// datagrams with a single syscall, and consumes the messages
+  /// sent. Each datagram is sent to the address in the metadata
+  /// of its header if the buffer has room for it, or to the
+  /// remote address otherwise. `wmsgs` is set to the number of
+  /// datagrams sent
+  Status write_batch(MsgBuffer *buffer,
+                     size_t count,
+                     size_t *wmsgs) noexcept;
+
+  /// write_segments sends the messages at the front of `buffer` that
+  /// have the same size and destination as a single datagram, that
+  /// the kernel splits back into one datagram per message with UDP
+  /// segmentation offload. The last message sent may be shorter than
+  /// the others. Destinations are taken as in `write_batch`. The
+  /// messages sent are consumed and `wmsgs` is set to their number
+  Status write_segments(MsgBuffer *buffer, size_t *wmsgs) noexcept;
+
+  /// read_segments receives a datagram of up to `max_len` bytes,
+  /// coalesced by the kernel if `set_gro` is enabled, and writes
+  /// each of the datagrams it is made of to `buffer` as a message.
+  /// The buffer needs room for `max_len` bytes plus the headers of
+  /// MAX_SEGMENTS messages, otherwise nothing is received. Peer
+  /// addresses are stored as in `read_batch`. A datagram longer
+  /// than `max_len`, or made of more than MAX_SEGMENTS segments,
+  /// is dropped. `rmsgs` is set to the number of messages written
+  Status read_segments(MsgBuffer *buffer,
+                       size_t max_len,
+                       size_t *rmsgs) noexcept;
+
  private:
   bool m_wait_write_event;
   bool m_wait_read_event;
@@ -199,6 +269,13 @@ class TcpSocket final : public Socket {
   static std::unique_ptr<TcpSocket> open_ipv4_ptr();
   static std::unique_ptr<TcpSocket> open_ipv6_ptr();
 
+  /// adopt_ptr takes ownership of a connected socket, such
+  /// as the ones accepted with EventLoop::submit_accept
+  static std::unique_ptr<TcpSocket> adopt_ptr(
+      int sockfd,
+      const struct sockaddr_in *remote_address,
+      socklen_t remote_address_len);
+
   inline bool wait_write_event() const noexcept override {
     return m_wait_write_event;
   }
@@ -225,6 +302,25 @@ class TcpSocket final : public Socket {
     return m_err;
   }
 
+  /// bind binds the socket to `address`. If `reuse_port` is set,
+  /// multiple sockets can be bound to the same address and port, and
+  /// the kernel balances incoming connections between them
+  Status bind(const struct sockaddr_in *address,
+              bool reuse_port = false) noexcept;
+
+  /// listen marks the socket as accepting connections
+  Status listen(int backlog) noexcept;
+
+  /// accept accepts a pending connection. If there are no
+  /// pending connections, `socket` is reset, `wait_read_event`
+  /// is set to true and OK is returned
+  Status accept(std::unique_ptr<TcpSocket> *socket) noexcept;
+
+  /// connect starts a connection to `address`. The connection
+  /// is established asynchronously, and it completes once the
+  /// socket becomes writable
+  Status connect(const struct sockaddr_in *address) noexcept;
+
   /// shutdown_r closes the read part of the socket
   /// so that all subsequent calls to read from
   /// the socket will fail
@@ -278,7 +374,26 @@ class TcpSocket final : public Socket {
   Status read(uint8_t *src,
               size_t len,
               size_t *rbytes) noexcept override;
+  Status write_v(const struct iovec *iov,
+                 size_t iovcnt,
+                 size_t *wbytes) noexcept override;
+  Status read_v(const struct iovec *iov,
+                size_t iovcnt,
+                size_t *rbytes) noexcept override;
  private:
+  TcpSocket(int sockfd,
+            const struct sockaddr_in *remote_address,
+            socklen_t remote_address_len):
+      m_wait_write_event(false),
+      m_wait_read_event(false),
+      m_err(0),
+      m_sockfd(sockfd),
+      m_local_address_len(0),
+      m_remote_address_len(remote_address_len) {
+    memset(&m_local_address, 0, sizeof(struct sockaddr_in));
+    memcpy(&m_remote_address, remote_address, sizeof(struct sockaddr_in));
+  }
+
   bool m_wait_write_event;
   bool m_wait_read_event;
 
@@ -0,0 +1,293 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include <arpa/inet.h>
+
+#include "socket.hpp"
+
+static const size_t kCapacity = 256;
+
+static int test_udp_socket_batch() {
+  UdpSocket server(SocketDomain::IPv4);
+  UdpSocket client(SocketDomain::IPv4);
+  MsgBuffer wbuffer(UdpSocket::HEADER_SIZE, new uint8_t[kCapacity],
+                    kCapacity, DisposeFunc::array_delete());
+  MsgBuffer rbuffer(UdpSocket::HEADER_SIZE, new uint8_t[kCapacity],
+                    kCapacity, DisposeFunc::array_delete());
+  const char *payloads[] = {"a", "some content", "more"};
+  struct sockaddr_in address;
+  socklen_t len;
+  size_t wmsgs, rmsgs;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(server.bind(&address), OK);
+  ASSERT_EQ(client.bind(&address), OK);
+
+  const struct sockaddr_in *server_address = server.local_address(&len);
+  const struct sockaddr_in *client_address = client.local_address(&len);
+
+  for (const char *payload : payloads) {
+    uint8_t *dst;
+    size_t pbytes;
+
+    ASSERT_EQ(wbuffer.provide(&dst, 0, &pbytes), OK);
+    memcpy(dst, payload, strlen(payload));
+    memcpy(wbuffer.metadata(dst), server_address, sizeof(*server_address));
+    ASSERT_EQ(wbuffer.extend(strlen(payload)), strlen(payload));
+  }
+
+  ASSERT_EQ(client.write_batch(&wbuffer, UdpSocket::MAX_BATCH, &wmsgs), OK);
+  ASSERT_EQ(wmsgs, 3);
+  ASSERT_EQ(wbuffer.messages(), 0);
+
+  ASSERT_EQ(server.read_batch(&rbuffer, UdpSocket::MAX_BATCH, 32, &rmsgs), OK);
+  ASSERT_EQ(rmsgs, 3);
+  ASSERT_EQ(rbuffer.messages(), 3);
+
+  for (size_t i = 0; i < 3; i++) {
+    const uint8_t *msg;
+    size_t pbytes;
+    struct sockaddr_in peer;
+
+    ASSERT_EQ(rbuffer.peek_message(i, &msg, &pbytes), OK);
+    ASSERT_EQ(pbytes, strlen(payloads[i]));
+    ASSERT_MEM_EQ(msg, payloads[i], pbytes);
+
+    memcpy(&peer, rbuffer.metadata(msg), sizeof(peer));
+    ASSERT_EQ(peer.sin_port, client_address->sin_port);
+  }
+
+  ASSERT_EQ(server.read_batch(&rbuffer, UdpSocket::MAX_BATCH, 32, &rmsgs), OK);
+  ASSERT_EQ(rmsgs, 0);
+  ASSERT_TRUE(server.wait_read_event());
+
+  return EXIT_SUCCESS;
+}
+
+static int test_udp_socket_batch_reclaim() {
+  const size_t max_len = 32;
+  const size_t capacity = 2 * (max_len + UdpSocket::HEADER_SIZE);
+  UdpSocket server(SocketDomain::IPv4);
+  UdpSocket client(SocketDomain::IPv4);
+  MsgBuffer rbuffer(UdpSocket::HEADER_SIZE, new uint8_t[capacity],
+                    capacity, DisposeFunc::array_delete());
+  struct sockaddr_in address;
+  socklen_t len;
+  size_t wbytes, rmsgs;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(server.bind(&address), OK);
+  ASSERT_EQ(client.bind(&address), OK);
+  const struct sockaddr_in *server_address = server.local_address(&len);
+  client.set_remote_address(*server_address, len);
+
+  // the space of the datagrams consumed is reused
+  // once the end of the buffer is reached
+  for (size_t i = 0; i < 8; i++) {
+    ASSERT_EQ(client.write(reinterpret_cast<const uint8_t*>("datagram"),
+                           8, &wbytes), OK);
+    ASSERT_EQ(wbytes, 8);
+
+    ASSERT_EQ(server.read_batch(&rbuffer, UdpSocket::MAX_BATCH,
+                                max_len, &rmsgs), OK);
+    ASSERT_EQ(rmsgs, 1);
+    ASSERT_EQ(rbuffer.consume_messages(1), 1);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static int test_udp_socket_batch_truncated() {
+  const size_t max_len = 8;
+  UdpSocket server(SocketDomain::IPv4);
+  UdpSocket client(SocketDomain::IPv4);
+  MsgBuffer rbuffer(UdpSocket::HEADER_SIZE, new uint8_t[kCapacity],
+                    kCapacity, DisposeFunc::array_delete());
+  const char *payloads[] = {"short", "longer than max_len", "fits"};
+  struct sockaddr_in address;
+  const uint8_t *msg;
+  socklen_t len;
+  size_t wbytes, rmsgs, pbytes;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(server.bind(&address), OK);
+  ASSERT_EQ(client.bind(&address), OK);
+  const struct sockaddr_in *server_address = server.local_address(&len);
+  client.set_remote_address(*server_address, len);
+
+  for (const char *payload : payloads) {
+    ASSERT_EQ(client.write(reinterpret_cast<const uint8_t*>(payload),
+                           strlen(payload), &wbytes), OK);
+    ASSERT_EQ(wbytes, strlen(payload));
+  }
+
+  // the datagram that does not fit in max_len is dropped
+  ASSERT_EQ(server.read_batch(&rbuffer, UdpSocket::MAX_BATCH,
+                              max_len, &rmsgs), OK);
+  ASSERT_EQ(rmsgs, 2);
+  ASSERT_EQ(rbuffer.messages(), 2);
+
+  ASSERT_EQ(rbuffer.peek_message(0, &msg, &pbytes), OK);
+  ASSERT_EQ(pbytes, 5);
+  ASSERT_MEM_EQ(msg, "short", 5);
+  ASSERT_EQ(rbuffer.peek_message(1, &msg, &pbytes), OK);
+  ASSERT_EQ(pbytes, 4);
+  ASSERT_MEM_EQ(msg, "fits", 4);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_udp_socket_segments() {
+  const size_t capacity = 8192;
+  UdpSocket server(SocketDomain::IPv4);
+  UdpSocket client(SocketDomain::IPv4);
+  MsgBuffer wbuffer(UdpSocket::HEADER_SIZE, new uint8_t[capacity],
+                    capacity, DisposeFunc::array_delete());
+  MsgBuffer rbuffer(UdpSocket::HEADER_SIZE, new uint8_t[capacity],
+                    capacity, DisposeFunc::array_delete());
+  struct sockaddr_in address;
+  socklen_t len;
+  size_t wmsgs, rmsgs;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(server.bind(&address), OK);
+  ASSERT_EQ(client.bind(&address), OK);
+  ASSERT_EQ(server.set_gro(true), OK);
+
+  const struct sockaddr_in *server_address = server.local_address(&len);
+
+  // five full segments and a shorter one
+  for (size_t i = 0; i < 6; i++) {
+    const size_t size = i < 5 ? 100 : 40;
+    uint8_t *dst;
+    size_t pbytes;
+
+    ASSERT_EQ(wbuffer.provide(&dst, 0, &pbytes), OK);
+    memset(dst, 'a' + i, size);
+    memcpy(wbuffer.metadata(dst), server_address, sizeof(*server_address));
+    ASSERT_EQ(wbuffer.extend(size), size);
+  }
+
+  ASSERT_EQ(client.write_segments(&wbuffer, &wmsgs), OK);
+  ASSERT_EQ(wmsgs, 6);
+  ASSERT_EQ(wbuffer.messages(), 0);
+
+  // the datagrams may or may not be coalesced on receive
+  while (rbuffer.messages() < 6) {
+    ASSERT_EQ(server.read_segments(&rbuffer, 2048, &rmsgs), OK);
+    ASSERT_TRUE(rmsgs > 0);
+  }
+
+  for (size_t i = 0; i < 6; i++) {
+    const uint8_t *msg;
+    size_t pbytes;
+
+    ASSERT_EQ(rbuffer.peek_message(i, &msg, &pbytes), OK);
+    ASSERT_EQ(pbytes, i < 5 ? 100 : 40);
+    ASSERT_EQ(msg[0], 'a' + i);
+    ASSERT_EQ(msg[pbytes - 1], 'a' + i);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static int test_udp_socket_segments_truncated() {
+  const size_t capacity = 8192;
+  const size_t max_len = 250;
+  UdpSocket server(SocketDomain::IPv4);
+  UdpSocket client(SocketDomain::IPv4);
+  MsgBuffer wbuffer(UdpSocket::HEADER_SIZE, new uint8_t[capacity],
+                    capacity, DisposeFunc::array_delete());
+  MsgBuffer rbuffer(UdpSocket::HEADER_SIZE, new uint8_t[capacity],
+                    capacity, DisposeFunc::array_delete());
+  struct sockaddr_in address;
+  const uint8_t *msg;
+  socklen_t len;
+  size_t wmsgs, rmsgs, wbytes, pbytes;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  ASSERT_EQ(server.bind(&address), OK);
+  ASSERT_EQ(client.bind(&address), OK);
+  ASSERT_EQ(server.set_gro(true), OK);
+
+  const struct sockaddr_in *server_address = server.local_address(&len);
+  client.set_remote_address(*server_address, len);
+
+  // six segments of 100 bytes, 600 in all, larger than max_len
+  for (size_t i = 0; i < 6; i++) {
+    uint8_t *dst;
+
+    ASSERT_EQ(wbuffer.provide(&dst, 0, &pbytes), OK);
+    memset(dst, 'a' + i, 100);
+    memcpy(wbuffer.metadata(dst), server_address, sizeof(*server_address));
+    ASSERT_EQ(wbuffer.extend(100), 100);
+  }
+
+  ASSERT_EQ(client.write_segments(&wbuffer, &wmsgs), OK);
+  ASSERT_EQ(wmsgs, 6);
+  ASSERT_EQ(client.write(reinterpret_cast<const uint8_t*>("end"), 3,
+                         &wbytes), OK);
+
+  // if the segments are coalesced, the datagram is dropped. Otherwise
+  // each of them fits and is stored. Either way no message is cut
+  // short, and the datagram sent after them is received
+  for (size_t i = 0; i < 8; i++) {
+    ASSERT_EQ(server.read_segments(&rbuffer, max_len, &rmsgs), OK);
+    if (rbuffer.messages() > 0) {
+      ASSERT_EQ(rbuffer.peek_message(rbuffer.messages() - 1,
+                                     &msg, &pbytes), OK);
+      if (pbytes == 3) {
+        break;
+      }
+    }
+  }
+
+  const size_t messages = rbuffer.messages();
+  ASSERT_TRUE(messages == 1 || messages == 7);
+  for (size_t i = 0; i + 1 < messages; i++) {
+    ASSERT_EQ(rbuffer.peek_message(i, &msg, &pbytes), OK);
+    ASSERT_EQ(pbytes, 100);
+    ASSERT_EQ(msg[0], 'a' + i);
+    ASSERT_EQ(msg[99], 'a' + i);
+  }
+
+  ASSERT_EQ(rbuffer.peek_message(messages - 1, &msg, &pbytes), OK);
+  ASSERT_EQ(pbytes, 3);
+  ASSERT_MEM_EQ(msg, "end", 3);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_udp_socket_batch());
+  TEST_RUN(ctx, test_udp_socket_batch_reclaim());
+  TEST_RUN(ctx, test_udp_socket_batch_truncated());
+  TEST_RUN(ctx, test_udp_socket_segments());
+  TEST_RUN(ctx, test_udp_socket_segments_truncated());
+
+  return TEST_RELEASE(ctx);
+}
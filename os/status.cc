@@ -8,10 +8,26 @@ Status SocketWriteFailed =
     new StatusClass (1, "[SocketWriteFailed]: failed to write to socket");
 Status SocketShutdownFailed =
     new StatusClass (1, "[SocketShutdownFailed]: failed to shutdown socket");
+Status SocketBindFailed =
+    new StatusClass (1, "[SocketBindFailed]: failed to bind socket");
+Status SocketListenFailed =
+    new StatusClass (1, "[SocketListenFailed]: failed to listen on socket");
+Status SocketAcceptFailed =
+    new StatusClass (1, "[SocketAcceptFailed]: failed to accept connection");
+Status SocketConnectFailed =
+    new StatusClass (1, "[SocketConnectFailed]: failed to connect socket");
+Status SocketOptionFailed =
+    new StatusClass (1, "[SocketOptionFailed]: failed to set socket option");
 Status FileReadFailed =
     new StatusClass (1, "[FileReadFailed]: failed to read from file");
 Status FileWriteFailed =
     new StatusClass (1, "[FileWriteFailed]: failed to write to file");
+Status FileWatchFailed =
+    new StatusClass (1, "[FileWatchFailed]: failed to read file events");
+Status FileMapFailed =
+    new StatusClass (1, "[FileMapFailed]: failed to map file");
+Status CopyFailed =
+    new StatusClass (1, "[CopyFailed]: failed to copy between files");
 Status PipeReadFailed =
     new StatusClass (1, "[PipeReadFailed]: failed to read from pipe");
 Status PipeWriteFailed =
@@ -28,3 +44,15 @@ Status EventLoopMonitorFDFailed =
 Status EventLoopUnmonitorFDFailed =
     new StatusClass(1, "[EventLoopUnmonitorFDFailed] event loop "
                     "failed to monitor file descriptor");
+Status EventLoopWaitFailed =
+    new StatusClass(1, "[EventLoopWaitFailed] event loop "
+                    "failed to wait for events");
+Status EventLoopGroupStartFailed =
+    new StatusClass(1, "[EventLoopGroupStartFailed] event loop group "
+                    "failed to start loop threads");
+Status EventLoopSubmitFailed =
+    new StatusClass(1, "[EventLoopSubmitFailed] event loop "
+                    "failed to submit operation");
+Status EventLoopSubmitUnsupported =
+    new StatusClass(1, "[EventLoopSubmitUnsupported] event loop "
+                    "backend does not support submitting operations");
@@ -5,8 +5,16 @@
 extern Status SocketReadFailed;
 extern Status SocketWriteFailed;
 extern Status SocketShutdownFailed;
+extern Status SocketBindFailed;
+extern Status SocketListenFailed;
+extern Status SocketAcceptFailed;
+extern Status SocketConnectFailed;
+extern Status SocketOptionFailed;
 extern Status FileReadFailed;
 extern Status FileWriteFailed;
+extern Status FileWatchFailed;
+extern Status FileMapFailed;
+extern Status CopyFailed;
 extern Status PipeReadFailed;
 extern Status PipeWriteFailed;
 extern Status PipeRCloseFailed;
@@ -15,3 +23,7 @@ extern Status ArgInvalidFD;
 extern Status EventLoopMonitorFDFailed;
 extern Status EventLoopUnmonitorFDFailed;
 
+extern Status EventLoopWaitFailed;
+extern Status EventLoopGroupStartFailed;
+extern Status EventLoopSubmitFailed;
+extern Status EventLoopSubmitUnsupported;
@@ -0,0 +1,191 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "timer_wheel.hpp"
+
+static inline uint64_t rotr(uint64_t value, unsigned int shift) {
+  return shift == 0 ? value : (value >> shift) | (value << (64 - shift));
+}
+
+TimerWheel::TimerWheel():
+    m_now(0),
+    m_size(0) {
+  for (int level = 0; level < LEVELS; level++) {
+    m_bitmap[level] = 0;
+  }
+
+  for (int slot = 0; slot < LEVELS * SLOTS; slot++) {
+    m_slots[slot].next = &m_slots[slot];
+    m_slots[slot].prev = &m_slots[slot];
+  }
+
+  m_expired.next = &m_expired;
+  m_expired.prev = &m_expired;
+}
+
+void TimerWheel::link(Timer *timer, uint32_t slot) noexcept {
+  Timer *list = head(slot);
+
+  timer->slot = slot;
+  timer->next = list;
+  timer->prev = list->prev;
+  list->prev->next = timer;
+  list->prev = timer;
+
+  if (slot != EXPIRED) {
+    m_bitmap[slot >> BITS] |= 1ULL << (slot & MASK);
+  }
+}
+
+void TimerWheel::unlink(Timer *timer) noexcept {
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = nullptr;
+  timer->prev = nullptr;
+
+  if (timer->slot != EXPIRED) {
+    Timer *list = &m_slots[timer->slot];
+    if (list->next == list) {
+      m_bitmap[timer->slot >> BITS] &= ~(1ULL << (timer->slot & MASK));
+    }
+  }
+}
+
+void TimerWheel::insert(Timer *timer) noexcept {
+  const uint64_t deadline = timer->deadline;
+
+  if (deadline <= m_now) {
+    link(timer, EXPIRED);
+    return;
+  }
+
+  // pick the lowest level in which the deadline falls
+  // within the next SLOTS slots
+  for (int level = 0; level < LEVELS; level++) {
+    const int shift = level * BITS;
+    if ((deadline >> shift) - (m_now >> shift) < SLOTS) {
+      link(timer, level * SLOTS + ((deadline >> shift) & MASK));
+      return;
+    }
+  }
+
+  // the deadline is beyond the reach of the wheel. Keep the timer
+  // in the furthest slot, it will be rescheduled when cascaded
+  const int shift = (LEVELS - 1) * BITS;
+  link(timer, (LEVELS - 1) * SLOTS + (((m_now >> shift) + MASK) & MASK));
+}
+
+void TimerWheel::arm(Timer *timer, uint64_t deadline) noexcept {
+  if (armed(timer)) {
+    unlink(timer);
+    m_size--;
+  }
+
+  timer->deadline = deadline;
+  insert(timer);
+  m_size++;
+}
+
+void TimerWheel::cancel(Timer *timer) noexcept {
+  if (armed(timer)) {
+    unlink(timer);
+    m_size--;
+  }
+}
+
+TimerWheel::Timer *TimerWheel::expire() noexcept {
+  if (m_expired.next == &m_expired) {
+    return nullptr;
+  }
+
+  Timer *timer = m_expired.next;
+  unlink(timer);
+  m_size--;
+  return timer;
+}
+
+void TimerWheel::cascade(int level) noexcept {
+  const uint64_t index = (m_now >> (level * BITS)) & MASK;
+  Timer *list = &m_slots[level * SLOTS + index];
+
+  while (list->next != list) {
+    Timer *timer = list->next;
+    unlink(timer);
+    insert(timer);
+  }
+}
+
+void TimerWheel::collect() noexcept {
+  Timer *list = &m_slots[m_now & MASK];
+
+  while (list->next != list) {
+    Timer *timer = list->next;
+    unlink(timer);
+    insert(timer);
+  }
+}
+
+void TimerWheel::advance(uint64_t now) noexcept {
+  while (m_now < now) {
+    if ((m_bitmap[0] | m_bitmap[1] | m_bitmap[2] | m_bitmap[3]) == 0) {
+      m_now = now;
+      return;
+    }
+
+    // jump to the next tick in which there is work to do, which is
+    // either the next non empty slot in the first level, or the start
+    // of the next rotation of the first level, where the upper
+    // levels are cascaded
+    const uint64_t index = m_now & MASK;
+    const uint64_t pending = index == MASK
+        ? 0 : m_bitmap[0] & (~0ULL << (index + 1));
+    const uint64_t next = pending
+        ? (m_now & ~MASK) + __builtin_ctzll(pending)
+        : (m_now | MASK) + 1;
+
+    if (next > now) {
+      m_now = now;
+      return;
+    }
+
+    m_now = next;
+    if ((m_now & MASK) == 0) {
+      for (int level = LEVELS - 1; level > 0; level--) {
+        if ((m_now & ((1ULL << (level * BITS)) - 1)) == 0) {
+          cascade(level);
+        }
+      }
+    }
+
+    collect();
+  }
+}
+
+int64_t TimerWheel::next() const noexcept {
+  int64_t next = -1;
+
+  if (m_expired.next != &m_expired) {
+    return 0;
+  }
+
+  for (int level = 0; level < LEVELS; level++) {
+    if (m_bitmap[level] == 0) {
+      continue;
+    }
+
+    // for the first level this is the deadline of the first timer,
+    // for the rest it is the tick in which the first non empty slot
+    // is cascaded, which is never after any of its deadlines
+    const int shift = level * BITS;
+    const uint64_t index = (m_now >> shift) & MASK;
+    const uint64_t rotated = rotr(m_bitmap[level], (index + 1) & MASK);
+    const uint64_t offset = __builtin_ctzll(rotated) + 1;
+    const uint64_t tick = ((m_now >> shift) + offset) << shift;
+    const int64_t delta = static_cast<int64_t>(tick - m_now);
+
+    if (next == -1 || delta < next) {
+      next = delta;
+    }
+  }
+
+  return next;
+}
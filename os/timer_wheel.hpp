@@ -0,0 +1,105 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef OS_TIMERWHEEL_H_
+#define OS_TIMERWHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// TimerWheel is a hierarchical timing wheel. Time is measured
+/// in ticks, and timers are kept in LEVELS wheels of SLOTS slots
+/// each, where a slot in level l covers SLOTS^l ticks. Arming and
+/// cancelling a timer are O(1) operations, and timers in the upper
+/// levels are cascaded down to the lower ones as time advances.
+/// Deadlines further than SLOTS^LEVELS ticks are kept in the last
+/// level and rescheduled until they are reached.
+///
+/// Timers are intrusive, so the wheel never allocates memory. A
+/// Timer must not be destroyed or moved while it is armed.
+/// TimerWheel is not a multi-thread safe class.
+class TimerWheel final {
+ public:
+  struct Timer final {
+    Timer():
+        next(nullptr),
+        prev(nullptr),
+        deadline(0),
+        slot(0) { }
+
+    Timer *next;
+    Timer *prev;
+    uint64_t deadline;
+    uint32_t slot;
+  };
+
+  TimerWheel();
+  ~TimerWheel() = default;
+
+  TimerWheel(const TimerWheel &wheel) = delete;
+  TimerWheel(TimerWheel &&wheel) = delete;
+  TimerWheel& operator=(const TimerWheel &wheel) = delete;
+  TimerWheel& operator=(TimerWheel &&wheel) = delete;
+
+  /// now returns the tick the wheel has advanced to
+  inline uint64_t now() const noexcept {
+    return m_now;
+  }
+
+  /// size returns the number of armed timers, including
+  /// the ones that have expired and have not been popped yet
+  inline size_t size() const noexcept {
+    return m_size;
+  }
+
+  /// armed returns true if the timer is armed
+  static inline bool armed(const Timer *timer) noexcept {
+    return timer->next != nullptr;
+  }
+
+  /// arm schedules the timer to expire at the tick `deadline`.
+  /// If the timer was already armed it is rescheduled
+  void arm(Timer *timer, uint64_t deadline) noexcept;
+
+  /// cancel disarms the timer. It is safe to cancel
+  /// a timer that is not armed
+  void cancel(Timer *timer) noexcept;
+
+  /// advance moves the wheel forward up to the tick `now`, and
+  /// collects all the timers with a deadline before or at `now`
+  /// so that they can be popped with `expire`
+  void advance(uint64_t now) noexcept;
+
+  /// expire pops one of the timers that have expired or returns
+  /// nullptr if there are none. The timer is disarmed when popped
+  Timer *expire() noexcept;
+
+  /// next returns the number of ticks until the next time the
+  /// wheel needs to be advanced, or -1 if there are no timers armed
+  int64_t next() const noexcept;
+
+ private:
+  static constexpr int BITS = 6;
+  static constexpr int SLOTS = 1 << BITS;
+  static constexpr int LEVELS = 4;
+  static constexpr uint64_t MASK = SLOTS - 1;
+  static constexpr uint64_t SPAN = (1ULL << (BITS * LEVELS)) - 1;
+  static constexpr uint32_t EXPIRED = LEVELS * SLOTS;
+
+  void insert(Timer *timer) noexcept;
+  void link(Timer *timer, uint32_t slot) noexcept;
+  void unlink(Timer *timer) noexcept;
+  void cascade(int level) noexcept;
+  void collect() noexcept;
+
+  inline Timer *head(uint32_t slot) noexcept {
+    return slot == EXPIRED ? &m_expired : &m_slots[slot];
+  }
+
+  uint64_t m_now;
+  size_t m_size;
+  uint64_t m_bitmap[LEVELS];
+  Timer m_slots[LEVELS * SLOTS];
+  Timer m_expired;
+};
+
+#endif  // OS_TIMERWHEEL_H_
@@ -0,0 +1,110 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "test/test.hpp"
+
+#include "timer_wheel.hpp"
+
+static int test_timer_wheel_expire_in_order() {
+  TimerWheel wheel;
+  TimerWheel::Timer timers[3];
+
+  wheel.arm(&timers[0], 10);
+  wheel.arm(&timers[1], 5);
+  wheel.arm(&timers[2], 20);
+  ASSERT_EQ(wheel.size(), 3);
+  ASSERT_EQ(wheel.next(), 5);
+
+  wheel.advance(4);
+  ASSERT_EQ(wheel.expire(), nullptr);
+
+  wheel.advance(5);
+  ASSERT_EQ(wheel.expire(), &timers[1]);
+  ASSERT_EQ(wheel.expire(), nullptr);
+  ASSERT_FALSE(TimerWheel::armed(&timers[1]));
+  ASSERT_EQ(wheel.next(), 5);
+
+  wheel.advance(25);
+  ASSERT_EQ(wheel.expire(), &timers[0]);
+  ASSERT_EQ(wheel.expire(), &timers[2]);
+  ASSERT_EQ(wheel.expire(), nullptr);
+  ASSERT_EQ(wheel.size(), 0);
+  ASSERT_EQ(wheel.next(), -1);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_timer_wheel_cancel_rearm() {
+  TimerWheel wheel;
+  TimerWheel::Timer timer1, timer2;
+
+  wheel.arm(&timer1, 100);
+  wheel.arm(&timer2, 100);
+  wheel.cancel(&timer1);
+  wheel.cancel(&timer1);
+  ASSERT_EQ(wheel.size(), 1);
+
+  wheel.arm(&timer2, 200);
+  ASSERT_EQ(wheel.size(), 1);
+
+  wheel.advance(150);
+  ASSERT_EQ(wheel.expire(), nullptr);
+
+  wheel.advance(200);
+  ASSERT_EQ(wheel.expire(), &timer2);
+  ASSERT_EQ(wheel.expire(), nullptr);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_timer_wheel_cascade() {
+  TimerWheel wheel;
+  const uint64_t deadlines[] = {63, 64, 65, 4095, 4096, 70000, 300000, 20000000};
+  const size_t len = sizeof(deadlines) / sizeof(deadlines[0]);
+  TimerWheel::Timer timers[len];
+
+  wheel.advance(1);
+  for (size_t i = 0; i < len; i++) {
+    wheel.arm(&timers[i], deadlines[i]);
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    int64_t next = wheel.next();
+    ASSERT_TRUE(next > 0);
+    ASSERT_TRUE(wheel.now() + next <= deadlines[i]);
+
+    wheel.advance(deadlines[i] - 1);
+    ASSERT_EQ(wheel.expire(), nullptr);
+
+    wheel.advance(deadlines[i]);
+    ASSERT_EQ(wheel.expire(), &timers[i]);
+    ASSERT_EQ(wheel.expire(), nullptr);
+  }
+
+  ASSERT_EQ(wheel.size(), 0);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_timer_wheel_past_deadline() {
+  TimerWheel wheel;
+  TimerWheel::Timer timer;
+
+  wheel.advance(10);
+  wheel.arm(&timer, 5);
+  ASSERT_EQ(wheel.next(), 0);
+  ASSERT_EQ(wheel.expire(), &timer);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  test_ctx_t ctx;
+  TEST_INIT(ctx, argc, argv);
+
+  TEST_RUN(ctx, test_timer_wheel_expire_in_order());
+  TEST_RUN(ctx, test_timer_wheel_cancel_rearm());
+  TEST_RUN(ctx, test_timer_wheel_cascade());
+  TEST_RUN(ctx, test_timer_wheel_past_deadline());
+
+  return TEST_RELEASE(ctx);
+}
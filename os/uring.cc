@@ -0,0 +1,343 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "uring.hpp"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int uring_setup(unsigned int entries, struct io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags,
+                       const void *arg,
+                       size_t argsz) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, arg, argsz));
+}
+
+static void *uring_mmap(int fd, size_t size, off_t offset) {
+  void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+std::unique_ptr<Uring> Uring::open(unsigned int entries) noexcept {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  const int fd = uring_setup(entries, &params);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  std::unique_ptr<Uring> uring(new Uring());
+  uring->m_fd = fd;
+
+  const unsigned int required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+      IORING_FEAT_EXT_ARG;
+  if ((params.features & required) != required) {
+    return nullptr;
+  }
+
+  uring->m_sq_ring_size = std::max(
+      params.sq_off.array + params.sq_entries * sizeof(unsigned int),
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+  uring->m_sq_ring = uring_mmap(fd, uring->m_sq_ring_size, IORING_OFF_SQ_RING);
+  if (uring->m_sq_ring == nullptr) {
+    return nullptr;
+  }
+
+  // with a single mmap the completion ring shares
+  // the mapping of the submission ring
+  uring->m_cq_ring = uring->m_sq_ring;
+
+  uring->m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  uring->m_sqes = reinterpret_cast<struct io_uring_sqe*>(
+      uring_mmap(fd, uring->m_sqes_size, IORING_OFF_SQES));
+  if (uring->m_sqes == nullptr) {
+    return nullptr;
+  }
+
+  uint8_t *sq = reinterpret_cast<uint8_t*>(uring->m_sq_ring);
+  uring->m_sq_head = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+  uring->m_sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+  uring->m_sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+  uring->m_sq_mask =
+      *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+  uring->m_sq_entries = params.sq_entries;
+
+  uint8_t *cq = reinterpret_cast<uint8_t*>(uring->m_cq_ring);
+  uring->m_cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+  uring->m_cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+  uring->m_cq_mask =
+      *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+  uring->m_cqes = reinterpret_cast<struct io_uring_cqe*>(
+      cq + params.cq_off.cqes);
+
+  // cancellation by file descriptor is the last of the features
+  // the ring needs to be added to the kernel. Cancelling the
+  // operations of a file without pending operations completes
+  // with no cancellations where it is supported, and fails
+  // with EINVAL where it is not
+  if (!uring->cancel(fd, 0) || uring->submit(true, -1) == -1) {
+    return nullptr;
+  }
+
+  Completion completion;
+  if (uring->complete(&completion, 1) != 1 ||
+      (completion.res < 0 && completion.res != -ENOENT)) {
+    return nullptr;
+  }
+
+  return uring;
+}
+
+Uring::~Uring() {
+  if (m_sqes != nullptr) {
+    munmap(m_sqes, m_sqes_size);
+  }
+
+  if (m_sq_ring != nullptr) {
+    munmap(m_sq_ring, m_sq_ring_size);
+  }
+
+  if (m_fd > -1) {
+    close(m_fd);
+  }
+}
+
+struct io_uring_sqe *Uring::sqe() noexcept {
+  unsigned int head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+  unsigned int tail = *m_sq_tail;
+
+  if (tail - head >= m_sq_entries) {
+    // the submission ring is full, so the queued
+    // operations are handed to the kernel to make room
+    if (submit(false, -1) == -1) {
+      return nullptr;
+    }
+
+    head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= m_sq_entries) {
+      errno = EBUSY;
+      return nullptr;
+    }
+  }
+
+  const unsigned int index = tail & m_sq_mask;
+  struct io_uring_sqe *sqe = &m_sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  m_sq_array[index] = index;
+  __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+  m_queued++;
+  return sqe;
+}
+
+bool Uring::poll(int fd,
+                 uint32_t mask,
+                 bool multishot,
+                 uint64_t user_data) noexcept {
+  struct io_uring_sqe *sqe = this->sqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = mask;
+  sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::cancel(int fd, uint64_t user_data) noexcept {
+  struct io_uring_sqe *sqe = this->sqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = fd;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::read(int fd,
+                 uint8_t *dst,
+                 size_t len,
+                 uint64_t user_data) noexcept {
+  struct io_uring_sqe *sqe = this->sqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->off = static_cast<uint64_t>(-1);
+  sqe->addr = reinterpret_cast<uint64_t>(dst);
+  sqe->len = static_cast<uint32_t>(len);
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::write(int fd,
+                  const uint8_t *src,
+                  size_t len,
+                  uint64_t user_data) noexcept {
+  struct io_uring_sqe *sqe = this->sqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_WRITE;
+  sqe->fd = fd;
+  sqe->off = static_cast<uint64_t>(-1);
+  sqe->addr = reinterpret_cast<uint64_t>(src);
+  sqe->len = static_cast<uint32_t>(len);
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::accept(int fd,
+                   struct sockaddr *addr,
+                   socklen_t *len,
+                   uint64_t user_data) noexcept {
+  struct io_uring_sqe *sqe = this->sqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(addr);
+  sqe->addr2 = reinterpret_cast<uint64_t>(len);
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool Uring::connect(int fd,
+                    const struct sockaddr *addr,
+                    socklen_t len,
+                    uint64_t user_data) noexcept {
+  struct io_uring_sqe *sqe = this->sqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->opcode = IORING_OP_CONNECT;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(addr);
+  sqe->off = len;
+  sqe->user_data = user_data;
+  return true;
+}
+
+int Uring::submit(bool wait, int64_t timeout_ms) noexcept {
+  unsigned int flags = wait ? IORING_ENTER_GETEVENTS : 0;
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  const void *argp = nullptr;
+  size_t argsz = 0;
+
+  if (wait && timeout_ms > -1) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    flags |= IORING_ENTER_EXT_ARG;
+    argp = &arg;
+    argsz = sizeof(arg);
+  }
+
+  const unsigned int to_submit = m_queued;
+  int res = uring_enter(m_fd, to_submit, wait ? 1 : 0, flags, argp, argsz);
+  if (res == -1) {
+    // an expired timeout still submits the queued operations
+    if (errno == ETIME) {
+      m_queued = 0;
+      return 0;
+    }
+
+    return -1;
+  }
+
+  m_queued -= std::min(m_queued, static_cast<unsigned int>(res));
+  return res;
+}
+
+size_t Uring::complete(Completion *out, size_t len) noexcept {
+  unsigned int head = *m_cq_head;
+  const unsigned int tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+  size_t count = 0;
+
+  while (head != tail && count < len) {
+    const struct io_uring_cqe *cqe = &m_cqes[head & m_cq_mask];
+    out[count].user_data = cqe->user_data;
+    out[count].res = cqe->res;
+    out[count].more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    count++;
+    head++;
+  }
+
+  __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+  return count;
+}
+
+#else
+
+std::unique_ptr<Uring> Uring::open(unsigned int entries) noexcept {
+  (void)(entries);
+  return nullptr;
+}
+
+Uring::~Uring() { }
+
+bool Uring::poll(int, uint32_t, bool, uint64_t) noexcept {
+  return false;
+}
+
+bool Uring::cancel(int, uint64_t) noexcept {
+  return false;
+}
+
+bool Uring::read(int, uint8_t*, size_t, uint64_t) noexcept {
+  return false;
+}
+
+bool Uring::write(int, const uint8_t*, size_t, uint64_t) noexcept {
+  return false;
+}
+
+bool Uring::accept(int, struct sockaddr*, socklen_t*, uint64_t) noexcept {
+  return false;
+}
+
+bool Uring::connect(int, const struct sockaddr*, socklen_t, uint64_t) noexcept {
+  return false;
+}
+
+int Uring::submit(bool, int64_t) noexcept {
+  errno = ENOSYS;
+  return -1;
+}
+
+size_t Uring::complete(Completion*, size_t) noexcept {
+  return 0;
+}
+
+#endif
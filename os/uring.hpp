@@ -0,0 +1,117 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef OS_URING_H_
+#define OS_URING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <memory>
+
+/// Uring is a thin wrapper around a Linux io_uring instance that
+/// talks to the kernel through raw syscalls. Operations are queued
+/// in the submission ring and handed to the kernel in a single
+/// call to `submit`, which can also wait for their completions.
+/// Completions are tagged with the `user_data` given when the
+/// operation was queued.
+///
+/// Uring is only available on Linux kernels that support
+/// multishot polls, extended wait arguments and cancellation
+/// by file descriptor (5.19 and later). On any other platform
+/// `open` returns nullptr. Uring is not a multi-thread safe class.
+class Uring final {
+ public:
+  struct Completion final {
+    uint64_t user_data;
+    int32_t res;
+    // more is set while a multishot operation
+    // keeps posting completions
+    bool more;
+  };
+
+  /// open sets up a ring with room for at least `entries`
+  /// queued operations. It returns nullptr if the kernel
+  /// does not support the operations the ring relies on
+  static std::unique_ptr<Uring> open(unsigned int entries) noexcept;
+
+  ~Uring();
+
+  Uring(const Uring &uring) = delete;
+  Uring(Uring &&uring) = delete;
+  Uring& operator=(const Uring &uring) = delete;
+  Uring& operator=(Uring &&uring) = delete;
+
+  /// poll queues a poll for `mask` on fd. A multishot poll
+  /// keeps posting completions until it is cancelled
+  bool poll(int fd, uint32_t mask, bool multishot, uint64_t user_data) noexcept;
+
+  /// cancel queues the cancellation of every operation
+  /// pending on fd, polls included
+  bool cancel(int fd, uint64_t user_data) noexcept;
+
+  /// read queues a read of up to len bytes from the current
+  /// position of fd into dst
+  bool read(int fd, uint8_t *dst, size_t len, uint64_t user_data) noexcept;
+
+  /// write queues a write of up to len bytes from src at
+  /// the current position of fd
+  bool write(int fd, const uint8_t *src, size_t len, uint64_t user_data) noexcept;
+
+  /// accept queues an accept on the listening socket fd. The
+  /// accepted socket is created non blocking
+  bool accept(int fd,
+              struct sockaddr *addr,
+              socklen_t *len,
+              uint64_t user_data) noexcept;
+
+  /// connect queues a connect of the socket fd to addr
+  bool connect(int fd,
+               const struct sockaddr *addr,
+               socklen_t len,
+               uint64_t user_data) noexcept;
+
+  /// submit hands the queued operations to the kernel and,
+  /// if wait is true, waits for at least one completion or
+  /// until timeout_ms expires. A negative timeout waits
+  /// without limit. It returns -1 and sets errno on failure
+  int submit(bool wait, int64_t timeout_ms) noexcept;
+
+  /// complete pops up to len completions into out
+  /// and returns the number of completions popped
+  size_t complete(Completion *out, size_t len) noexcept;
+
+  /// queued returns the number of operations queued
+  /// and not submitted yet
+  inline unsigned int queued() const noexcept {
+    return m_queued;
+  }
+
+ private:
+  Uring() = default;
+
+  struct io_uring_sqe *sqe() noexcept;
+
+  int m_fd = -1;
+  unsigned int m_queued = 0;
+
+  void *m_sq_ring = nullptr;
+  size_t m_sq_ring_size = 0;
+  void *m_cq_ring = nullptr;
+  size_t m_cq_ring_size = 0;
+  struct io_uring_sqe *m_sqes = nullptr;
+  size_t m_sqes_size = 0;
+
+  unsigned int *m_sq_head = nullptr;
+  unsigned int *m_sq_tail = nullptr;
+  unsigned int *m_sq_array = nullptr;
+  unsigned int m_sq_mask = 0;
+  unsigned int m_sq_entries = 0;
+
+  unsigned int *m_cq_head = nullptr;
+  unsigned int *m_cq_tail = nullptr;
+  unsigned int m_cq_mask = 0;
+  struct io_uring_cqe *m_cqes = nullptr;
+};
+
+#endif  // OS_URING_H_
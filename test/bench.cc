@@ -0,0 +1,350 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "bench.hpp"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "test.hpp"
+
+/// BENCH_TARGET_NS is the minimum duration of a repetition, the
+/// number of iterations is calibrated to reach it
+static constexpr double BENCH_TARGET_NS = 10e6;
+static constexpr int BENCH_WARMUP = 2;
+static constexpr int BENCH_MAX_ITERATIONS = 1 << 30;
+
+static double clock_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/// Counters reads the instructions and the cache misses of the
+/// thread with perf_event_open, as a group so that both count
+/// over the same interval. They are not available when the
+/// kernel does not allow it, as in most containers
+class Counters final {
+ public:
+  Counters():
+      m_leader(-1),
+      m_misses(-1) {
+#ifdef __linux__
+    m_leader = open(PERF_COUNT_HW_INSTRUCTIONS, -1);
+    if (m_leader > -1) {
+      m_misses = open(PERF_COUNT_HW_CACHE_MISSES, m_leader);
+    }
+#endif
+  }
+
+  ~Counters() {
+    if (m_misses > -1) {
+      close(m_misses);
+    }
+
+    if (m_leader > -1) {
+      close(m_leader);
+    }
+  }
+
+  Counters(const Counters &counters) = delete;
+  Counters& operator=(const Counters &counters) = delete;
+
+  inline bool available() const noexcept {
+    return m_leader > -1;
+  }
+
+  void start() {
+#ifdef __linux__
+    if (m_leader > -1) {
+      ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+  }
+
+  /// stop sets the counters since the last start,
+  /// or -1 for those that are not available
+  void stop(double *instructions, double *misses) {
+    *instructions = -1;
+    *misses = -1;
+
+#ifdef __linux__
+    if (m_leader > -1) {
+      uint64_t values[3] = {0, 0, 0};
+      ioctl(m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      if (read(m_leader, values, sizeof(values)) > 0) {
+        *instructions = static_cast<double>(values[1]);
+        if (m_misses > -1 && values[0] > 1) {
+          *misses = static_cast<double>(values[2]);
+        }
+      }
+    }
+#endif
+  }
+
+ private:
+#ifdef __linux__
+  static int open(uint64_t config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = group == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1,
+                                    group, 0));
+  }
+#endif
+
+  int m_leader;
+  int m_misses;
+};
+
+void bench_stats(double *samples, size_t n, BenchStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (n == 0) {
+    return;
+  }
+
+  std::sort(samples, samples + n);
+  double sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += samples[i];
+  }
+
+  double squares = 0;
+  stats->mean = sum / n;
+  for (size_t i = 0; i < n; i++) {
+    squares += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+  }
+
+  // the p99 is the nearest rank, which is the maximum
+  // when there are less than a hundred samples
+  const size_t rank = static_cast<size_t>(ceil(0.99 * n));
+  stats->min = samples[0];
+  stats->median = n % 2 == 1 ? samples[n / 2] :
+      (samples[n / 2 - 1] + samples[n / 2]) / 2;
+  stats->p99 = samples[rank > 0 ? rank - 1 : 0];
+  stats->stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+}
+
+bool bench_parse_format(const char *name, BenchFormat *format) {
+  if (strcmp(name, "text") == 0) {
+    *format = BenchFormat::text;
+  } else if (strcmp(name, "csv") == 0) {
+    *format = BenchFormat::csv;
+  } else if (strcmp(name, "json") == 0) {
+    *format = BenchFormat::json;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+/// mb_per_s returns the throughput of `result` in
+/// megabytes per second, from its median time per operation
+static double mb_per_s(const BenchResult &result) {
+  return result.ns.median > 0 ? result.bytes * 1e3 / result.ns.median : 0;
+}
+
+/// print_counter prints a counter, or `none` if it is not available
+static void print_counter(FILE *out, const char *fmt,
+                          double value, const char *none) {
+  if (value < 0) {
+    fputs(none, out);
+  } else {
+    fprintf(out, fmt, value);
+  }
+}
+
+void bench_report(FILE *out, BenchFormat format,
+                  const BenchResult &result, bool first) {
+  switch (format) {
+    case BenchFormat::text:
+      fprintf(out, "%s - median %.2f ns/op, min %.2f, p99 %.2f, "
+              "stddev %.2f, cycles ",
+              result.name, result.ns.median, result.ns.min,
+              result.ns.p99, result.ns.stddev);
+      print_counter(out, "%.1f", result.cycles, "-");
+      fputs(", instructions ", out);
+      print_counter(out, "%.1f", result.instructions, "-");
+      fputs(", cache misses ", out);
+      print_counter(out, "%.3f", result.cache_misses, "-");
+      if (result.bytes > 0) {
+        fprintf(out, ", %.1f MB/s", mb_per_s(result));
+      }
+      fprintf(out, " - %d x %d iter\n",
+              result.repetitions, result.iterations);
+      break;
+
+    case BenchFormat::csv:
+      if (first) {
+        fputs("name,iterations,repetitions,min_ns,median_ns,p99_ns,"
+              "mean_ns,stddev_ns,cycles,instructions,cache_misses,"
+              "bytes,mb_per_s\n", out);
+      }
+
+      fprintf(out, "%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,",
+              result.name, result.iterations, result.repetitions,
+              result.ns.min, result.ns.median, result.ns.p99,
+              result.ns.mean, result.ns.stddev);
+      print_counter(out, "%.3f", result.cycles, "");
+      fputc(',', out);
+      print_counter(out, "%.3f", result.instructions, "");
+      fputc(',', out);
+      print_counter(out, "%.3f", result.cache_misses, "");
+      if (result.bytes > 0) {
+        fprintf(out, ",%.0f,%.3f\n", result.bytes, mb_per_s(result));
+      } else {
+        fputs(",,\n", out);
+      }
+      break;
+
+    case BenchFormat::json:
+      fprintf(out, "{\"name\": \"%s\", \"iterations\": %d, "
+              "\"repetitions\": %d, \"min_ns\": %.3f, \"median_ns\": %.3f, "
+              "\"p99_ns\": %.3f, \"mean_ns\": %.3f, \"stddev_ns\": %.3f, "
+              "\"cycles\": ",
+              result.name, result.iterations, result.repetitions,
+              result.ns.min, result.ns.median, result.ns.p99,
+              result.ns.mean, result.ns.stddev);
+      print_counter(out, "%.3f", result.cycles, "null");
+      fputs(", \"instructions\": ", out);
+      print_counter(out, "%.3f", result.instructions, "null");
+      fputs(", \"cache_misses\": ", out);
+      print_counter(out, "%.3f", result.cache_misses, "null");
+      if (result.bytes > 0) {
+        fprintf(out, ", \"bytes\": %.0f, \"mb_per_s\": %.3f",
+                result.bytes, mb_per_s(result));
+      }
+      fputs("}\n", out);
+      break;
+  }
+
+  fflush(out);
+}
+
+/// calibrate returns the number of iterations that make a run of
+/// `bench` last at least BENCH_TARGET_NS, or 0 if `bench` fails
+static int calibrate(int (*bench)(int)) {
+  int iterations = 1;
+
+  // the first run is not timed, as it also pays for
+  // the fixtures that benchmarks set up lazily
+  if (bench(iterations) == EXIT_FAILURE) {
+    return 0;
+  }
+
+  for (;;) {
+    const double start = clock_ns();
+    if (bench(iterations) == EXIT_FAILURE) {
+      return 0;
+    }
+
+    const double elapsed = clock_ns() - start;
+    if (elapsed >= BENCH_TARGET_NS || iterations >= BENCH_MAX_ITERATIONS) {
+      return iterations;
+    }
+
+    // grow towards the target, at least by two and at most
+    // by a hundred, as the first runs are the least accurate
+    double factor = elapsed > 0 ? 1.2 * BENCH_TARGET_NS / elapsed : 100;
+    factor = std::max(2.0, std::min(100.0, factor));
+    iterations = static_cast<int>(std::min(
+        static_cast<double>(BENCH_MAX_ITERATIONS), iterations * factor));
+  }
+}
+
+void bench_run(test_ctx_t *ctx, const char *name, int (*bench)(int)) {
+  bench_run_bytes(ctx, name, bench, 0);
+}
+
+void bench_run_bytes(test_ctx_t *ctx, const char *name,
+                     int (*bench)(int), size_t bytes) {
+  if (ctx->bench_expr == NULL ||
+      ctx->bench_expr[0] == '\0' ||
+      strstr(name, ctx->bench_expr) == NULL) {
+    return;
+  }
+
+  const int iterations = calibrate(bench);
+  if (iterations == 0) {
+    fprintf(stderr, "benchmark %s failed\n", name);
+    ctx->failure++;
+    return;
+  }
+
+  for (int i = 0; i < BENCH_WARMUP; i++) {
+    bench(iterations);
+  }
+
+  const int repetitions = ctx->bench_repetitions;
+  std::vector<double> ns(repetitions);
+  std::vector<double> cycle(repetitions);
+  std::vector<double> instructions(repetitions);
+  std::vector<double> misses(repetitions);
+  Counters counters;
+
+  for (int i = 0; i < repetitions; i++) {
+    counters.start();
+    const uint64_t start_cycles = cycles();
+    const double start = clock_ns();
+    const int result = bench(iterations);
+    const double end = clock_ns();
+    const uint64_t end_cycles = cycles();
+    counters.stop(&instructions[i], &misses[i]);
+
+    if (result == EXIT_FAILURE) {
+      fprintf(stderr, "benchmark %s failed\n", name);
+      ctx->failure++;
+      return;
+    }
+
+    ns[i] = (end - start) / iterations;
+    cycle[i] = static_cast<double>(end_cycles - start_cycles) / iterations;
+    instructions[i] = instructions[i] < 0 ? -1 : instructions[i] / iterations;
+    misses[i] = misses[i] < 0 ? -1 : misses[i] / iterations;
+  }
+
+  // the counters are reported as their median
+  // over the repetitions
+  BenchStats stats;
+  BenchResult result;
+  result.name = name;
+  result.iterations = iterations;
+  result.repetitions = repetitions;
+  result.bytes = static_cast<double>(bytes);
+  bench_stats(ns.data(), ns.size(), &result.ns);
+  bench_stats(cycle.data(), cycle.size(), &stats);
+  result.cycles = stats.median > 0 ? stats.median : -1;
+  bench_stats(instructions.data(), instructions.size(), &stats);
+  result.instructions = stats.median;
+  bench_stats(misses.data(), misses.size(), &stats);
+  result.cache_misses = stats.median;
+
+  bench_report(stdout, ctx->bench_format, result, ctx->bench_count == 0);
+  ctx->bench_count++;
+}
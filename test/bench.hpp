@@ -0,0 +1,57 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef TEST_BENCH_H_
+#define TEST_BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// BenchFormat selects how the results of the benchmarks are
+/// reported. csv prints a header before the first result and
+/// json prints one object per line
+enum class BenchFormat {
+  text,
+  csv,
+  json
+};
+
+/// BenchStats are the statistics of the time per
+/// operation over the repetitions of a benchmark
+struct BenchStats {
+  double min;
+  double median;
+  double p99;
+  double mean;
+  double stddev;
+};
+
+/// BenchResult is the result of a benchmark. All the values are
+/// per operation. The counters that are not available are negative,
+/// and `bytes` is 0 for benchmarks that do not move bytes, which
+/// then do not report a throughput
+struct BenchResult {
+  const char *name;
+  int iterations;
+  int repetitions;
+  BenchStats ns;
+  double bytes;
+  double cycles;
+  double instructions;
+  double cache_misses;
+};
+
+/// bench_stats computes the statistics of the `n`
+/// samples, which are sorted in place
+void bench_stats(double *samples, size_t n, BenchStats *stats);
+
+/// bench_parse_format parses the name of a format, and
+/// returns false if there is no such format
+bool bench_parse_format(const char *name, BenchFormat *format);
+
+/// bench_report writes `result` to `out`. `first` is
+/// true for the first result reported by the program
+void bench_report(FILE *out, BenchFormat format,
+                  const BenchResult &result, bool first);
+
+#endif  // TEST_BENCH_H_
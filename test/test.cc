@@ -3,12 +3,15 @@
 #include "test.hpp"
 
 void test_print_help(const char *prog) {
-  printf("usage: %s [-v] [-h] [-t]\n", prog);
+  printf("usage: %s [-v] [-h] [-t expr] [-b expr] [-r n] [-f format]\n", prog);
   printf("\noptions:\n");
   printf("\t-v, --verbose: outputs information about tests run\n");
   printf("\t-h, --help: prints this menu\n");
   printf("\t-t, --test: expression to match against tests to run\n");
   printf("\t-b, --bench: expression to match against benchmarks to run\n");
+  printf("\t-r, --repetitions: number of repetitions of each benchmark\n");
+  printf("\t-f, --format: format of the benchmark results, "
+         "text, csv or json\n");
   printf("\n");
 }
 
@@ -34,6 +37,9 @@ int test_ctx_init(
   memset(ctx->test_expr, 0, 128);
   ctx->bench_expr = static_cast<char*>(malloc(128 * sizeof(char)));
   memset(ctx->bench_expr, 0, 128);
+  ctx->bench_repetitions = 15;
+  ctx->bench_format = BenchFormat::text;
+  ctx->bench_count = 0;
   ctx->failure = 0;
   ctx->success = 0;
   ctx->verbose = 0;
@@ -42,6 +48,8 @@ int test_ctx_init(
     static struct option long_options[] = {
       {"test", required_argument, 0, 't'},
       {"bench", required_argument, 0, 'b'},
+      {"repetitions", required_argument, 0, 'r'},
+      {"format", required_argument, 0, 'f'},
       {"verbose", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'},
       {0, 0, 0, 0}
@@ -49,7 +57,7 @@ int test_ctx_init(
 
     size_t len;
     int option_index = 0;
-    int c = getopt_long(argc, argv, "t:b:vh", long_options, &option_index);
+    int c = getopt_long(argc, argv, "t:b:r:f:vh", long_options, &option_index);
 
     if (c == -1) {
       break;
@@ -66,6 +74,19 @@ int test_ctx_init(
       strncpy(ctx->bench_expr, optarg, len);
       ctx->bench_expr[len] = '\0';
       break;
+    case 'r':
+      ctx->bench_repetitions = atoi(optarg);
+      if (ctx->bench_repetitions < 1) {
+        fprintf(stderr, "invalid number of repetitions %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'f':
+      if (!bench_parse_format(optarg, &ctx->bench_format)) {
+        fprintf(stderr, "invalid benchmark format %s\n", optarg);
+        return -1;
+      }
+      break;
     case 'v':
       ctx->verbose = 1;
       break;
@@ -9,9 +9,14 @@
 #include <string.h>
 #include <time.h>
 
+#include "bench.hpp"
+
 typedef struct test_ctx_s {
   char *test_expr;
   char *bench_expr;
+  int bench_repetitions;
+  BenchFormat bench_format;
+  int bench_count;
   int failure;
   int success;
   int verbose;
@@ -65,76 +70,20 @@ int test_ctx_init(
     return EXIT_SUCCESS;                   \
   }                                        \
 
+/// BENCH_RUN runs the benchmark `test` if its name contains the
+/// expression given with -b. `test` is called with a number of
+/// iterations to run, and returns EXIT_FAILURE if it fails
 #define BENCH_RUN(ctx, test) bench_run(&ctx, #test, test)
 
-static double clock_nns_time() {
-  struct timespec now;
-  clock_gettime(CLOCK_MONOTONIC, &now);
-  return (now.tv_sec * 1e9) + now.tv_nsec;
-}
-
-static int abs_between(double value, double lower, double upper) {
-  value = value < 0 ? -value : value;
-  return value > lower && value < upper;
-}
-
-void bench_run(test_ctx_t* ctx, const char* name, int (*bench)(int)) {
-  int incr = 4;
-  int max_iter = 1 << 24;
-  double max_error = 0.02;
-  double ops = 0;
-  int iter;
-  size_t maxlen = strlen(name) > strlen(ctx->bench_expr)
-    ? strlen(ctx->bench_expr) : strlen(name);
-
-  if (ctx->bench_expr == NULL ||
-      ctx->bench_expr[0] == '\0' ||
-      strncmp(name, ctx->bench_expr, maxlen) == 0) {
-    return;
-  }
-
-  for (iter = 1 << 10; iter < max_iter; iter <<= incr) {
-    double start = clock_nns_time();
-    bench(iter);
-    double end = clock_nns_time();
-    double total = end - start;
-    double curr = static_cast<double>(iter / total);
-    int acceptable = curr > 0 && ops > 0 &&
-      abs_between(curr / ops, 1 - max_error, 1);
-    ops = curr;
-    // repeat until the error obtained is acceptable
-    if (acceptable) {
-      break;
-    }
-  }
-
-  // when presenting the results try to present them in the time unit
-  // in which it is easier to understand it
-  int counter = 0;
-  for (; counter < 4 && ops < 1; counter++) {
-    ops *= 1000;
-  }
-
-  const char* unit = "ns";
-  switch (counter) {
-  case 0:
-    unit = "ns";
-    break;
-  case 1:
-    unit = "us";
-    break;
-  case 2:
-    unit = "ms";
-    break;
-  case 3:
-    unit = "s";
-    break;
-  default:
-    abort();
-  }
+/// BENCH_RUN_BYTES runs the benchmark `test` as BENCH_RUN, for a
+/// benchmark that moves `bytes` bytes per iteration, and reports its
+/// throughput as well
+#define BENCH_RUN_BYTES(ctx, test, bytes) \
+  bench_run_bytes(&ctx, #test, test, bytes)
 
-  printf("%s - %lf ops/%s - %d iter\n", name, ops, unit, iter);
-}
+void bench_run(test_ctx_t *ctx, const char *name, int (*bench)(int));
+void bench_run_bytes(test_ctx_t *ctx, const char *name,
+                     int (*bench)(int), size_t bytes);
 
 #define TEST_RUN(ctx, test)                                  \
   if (strlen((ctx).test_expr) == 0 ||                        \
@@ -2,6 +2,8 @@
 
 #include "test.hpp"
 
+#include <stdint.h>
+
 static int test_assert_true() {
   ASSERT_TRUE(true);
   ASSERT_FALSE(false);
@@ -11,11 +13,112 @@ static int test_assert_true() {
   return EXIT_SUCCESS;
 }
 
+static int test_bench_stats() {
+  double samples[] = {5, 1, 4, 2, 3};
+  BenchStats stats;
+
+  bench_stats(samples, 5, &stats);
+  ASSERT_EQ(stats.min, 1);
+  ASSERT_EQ(stats.median, 3);
+  ASSERT_EQ(stats.p99, 5);
+  ASSERT_EQ(stats.mean, 3);
+  ASSERT_TRUE(stats.stddev > 1.58 && stats.stddev < 1.59);
+  ASSERT_EQ(samples[0], 1);
+
+  bench_stats(samples, 4, &stats);
+  ASSERT_EQ(stats.median, 2.5);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_bench_parse_format() {
+  BenchFormat format = BenchFormat::text;
+
+  ASSERT_TRUE(bench_parse_format("json", &format));
+  ASSERT_TRUE(format == BenchFormat::json);
+  ASSERT_TRUE(bench_parse_format("csv", &format));
+  ASSERT_TRUE(format == BenchFormat::csv);
+  ASSERT_FALSE(bench_parse_format("xml", &format));
+  ASSERT_TRUE(format == BenchFormat::csv);
+
+  return EXIT_SUCCESS;
+}
+
+static int test_bench_report_bytes() {
+  const char *expected = "\"bytes\": 1024, \"mb_per_s\": 2048.000}\n";
+  BenchResult result;
+  char *report = nullptr;
+  size_t len = 0;
+
+  memset(&result, 0, sizeof(result));
+  result.name = "bench_bytes";
+  result.ns.median = 500;
+  result.bytes = 1024;
+  result.cycles = -1;
+  result.instructions = -1;
+  result.cache_misses = -1;
+
+  FILE *out = open_memstream(&report, &len);
+  ASSERT_TRUE(out != NULL);
+  bench_report(out, BenchFormat::json, result, true);
+  fclose(out);
+
+  const size_t expected_len = strlen(expected);
+  const bool found = len > expected_len &&
+      strcmp(report + len - expected_len, expected) == 0;
+  free(report);
+  ASSERT_TRUE(found);
+
+  return EXIT_SUCCESS;
+}
+
+static int bench_calls = 0;
+
+static int bench_count(int n) {
+  volatile uint64_t sum = 0;
+  for (int i = 0; i < n; i++) {
+    sum += static_cast<uint64_t>(i);
+  }
+
+  bench_calls++;
+  return EXIT_SUCCESS;
+}
+
+static int test_bench_run_filter() {
+  test_ctx_t ctx;
+  char expr[] = "count";
+  char empty[] = "";
+
+  ctx.bench_expr = empty;
+  ctx.bench_repetitions = 2;
+  ctx.bench_format = BenchFormat::text;
+  ctx.bench_count = 0;
+  ctx.failure = 0;
+
+  BENCH_RUN(ctx, bench_count);
+  ASSERT_EQ(bench_calls, 0);
+
+  ctx.bench_expr = expr;
+  bench_run(&ctx, "bench_other", bench_count);
+  ASSERT_EQ(bench_calls, 0);
+
+  BENCH_RUN(ctx, bench_count);
+  ASSERT_TRUE(bench_calls > 4);
+  ASSERT_EQ(ctx.bench_count, 1);
+  ASSERT_EQ(ctx.failure, 0);
+
+  return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
   test_ctx_t ctx;
   TEST_INIT(ctx, argc, argv);
 
   TEST_RUN(ctx, test_assert_true());
+  TEST_RUN(ctx, test_bench_stats());
+  TEST_RUN(ctx, test_bench_parse_format());
+  TEST_RUN(ctx, test_bench_report_bytes());
+  TEST_RUN(ctx, test_bench_run_filter());
 
   TEST_RELEASE(ctx);
   return EXIT_SUCCESS;
@@ -2,7 +2,6 @@
 
 #include "parser.hpp"
 
-#include <errno.h>
 #include <string.h>
 
 #include <algorithm>
@@ -21,6 +20,35 @@ const char Parser::kUInt32[] = "uint32";
 const char Parser::kUInt64[] = "uint64";
 const char Parser::kDuration[] = "duration";
 
+constexpr const char *ParseTraits<std::string>::type;
+constexpr const char *ParseTraits<bool>::type;
+constexpr const char *ParseTraits<int32_t>::type;
+constexpr const char *ParseTraits<uint32_t>::type;
+constexpr const char *ParseTraits<int64_t>::type;
+constexpr const char *ParseTraits<uint64_t>::type;
+constexpr const char *ParseTraits<std::chrono::nanoseconds>::type;
+
+const char *AnyParser::type() const noexcept {
+  switch (m_kind) {
+    case Kind::charray:
+    case Kind::string:
+      return Parser::kString;
+    case Kind::boolean:
+      return Parser::kBool;
+    case Kind::int32:
+      return Parser::kInt32;
+    case Kind::uint32:
+      return Parser::kUInt32;
+    case Kind::int64:
+      return Parser::kInt64;
+    case Kind::uint64:
+      return Parser::kUInt64;
+    case Kind::duration:
+      return Parser::kDuration;
+    default:
+      return nullptr;
+  }
+}
 
 Parser Parser::string_parser(char *ptr, size_t len) noexcept {
   return Parser(ptr, len, true, parse_func_charray);
@@ -138,144 +166,169 @@ bool parse_bool(bool *value, const char *s, size_t len) noexcept {
   }
 }
 
-bool parse_int32(int32_t *value, const char *s, size_t len) noexcept {
-  const char *endptr = nullptr;
-  int64_t parsed = strntol(s, len, &endptr, 10);
+/// only_blanks returns true if there are only blanks in [c, end)
+static inline bool only_blanks(const char *c, const char *end) {
+  return string_skip_blank(c, end - c) == end;
+}
 
-  if (errno ||
-      (static_cast<size_t>(endptr - s + 1) < len
-       && !isspace(*endptr))) {
-    return false;
+/// parse_signed parses a decimal number followed only by blanks, and
+/// checks that it is within [min, max]. Blank input parses as 0
+static bool parse_signed(int64_t *value,
+                         const char *s,
+                         size_t len,
+                         int64_t min,
+                         int64_t max) {
+  const char *endptr;
+  int64_t parsed;
 
-  } else if (parsed > INT32_MAX) {
-    return false;
+  switch (string_to_int64(s, len, &parsed, &endptr)) {
+    case NumError::none:
+      break;
 
-  } else if (parsed < INT32_MIN) {
-    return false;
+    case NumError::no_digits:
+      parsed = 0;
+      if (!only_blanks(s, s + len)) {
+        return false;
+      }
+      break;
 
-  } else {
-    *value = static_cast<int32_t>(parsed);
-    return true;
+    case NumError::range:
+      return false;
   }
-}
-
-bool parse_int64(int64_t *value, const char *s, size_t len) noexcept {
-  const char *endptr = nullptr;
-  int64_t parsed = strntol(s, len, &endptr, 10);
 
-  if (errno ||
-      (static_cast<size_t>(endptr - s + 1) < len
-       && !isspace(*endptr))) {
+  if (!only_blanks(endptr, s + len) || parsed < min || parsed > max) {
     return false;
+  }
 
-  } else if (parsed > INT64_MAX) {
-    return false;
+  *value = parsed;
+  return true;
+}
 
-  } else if (parsed < INT64_MIN) {
-    return false;
+/// parse_unsigned is the unsigned version of parse_signed
+static bool parse_unsigned(uint64_t *value,
+                           const char *s,
+                           size_t len,
+                           uint64_t max) {
+  const char *endptr;
+  uint64_t parsed;
+
+  switch (string_to_uint64(s, len, &parsed, &endptr)) {
+    case NumError::none:
+      break;
+
+    case NumError::no_digits:
+      parsed = 0;
+      if (!only_blanks(s, s + len)) {
+        return false;
+      }
+      break;
 
-  } else {
-    *value = static_cast<int64_t>(parsed);
-    return true;
+    case NumError::range:
+      return false;
   }
+
+  if (!only_blanks(endptr, s + len) || parsed > max) {
+    return false;
+  }
+
+  *value = parsed;
+  return true;
 }
 
-bool parse_uint32(uint32_t *value, const char *s, size_t len) noexcept {
-  const char *endptr = nullptr;
-  uint64_t parsed = strntoul(s, len, &endptr, 10);
+bool parse_int32(int32_t *value, const char *s, size_t len) noexcept {
+  int64_t parsed;
 
-  if (errno ||
-      (static_cast<size_t>(endptr - s + 1) < len
-       && !isspace(*endptr))) {
+  if (!parse_signed(&parsed, s, len, INT32_MIN, INT32_MAX)) {
     return false;
+  }
 
-  } else if (parsed > UINT32_MAX) {
-    return false;
+  *value = static_cast<int32_t>(parsed);
+  return true;
+}
 
-  } else {
-    *value = static_cast<int64_t>(parsed);
-    return true;
-  }
+bool parse_int64(int64_t *value, const char *s, size_t len) noexcept {
+  return parse_signed(value, s, len, INT64_MIN, INT64_MAX);
 }
 
-bool parse_uint64(uint64_t *value, const char *s, size_t len) noexcept {
-  const char *endptr = nullptr;
-  uint64_t parsed = strntoul(s, len, &endptr, 10);
+bool parse_uint32(uint32_t *value, const char *s, size_t len) noexcept {
+  uint64_t parsed;
 
-  if (errno ||
-      (static_cast<size_t>(endptr - s + 1) < len
-       && !isspace(*endptr))) {
+  if (!parse_unsigned(&parsed, s, len, UINT32_MAX)) {
     return false;
+  }
 
-  } else if (parsed > UINT64_MAX) {
-    return false;
+  *value = static_cast<uint32_t>(parsed);
+  return true;
+}
 
-  } else {
-    *value = static_cast<int64_t>(parsed);
-    return true;
-  }
+bool parse_uint64(uint64_t *value, const char *s, size_t len) noexcept {
+  return parse_unsigned(value, s, len, UINT64_MAX);
 }
 
 bool parse_duration(std::chrono::nanoseconds *value,
                     const char *s,
                     size_t len) noexcept {
   const char *endptr = nullptr;
-  uint64_t parsed = strntoul(s, len, &endptr, 10);
-  size_t pending = len - (endptr - s + 1);
+  const char *end = s + len;
+  uint64_t parsed;
   uint64_t factor = 0;
 
-  if (errno) {
+  if (string_to_uint64(s, len, &parsed, &endptr) != NumError::none ||
+      endptr == end) {
     return false;
+  }
 
-  } else if (parsed > UINT64_MAX) {
-    return false;
+  size_t pending = end - endptr - 1;
 
-  } else {
-    switch (*endptr) {
-      case 'h':
-        if (pending == 0) {
-          factor = 3600 * (1e9);
-        } else {
-          return false;
-        }
-        break;
-      case 'm':
-        if (pending == 0) {
-          factor = 60 * (1e9);
-        } else if (pending == 1 && *(endptr + 1) == 's') {
-          factor = 1e6;
-        } else {
-          return false;
-        }
-        break;
-      case 's':
-        if (pending == 0) {
-          factor = 1e9;
-        } else {
-          return false;
-        }
-        break;
-      case 'u':
-        if (pending == 1 && *(endptr + 1) == 's') {
-          factor = 1e3;
-        } else {
-          return false;
-        }
-        break;
-      case 'n':
-        if (pending == 1 && *(endptr + 1) == 's') {
-          factor = 1;
-        } else {
-          return false;
-        }
-        break;
-      default:
+  switch (*endptr) {
+    case 'h':
+      if (pending == 0) {
+        factor = 3600 * 1000000000ULL;
+      } else {
+        return false;
+      }
+      break;
+    case 'm':
+      if (pending == 0) {
+        factor = 60 * 1000000000ULL;
+      } else if (pending == 1 && *(endptr + 1) == 's') {
+        factor = 1000000ULL;
+      } else {
         return false;
-    }
+      }
+      break;
+    case 's':
+      if (pending == 0) {
+        factor = 1000000000ULL;
+      } else {
+        return false;
+      }
+      break;
+    case 'u':
+      if (pending == 1 && *(endptr + 1) == 's') {
+        factor = 1000ULL;
+      } else {
+        return false;
+      }
+      break;
+    case 'n':
+      if (pending == 1 && *(endptr + 1) == 's') {
+        factor = 1;
+      } else {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
 
-    *value = std::chrono::nanoseconds(parsed * factor);
-    return true;
+  uint64_t nanos;
+  if (__builtin_mul_overflow(parsed, factor, &nanos) || nanos > INT64_MAX) {
+    return false;
   }
+
+  *value = std::chrono::nanoseconds(nanos);
+  return true;
 }
 
 bool parse_string(std::string *value,
@@ -138,5 +138,249 @@ bool parse_duration(std::chrono::nanoseconds *value,
                     const char *s,
                     size_t len) noexcept;
 
+/// ParseTraits resolves at compile time how a value of type T is
+/// parsed, along with the name of the type and whether it expects
+/// an argument when used as a flag
+template <typename T>
+struct ParseTraits;
+
+template <>
+struct ParseTraits<std::string> {
+  static constexpr const char *type = Parser::kString;
+  static constexpr bool expects_arg = true;
+  static inline bool parse(std::string *value, const char *s, size_t len) {
+    return parse_string(value, s, len);
+  }
+};
+
+template <>
+struct ParseTraits<bool> {
+  static constexpr const char *type = Parser::kBool;
+  static constexpr bool expects_arg = false;
+  static inline bool parse(bool *value, const char *s, size_t len) {
+    return parse_bool(value, s, len);
+  }
+};
+
+template <>
+struct ParseTraits<int32_t> {
+  static constexpr const char *type = Parser::kInt32;
+  static constexpr bool expects_arg = true;
+  static inline bool parse(int32_t *value, const char *s, size_t len) {
+    return parse_int32(value, s, len);
+  }
+};
+
+template <>
+struct ParseTraits<uint32_t> {
+  static constexpr const char *type = Parser::kUInt32;
+  static constexpr bool expects_arg = true;
+  static inline bool parse(uint32_t *value, const char *s, size_t len) {
+    return parse_uint32(value, s, len);
+  }
+};
+
+template <>
+struct ParseTraits<int64_t> {
+  static constexpr const char *type = Parser::kInt64;
+  static constexpr bool expects_arg = true;
+  static inline bool parse(int64_t *value, const char *s, size_t len) {
+    return parse_int64(value, s, len);
+  }
+};
+
+template <>
+struct ParseTraits<uint64_t> {
+  static constexpr const char *type = Parser::kUInt64;
+  static constexpr bool expects_arg = true;
+  static inline bool parse(uint64_t *value, const char *s, size_t len) {
+    return parse_uint64(value, s, len);
+  }
+};
+
+template <>
+struct ParseTraits<std::chrono::nanoseconds> {
+  static constexpr const char *type = Parser::kDuration;
+  static constexpr bool expects_arg = true;
+  static inline bool parse(std::chrono::nanoseconds *value,
+                           const char *s,
+                           size_t len) {
+    return parse_duration(value, s, len);
+  }
+};
+
+/// TypedParser parses values into a variable of type T. Unlike
+/// Parser, the parse function is resolved at compile time, so
+/// calls to `set` can be inlined
+template <typename T>
+class TypedParser final {
+ public:
+  explicit TypedParser(T *ptr) noexcept:
+      m_ptr(ptr) { }
+
+  inline bool set(const char *s, size_t size) const noexcept {
+    return ParseTraits<T>::parse(m_ptr, s, size);
+  }
+
+  inline T *get() const noexcept {
+    return m_ptr;
+  }
+
+  static constexpr bool expects_arg() noexcept {
+    return ParseTraits<T>::expects_arg;
+  }
+
+  static constexpr const char *type() noexcept {
+    return ParseTraits<T>::type;
+  }
+
+ private:
+  T *m_ptr;
+};
+
+/// CharArrayParser parses values into a char array of `len` bytes
+class CharArrayParser final {
+ public:
+  CharArrayParser(char *ptr, size_t len) noexcept:
+      m_ptr(ptr),
+      m_len(len) { }
+
+  inline bool set(const char *s, size_t size) const noexcept {
+    return parse_charray(m_ptr, m_len, s, size);
+  }
+
+  inline char *get() const noexcept {
+    return m_ptr;
+  }
+
+  inline size_t len() const noexcept {
+    return m_len;
+  }
+
+ private:
+  char *m_ptr;
+  size_t m_len;
+};
+
+/// AnyParser holds any of the typed parsers, tagged with the type
+/// it parses. It takes the place of Parser where parsers of
+/// different types are kept together, and dispatches with a switch
+/// on its tag rather than through a std::function
+class AnyParser final {
+ public:
+  AnyParser() noexcept:
+      m_kind(Kind::none),
+      m_len(0) {
+    m_ptr = nullptr;
+  }
+
+  AnyParser(CharArrayParser parser) noexcept:  // NOLINT(runtime/explicit)
+      m_kind(Kind::charray),
+      m_len(parser.len()) {
+    m_charray = parser.get();
+  }
+
+  AnyParser(TypedParser<std::string> parser) noexcept:  // NOLINT
+      m_kind(Kind::string),
+      m_len(0) {
+    m_string = parser.get();
+  }
+
+  AnyParser(TypedParser<bool> parser) noexcept:  // NOLINT
+      m_kind(Kind::boolean),
+      m_len(0) {
+    m_bool = parser.get();
+  }
+
+  AnyParser(TypedParser<int32_t> parser) noexcept:  // NOLINT
+      m_kind(Kind::int32),
+      m_len(0) {
+    m_int32 = parser.get();
+  }
+
+  AnyParser(TypedParser<uint32_t> parser) noexcept:  // NOLINT
+      m_kind(Kind::uint32),
+      m_len(0) {
+    m_uint32 = parser.get();
+  }
+
+  AnyParser(TypedParser<int64_t> parser) noexcept:  // NOLINT
+      m_kind(Kind::int64),
+      m_len(0) {
+    m_int64 = parser.get();
+  }
+
+  AnyParser(TypedParser<uint64_t> parser) noexcept:  // NOLINT
+      m_kind(Kind::uint64),
+      m_len(0) {
+    m_uint64 = parser.get();
+  }
+
+  AnyParser(TypedParser<std::chrono::nanoseconds> parser) noexcept:  // NOLINT
+      m_kind(Kind::duration),
+      m_len(0) {
+    m_duration = parser.get();
+  }
+
+  inline bool set(const char *s, size_t size) const noexcept {
+    switch (m_kind) {
+      case Kind::charray:
+        return parse_charray(m_charray, m_len, s, size);
+      case Kind::string:
+        return TypedParser<std::string>(m_string).set(s, size);
+      case Kind::boolean:
+        return TypedParser<bool>(m_bool).set(s, size);
+      case Kind::int32:
+        return TypedParser<int32_t>(m_int32).set(s, size);
+      case Kind::uint32:
+        return TypedParser<uint32_t>(m_uint32).set(s, size);
+      case Kind::int64:
+        return TypedParser<int64_t>(m_int64).set(s, size);
+      case Kind::uint64:
+        return TypedParser<uint64_t>(m_uint64).set(s, size);
+      case Kind::duration:
+        return TypedParser<std::chrono::nanoseconds>(m_duration).set(s, size);
+      default:
+        return false;
+    }
+  }
+
+  inline void *get() const noexcept {
+    return m_ptr;
+  }
+
+  inline bool expects_arg() const noexcept {
+    return m_kind != Kind::boolean;
+  }
+
+  const char *type() const noexcept;
+
+ private:
+  enum class Kind : uint8_t {
+    none,
+    charray,
+    string,
+    boolean,
+    int32,
+    uint32,
+    int64,
+    uint64,
+    duration
+  };
+
+  Kind m_kind;
+  size_t m_len;
+  union {
+    void *m_ptr;
+    char *m_charray;
+    std::string *m_string;
+    bool *m_bool;
+    int32_t *m_int32;
+    uint32_t *m_uint32;
+    int64_t *m_int64;
+    uint64_t *m_uint64;
+    std::chrono::nanoseconds *m_duration;
+  };
+};
 
 #endif  // VALUE_PARSER_H_
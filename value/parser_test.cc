@@ -2,6 +2,8 @@
 
 #include "test/test.hpp"
 
+#include <errno.h>
+
 #include "parser.hpp"
 
 static int test_parse_bool() {
@@ -63,6 +65,19 @@ static int test_parse_int64() {
   ASSERT_TRUE(parse_int64(&value, "123456789987654321", 18));
   ASSERT_EQ(value, 123456789987654321);
 
+  ASSERT_TRUE(parse_int64(&value, " -42 ", 5));
+  ASSERT_EQ(value, -42);
+
+  ASSERT_FALSE(parse_int64(&value, "12a", 3));
+  ASSERT_FALSE(parse_int64(&value, "a", 1));
+  ASSERT_FALSE(parse_int64(&value, "-", 1));
+  ASSERT_FALSE(parse_int64(&value, "9223372036854775808", 19));
+
+  // a failure left in errno by someone else does not matter
+  errno = ERANGE;
+  ASSERT_TRUE(parse_int64(&value, "7", 1));
+  ASSERT_EQ(value, 7);
+
   return EXIT_SUCCESS;
 }
 
@@ -133,6 +148,41 @@ static int test_parse_duration() {
   ASSERT_FALSE(parse_duration(&value, "uu", 2));
   ASSERT_FALSE(parse_duration(&value, "nu", 2));
   ASSERT_FALSE(parse_duration(&value, "", 0));
+  ASSERT_FALSE(parse_duration(&value, "1", 1));
+  ASSERT_FALSE(parse_duration(&value, "10000000000000h", 15));
+
+  return EXIT_SUCCESS;
+}
+
+static int test_typed_parser() {
+  int32_t number = 0;
+  std::chrono::nanoseconds duration;
+  char name[8];
+
+  TypedParser<int32_t> parser(&number);
+  ASSERT_TRUE(parser.set("42", 2));
+  ASSERT_EQ(number, 42);
+  ASSERT_TRUE(TypedParser<int32_t>::expects_arg());
+  ASSERT_FALSE(TypedParser<bool>::expects_arg());
+
+  AnyParser parsers[] = {
+    TypedParser<int32_t>(&number),
+    TypedParser<std::chrono::nanoseconds>(&duration),
+    CharArrayParser(name, sizeof(name))
+  };
+
+  ASSERT_TRUE(parsers[0].set("-7", 2));
+  ASSERT_EQ(number, -7);
+  ASSERT_TRUE(parsers[1].set("3ms", 3));
+  ASSERT_EQ(duration.count(), 3000000);
+  ASSERT_TRUE(parsers[2].set("abc", 3));
+  ASSERT_MEM_EQ(name, "abc", 4);
+  ASSERT_FALSE(parsers[2].set("too long", 8));
+
+  ASSERT_TRUE(parsers[0].get() == &number);
+  ASSERT_EQ(strcmp(parsers[1].type(), Parser::kDuration), 0);
+  ASSERT_FALSE(AnyParser().set("1", 1));
+  ASSERT_TRUE(sizeof(AnyParser) < sizeof(Parser));
 
   return EXIT_SUCCESS;
 }
@@ -147,6 +197,7 @@ int main(int argc, char *argv[]) {
   TEST_RUN(ctx, test_parse_uint32());
   TEST_RUN(ctx, test_parse_uint64());
   TEST_RUN(ctx, test_parse_duration());
+  TEST_RUN(ctx, test_typed_parser());
 
   TEST_RELEASE(ctx);
 
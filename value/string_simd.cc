@@ -0,0 +1,432 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#include "string_simd.hpp"
+
+#include <stdint.h>
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRING_SIMD_X86
+#endif
+
+/// Kernels are the implementations of the string
+/// functions for a single SimdLevel
+struct Kernels final {
+  SimdLevel level;
+  const char *(*find_char)(const char*, const char*, char);
+  const char *(*find_any)(const char*, const char*, const char*, size_t);
+  const char *(*skip_blank)(const char*, const char*);
+  const char *(*skip_non_blank)(const char*, const char*);
+  bool (*case_equals)(const char*, const char*, size_t);
+};
+
+static inline bool is_blank(char c) {
+  return c == ' ' || static_cast<uint8_t>(c - '\t') <= '\r' - '\t';
+}
+
+static inline char to_lower(char c) {
+  return static_cast<uint8_t>(c - 'A') <= 'Z' - 'A' ? c | 0x20 : c;
+}
+
+static const char *find_char_scalar(const char *c,
+                                    const char *end,
+                                    char ch) {
+  while (c < end && *c != ch) {
+    c++;
+  }
+
+  return c;
+}
+
+static const char *find_any_scalar(const char *c,
+                                   const char *end,
+                                   const char *set,
+                                   size_t nset) {
+  if (nset > SIMD_MAX_SET) {
+    bool table[256] = {false};
+    for (size_t i = 0; i < nset; i++) {
+      table[static_cast<uint8_t>(set[i])] = true;
+    }
+
+    while (c < end && !table[static_cast<uint8_t>(*c)]) {
+      c++;
+    }
+
+    return c;
+  }
+
+  for (; c < end; c++) {
+    for (size_t i = 0; i < nset; i++) {
+      if (*c == set[i]) {
+        return c;
+      }
+    }
+  }
+
+  return end;
+}
+
+static const char *skip_blank_scalar(const char *c, const char *end) {
+  while (c < end && is_blank(*c)) {
+    c++;
+  }
+
+  return c;
+}
+
+static const char *skip_non_blank_scalar(const char *c, const char *end) {
+  while (c < end && !is_blank(*c)) {
+    c++;
+  }
+
+  return c;
+}
+
+static bool case_equals_scalar(const char *a, const char *b, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (to_lower(a[i]) != to_lower(b[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#ifdef STRING_SIMD_X86
+/// blanks_sse2 returns the mask of the ASCII blank bytes of `v`. The
+/// blanks other than space are contiguous from \t to \r, so they
+/// are found with a single unsigned comparison
+__attribute__((target("sse2")))
+static inline int blanks_sse2(__m128i v) {
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i range = _mm_set1_epi8('\r' - '\t');
+  __m128i shifted = _mm_sub_epi8(v, tab);
+  __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range), shifted);
+  return _mm_movemask_epi8(_mm_or_si128(controls, _mm_cmpeq_epi8(v, space)));
+}
+
+/// lower_sse2 turns the ASCII upper case letters of `v` to lower case
+__attribute__((target("sse2")))
+static inline __m128i lower_sse2(__m128i v) {
+  const __m128i a = _mm_set1_epi8('A');
+  const __m128i range = _mm_set1_epi8('Z' - 'A');
+  const __m128i bit = _mm_set1_epi8(0x20);
+  __m128i shifted = _mm_sub_epi8(v, a);
+  __m128i upper = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range), shifted);
+  return _mm_or_si128(v, _mm_and_si128(upper, bit));
+}
+
+__attribute__((target("sse2")))
+static const char *skip_blank_sse2(const char *c, const char *end) {
+  while (end - c >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+    int mask = ~blanks_sse2(v) & 0xffff;
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 16;
+  }
+
+  return skip_blank_scalar(c, end);
+}
+
+__attribute__((target("sse2")))
+static const char *skip_non_blank_sse2(const char *c, const char *end) {
+  while (end - c >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+    int mask = blanks_sse2(v);
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 16;
+  }
+
+  return skip_non_blank_scalar(c, end);
+}
+
+__attribute__((target("sse2")))
+static bool case_equals_sse2(const char *a, const char *b, size_t len) {
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    __m128i eq = _mm_cmpeq_epi8(lower_sse2(va), lower_sse2(vb));
+    if (_mm_movemask_epi8(eq) != 0xffff) {
+      return false;
+    }
+  }
+
+  return case_equals_scalar(a + i, b + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static const char *find_char_sse2(const char *c,
+                                  const char *end,
+                                  char ch) {
+  const __m128i needle = _mm_set1_epi8(ch);
+
+  while (end - c >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 16;
+  }
+
+  return find_char_scalar(c, end, ch);
+}
+
+__attribute__((target("sse2")))
+static const char *find_any_sse2(const char *c,
+                                 const char *end,
+                                 const char *set,
+                                 size_t nset) {
+  if (nset > SIMD_MAX_SET) {
+    return find_any_scalar(c, end, set, nset);
+  }
+
+  __m128i needles[SIMD_MAX_SET];
+  for (size_t i = 0; i < nset; i++) {
+    needles[i] = _mm_set1_epi8(set[i]);
+  }
+
+  while (end - c >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+    __m128i matches = _mm_setzero_si128();
+    for (size_t i = 0; i < nset; i++) {
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(v, needles[i]));
+    }
+
+    int mask = _mm_movemask_epi8(matches);
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 16;
+  }
+
+  return find_any_scalar(c, end, set, nset);
+}
+
+__attribute__((target("avx2")))
+static const char *find_char_avx2(const char *c,
+                                  const char *end,
+                                  char ch) {
+  const __m256i needle = _mm256_set1_epi8(ch);
+
+  // two vectors per iteration, so that the loop is
+  // bound by the loads rather than by the branches
+  while (end - c >= 64) {
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + 32));
+    __m256i m0 = _mm256_cmpeq_epi8(v0, needle);
+    __m256i m1 = _mm256_cmpeq_epi8(v1, needle);
+
+    if (!_mm256_testz_si256(_mm256_or_si256(m0, m1),
+                            _mm256_or_si256(m0, m1))) {
+      uint32_t mask = _mm256_movemask_epi8(m0);
+      if (mask != 0) {
+        return c + __builtin_ctz(mask);
+      }
+
+      return c + 32 + __builtin_ctz(_mm256_movemask_epi8(m1));
+    }
+
+    c += 64;
+  }
+
+  while (end - c >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle));
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 32;
+  }
+
+  return find_char_sse2(c, end, ch);
+}
+
+__attribute__((target("avx2")))
+static const char *find_any_avx2(const char *c,
+                                 const char *end,
+                                 const char *set,
+                                 size_t nset) {
+  if (nset > SIMD_MAX_SET) {
+    return find_any_scalar(c, end, set, nset);
+  }
+
+  __m256i needles[SIMD_MAX_SET];
+  for (size_t i = 0; i < nset; i++) {
+    needles[i] = _mm256_set1_epi8(set[i]);
+  }
+
+  while (end - c >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+    __m256i matches = _mm256_setzero_si256();
+    for (size_t i = 0; i < nset; i++) {
+      matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(v, needles[i]));
+    }
+
+    uint32_t mask = _mm256_movemask_epi8(matches);
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 32;
+  }
+
+  return find_any_sse2(c, end, set, nset);
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t blanks_avx2(__m256i v) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i range = _mm256_set1_epi8('\r' - '\t');
+  __m256i shifted = _mm256_sub_epi8(v, tab);
+  __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, range),
+                                       shifted);
+  return _mm256_movemask_epi8(
+      _mm256_or_si256(controls, _mm256_cmpeq_epi8(v, space)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lower_avx2(__m256i v) {
+  const __m256i a = _mm256_set1_epi8('A');
+  const __m256i range = _mm256_set1_epi8('Z' - 'A');
+  const __m256i bit = _mm256_set1_epi8(0x20);
+  __m256i shifted = _mm256_sub_epi8(v, a);
+  __m256i upper = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, range), shifted);
+  return _mm256_or_si256(v, _mm256_and_si256(upper, bit));
+}
+
+__attribute__((target("avx2")))
+static const char *skip_blank_avx2(const char *c, const char *end) {
+  while (end - c >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+    uint32_t mask = ~blanks_avx2(v);
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 32;
+  }
+
+  return skip_blank_sse2(c, end);
+}
+
+__attribute__((target("avx2")))
+static const char *skip_non_blank_avx2(const char *c, const char *end) {
+  while (end - c >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+    uint32_t mask = blanks_avx2(v);
+    if (mask != 0) {
+      return c + __builtin_ctz(mask);
+    }
+
+    c += 32;
+  }
+
+  return skip_non_blank_sse2(c, end);
+}
+
+__attribute__((target("avx2")))
+static bool case_equals_avx2(const char *a, const char *b, size_t len) {
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i eq = _mm256_cmpeq_epi8(lower_avx2(va), lower_avx2(vb));
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(eq)) != 0xffffffff) {
+      return false;
+    }
+  }
+
+  return case_equals_sse2(a + i, b + i, len - i);
+}
+#endif
+
+static const Kernels kScalar = {
+  SimdLevel::scalar, find_char_scalar, find_any_scalar,
+  skip_blank_scalar, skip_non_blank_scalar, case_equals_scalar
+};
+
+#ifdef STRING_SIMD_X86
+static const Kernels kSse2 = {
+  SimdLevel::sse2, find_char_sse2, find_any_sse2,
+  skip_blank_sse2, skip_non_blank_sse2, case_equals_sse2
+};
+
+static const Kernels kAvx2 = {
+  SimdLevel::avx2, find_char_avx2, find_any_avx2,
+  skip_blank_avx2, skip_non_blank_avx2, case_equals_avx2
+};
+#endif
+
+static const Kernels *resolve(SimdLevel level) {
+#ifdef STRING_SIMD_X86
+  __builtin_cpu_init();
+  if (level >= SimdLevel::avx2 && __builtin_cpu_supports("avx2")) {
+    return &kAvx2;
+  }
+
+  if (level >= SimdLevel::sse2 && __builtin_cpu_supports("sse2")) {
+    return &kSse2;
+  }
+#else
+  (void)(level);
+#endif
+
+  return &kScalar;
+}
+
+static std::atomic<const Kernels*> &kernels_ref() {
+  static std::atomic<const Kernels*> kernels(resolve(SimdLevel::avx2));
+  return kernels;
+}
+
+static inline const Kernels *kernels() {
+  return kernels_ref().load(std::memory_order_relaxed);
+}
+
+SimdLevel simd_level() noexcept {
+  return kernels()->level;
+}
+
+SimdLevel simd_set_level(SimdLevel level) noexcept {
+  const Kernels *kernels = resolve(level);
+  kernels_ref().store(kernels, std::memory_order_relaxed);
+  return kernels->level;
+}
+
+const char *simd_find_char(const char *c, const char *end, char ch) noexcept {
+  return kernels()->find_char(c, end, ch);
+}
+
+const char *simd_find_any(const char *c, const char *end,
+                          const char *set, size_t nset) noexcept {
+  return kernels()->find_any(c, end, set, nset);
+}
+
+const char *simd_skip_blank(const char *c, const char *end) noexcept {
+  return kernels()->skip_blank(c, end);
+}
+
+const char *simd_skip_non_blank(const char *c, const char *end) noexcept {
+  return kernels()->skip_non_blank(c, end);
+}
+
+bool simd_case_equals(const char *a, const char *b, size_t len) noexcept {
+  return kernels()->case_equals(a, b, len);
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2019, tlblanc <tlblanc1490 at gmail dot com>
+
+#ifndef VALUE_STRINGSIMD_H_
+#define VALUE_STRINGSIMD_H_
+
+#include <stddef.h>
+
+/// SimdLevel is the instruction set used by the vectorized
+/// string functions. The best level supported by the cpu
+/// is picked the first time any of them is called
+enum class SimdLevel {
+  scalar,
+  sse2,
+  avx2
+};
+
+/// SIMD_MAX_SET is the largest set of bytes that
+/// simd_find_any searches with vector instructions
+static constexpr size_t SIMD_MAX_SET = 16;
+
+/// simd_level returns the level in use
+SimdLevel simd_level() noexcept;
+
+/// simd_set_level makes the functions use `level`, or the best
+/// level supported by the cpu if it does not support `level`.
+/// It returns the level in use, and is meant for tests and
+/// benchmarks that compare levels
+SimdLevel simd_set_level(SimdLevel level) noexcept;
+
+/// simd_find_char returns the first occurrence of `ch`
+/// in [c, end), or `end` if there is none
+const char *simd_find_char(const char *c, const char *end, char ch) noexcept;
+
+/// simd_find_any returns the first occurrence of any of the `nset`
+/// bytes of `set` in [c, end), or `end` if there is none
+const char *simd_find_any(const char *c, const char *end,
+                          const char *set, size_t nset) noexcept;
+
+/// simd_skip_blank returns the first byte in [c, end) that is not
+/// ASCII blank (space, \t, \n, \v, \f or \r), or `end` if there is none
+const char *simd_skip_blank(const char *c, const char *end) noexcept;
+
+/// simd_skip_non_blank returns the first ASCII blank
+/// byte in [c, end), or `end` if there is none
+const char *simd_skip_non_blank(const char *c, const char *end) noexcept;
+
+/// simd_case_equals returns true if the `len` bytes of `a` and `b`
+/// are equal ignoring the case of the ASCII letters
+bool simd_case_equals(const char *a, const char *b, size_t len) noexcept;
+
+#endif  // VALUE_STRINGSIMD_H_
@@ -3,13 +3,14 @@
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include "string_utils.hpp"
+#include "string_simd.hpp"
 
+// a null string is not equal to any string, not even to another null one
 #define null_check(a, b) do {                     \
- if (a == nullptr && b == nullptr) {              \
-    return true;                                  \
- } else if (a == nullptr || b == nullptr) {       \
+ if (a == nullptr || b == nullptr) {              \
     return false;                                 \
  }                                                \
  } while(0)                                       \
@@ -17,16 +18,13 @@
 bool string_case_equals(const char *a, size_t alen,
                                const char *b, size_t blen) {
   null_check(a, b);
-  return alen == blen && strncasecmp(a, b, alen) == 0;
+  return alen == blen && simd_case_equals(a, b, alen);
 }
 
 bool string_case_equals(const char *a, const char *b) {
   null_check(a, b);
-  while (tolower(*a) == tolower(*b)
-         && *a != '\0'
-         && *b != '\0') { a++; b++; }
-
-  return *a == '\0' && *b == '\0';
+  size_t alen = strlen(a);
+  return alen == strlen(b) && simd_case_equals(a, b, alen);
 }
 
 bool string_equals(const char *a, size_t alen,
@@ -37,11 +35,7 @@ bool string_equals(const char *a, size_t alen,
 
 bool string_equals(const char *a, const char *b) {
   null_check(a, b);
-
-  while (*a == *b
-         && *a != '\0'
-         && *b != '\0') { a++; b++; }
-  return *a == '\0' && *b == '\0';
+  return strcmp(a, b) == 0;
 }
 
 bool string_is_empty(const char *c,
@@ -83,11 +77,11 @@ bool string_is_not_newline(char c) {
 }
 
 bool string_is_blank(char c) {
-  return isspace(c);
+  return c == ' ' || static_cast<uint8_t>(c - '\t') <= '\r' - '\t';
 }
 
 bool string_is_not_blank(char c) {
-  return !isspace(c);
+  return !string_is_blank(c);
 }
 
 char *string_dup(const char *c) {
@@ -121,17 +115,170 @@ const char *string_skip_char(const char *c,
 
 const char *string_skip_line(const char *c,
                              size_t len) {
-  return string_skip_char(c, len, string_is_not_newline);
+  return simd_find_char(c, c + len, '\n');
+}
+
+const char *string_find_char(const char *c,
+                             size_t len,
+                             char ch) {
+  return simd_find_char(c, c + len, ch);
+}
+
+const char *string_find_any(const char *c,
+                            size_t len,
+                            const char *set,
+                            size_t nset) {
+  return simd_find_any(c, c + len, set, nset);
 }
 
 const char *string_skip_blank(const char *c,
                               size_t len) {
-  return string_skip_char(c, len, string_is_blank);
+  return simd_skip_blank(c, c + len);
 }
 
 const char *string_skip_non_blank(const char *c,
                                   size_t len) {
-  return string_skip_char(c, len, string_is_not_blank);
+  return simd_skip_non_blank(c, c + len);
+}
+
+/// swar_digits returns the number of leading ASCII digits in the
+/// 8 bytes of `chunk`, read as a little endian word
+static inline size_t swar_digits(uint64_t chunk) {
+  // a byte is a digit if its high nibble is 3 and adding
+  // 6 to it does not carry into the high nibble
+  const uint64_t high = chunk & 0xf0f0f0f0f0f0f0f0ULL;
+  const uint64_t carry = (chunk + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL;
+  const uint64_t non_digits = (high ^ 0x3030303030303030ULL) |
+                              (carry ^ 0x3030303030303030ULL);
+
+  return non_digits == 0 ? 8 : __builtin_ctzll(non_digits) >> 3;
+}
+
+/// swar_parse8 returns the value of the 8 ASCII digits of
+/// `chunk`, read as a little endian word, with 3 multiplications
+static inline uint64_t swar_parse8(uint64_t chunk) {
+  chunk -= 0x3030303030303030ULL;
+  chunk = (chunk * 10) + (chunk >> 8);
+  return (((chunk & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))) +
+          (((chunk >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32))))
+         >> 32;
+}
+
+/// parse_digits accumulates the decimal digits at `c` in `acc`, and
+/// returns the first byte that is not a digit. It sets `overflow`
+/// if the number does not fit in 64 bits
+static const char *parse_digits(const char *c,
+                                const char *end,
+                                uint64_t *acc,
+                                bool *overflow) {
+  uint64_t value = *acc;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (end - c >= 8) {
+    uint64_t chunk;
+    memcpy(&chunk, c, sizeof(chunk));
+
+    if (swar_digits(chunk) != 8) {
+      break;
+    }
+
+    if (__builtin_mul_overflow(value, 100000000ULL, &value) ||
+        __builtin_add_overflow(value, swar_parse8(chunk), &value)) {
+      *overflow = true;
+    }
+
+    c += 8;
+  }
+#endif
+
+  for (; c < end; c++) {
+    const uint8_t digit = static_cast<uint8_t>(*c - '0');
+    if (digit > 9) {
+      break;
+    }
+
+    if (__builtin_mul_overflow(value, 10, &value) ||
+        __builtin_add_overflow(value, digit, &value)) {
+      *overflow = true;
+    }
+  }
+
+  *acc = value;
+  return c;
+}
+
+/// parse_magnitude parses the blanks, sign and digits of a decimal
+/// number, and returns the magnitude of the number in `magnitude`
+static NumError parse_magnitude(const char *c,
+                                size_t len,
+                                uint64_t *magnitude,
+                                bool *negative,
+                                const char **endptr) {
+  const char *end = c + len;
+  const char *p = string_skip_blank(c, len);
+  bool overflow = false;
+
+  *negative = false;
+  *endptr = c;
+
+  if (p < end && (*p == '-' || *p == '+')) {
+    *negative = *p == '-';
+    p++;
+  }
+
+  uint64_t acc = 0;
+  const char *digits = p;
+  p = parse_digits(p, end, &acc, &overflow);
+
+  if (p == digits) {
+    return NumError::no_digits;
+
+  } else if (overflow) {
+    return NumError::range;
+  }
+
+  *magnitude = acc;
+  *endptr = p;
+  return NumError::none;
+}
+
+NumError string_to_uint64(const char *c,
+                          size_t len,
+                          uint64_t *value,
+                          const char **endptr) noexcept {
+  uint64_t magnitude;
+  bool negative;
+
+  NumError err = parse_magnitude(c, len, &magnitude, &negative, endptr);
+  if (err != NumError::none) {
+    return err;
+  }
+
+  *value = negative ? -magnitude : magnitude;
+  return NumError::none;
+}
+
+NumError string_to_int64(const char *c,
+                         size_t len,
+                         int64_t *value,
+                         const char **endptr) noexcept {
+  uint64_t magnitude;
+  bool negative;
+
+  NumError err = parse_magnitude(c, len, &magnitude, &negative, endptr);
+  if (err != NumError::none) {
+    return err;
+  }
+
+  const uint64_t limit = static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0);
+  if (magnitude > limit) {
+    *endptr = c;
+    return NumError::range;
+  }
+
+  *value = negative ? static_cast<int64_t>(0 - magnitude)
+                    : static_cast<int64_t>(magnitude);
+  return NumError::none;
 }
 
 /// strntol is a small modification of
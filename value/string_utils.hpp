@@ -4,6 +4,7 @@
 #define VALUE_STRINGUTILS_H_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <string>
@@ -37,10 +38,44 @@ const char *string_skip_char(const char *c,
                              char_skipper_t skipper);
 const char *string_skip_line(const char *c,
                              size_t len);
+const char *string_find_char(const char *c,
+                             size_t len,
+                             char ch);
+const char *string_find_any(const char *c,
+                            size_t len,
+                            const char *set,
+                            size_t nset);
 const char *string_skip_blank(const char *c,
                               size_t len);
 const char *string_skip_non_blank(const char *c,
                                   size_t len);
+/// NumError is the result of the decimal number parsing functions
+enum class NumError {
+  /// the number was parsed
+  none,
+  /// no digits were found
+  no_digits,
+  /// the number does not fit in the type
+  range
+};
+
+/// string_to_uint64 parses the decimal number at the start of
+/// the `len` bytes of `c`, after any blank bytes and an optional
+/// sign. A negative number is negated as an unsigned number. On
+/// success `value` is set to the number and `endptr` to the first
+/// byte after it. On error `endptr` is set to `c` and `value` is
+/// left untouched. Unlike strntoul, it does not use errno
+NumError string_to_uint64(const char *c,
+                          size_t len,
+                          uint64_t *value,
+                          const char **endptr) noexcept;
+
+/// string_to_int64 is the signed version of string_to_uint64
+NumError string_to_int64(const char *c,
+                         size_t len,
+                         int64_t *value,
+                         const char **endptr) noexcept;
+
 int64_t strntol(const char *nptr,
                 size_t len,
                 const char **endptr,
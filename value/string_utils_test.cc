@@ -2,6 +2,7 @@
 
 #include "test/test.hpp"
 
+#include "string_simd.hpp"
 #include "string_utils.hpp"
 
 static int test_case_equals() {
@@ -122,6 +123,123 @@ static int test_skip_non_blank() {
   return EXIT_SUCCESS;
 }
 
+static int test_find_char() {
+  const SimdLevel levels[] = {SimdLevel::scalar, SimdLevel::sse2,
+                              SimdLevel::avx2};
+  const SimdLevel best = simd_level();
+  char content[130];
+
+  for (SimdLevel level : levels) {
+    simd_set_level(level);
+
+    // every position and the tail of every vector width
+    for (size_t pos = 0; pos < sizeof(content); pos++) {
+      memset(content, 'a', sizeof(content));
+      content[pos] = '\n';
+      ASSERT_EQ(string_skip_line(content, sizeof(content)), content + pos);
+      ASSERT_EQ(string_find_char(content, pos, '\n'), content + pos);
+      ASSERT_EQ(string_find_any(content, sizeof(content), ",;\n", 3),
+                content + pos);
+    }
+
+    memset(content, 'a', sizeof(content));
+    ASSERT_EQ(string_find_char(content, sizeof(content), 'b'),
+              content + sizeof(content));
+    ASSERT_EQ(string_find_any(content, sizeof(content), "bcd", 3),
+              content + sizeof(content));
+    ASSERT_EQ(string_find_any(content, sizeof(content), "bcdefghijklmnopqa", 17),
+              content);
+  }
+
+  simd_set_level(best);
+  return EXIT_SUCCESS;
+}
+
+static int test_simd_levels() {
+  const SimdLevel levels[] = {SimdLevel::scalar, SimdLevel::sse2,
+                              SimdLevel::avx2};
+  const SimdLevel best = simd_level();
+  const char blanks[] = " \t\n\v\f\r";
+  char content[100];
+  char upper[100];
+
+  for (SimdLevel level : levels) {
+    simd_set_level(level);
+
+    for (size_t pos = 0; pos < sizeof(content); pos++) {
+      for (size_t i = 0; i < sizeof(content); i++) {
+        content[i] = blanks[i % 6];
+      }
+      content[pos] = 'w';
+      ASSERT_EQ(string_skip_blank(content, sizeof(content)), content + pos);
+
+      memset(content, 'w', sizeof(content));
+      content[pos] = blanks[pos % 6];
+      ASSERT_EQ(string_skip_non_blank(content, sizeof(content)),
+                content + pos);
+    }
+
+    for (size_t i = 0; i < sizeof(content); i++) {
+      content[i] = 'a' + i % 26;
+      upper[i] = 'A' + i % 26;
+    }
+
+    for (size_t len = 0; len <= sizeof(content); len++) {
+      ASSERT_TRUE(string_case_equals(content, len, upper, len));
+    }
+
+    // the bytes next to the letters differ by the case bit too
+    content[70] = '`';
+    upper[70] = '@';
+    ASSERT_FALSE(string_case_equals(content, 100, upper, 100));
+    content[70] = '{';
+    upper[70] = '[';
+    ASSERT_FALSE(string_case_equals(content, 100, upper, 100));
+    ASSERT_TRUE(string_case_equals(content, 70, upper, 70));
+  }
+
+  simd_set_level(best);
+  return EXIT_SUCCESS;
+}
+
+static int test_string_to_int() {
+  const char *endptr;
+  uint64_t uvalue;
+  int64_t value;
+
+  ASSERT_EQ(string_to_uint64("12345678", 8, &uvalue, &endptr), NumError::none);
+  ASSERT_EQ(uvalue, 12345678);
+  ASSERT_EQ(string_to_uint64("1234567890123456789x", 20, &uvalue, &endptr),
+            NumError::none);
+  ASSERT_EQ(uvalue, 1234567890123456789ULL);
+  ASSERT_EQ(*endptr, 'x');
+  ASSERT_EQ(string_to_uint64("18446744073709551615", 20, &uvalue, &endptr),
+            NumError::none);
+  ASSERT_EQ(uvalue, UINT64_MAX);
+  ASSERT_EQ(string_to_uint64("18446744073709551616", 20, &uvalue, &endptr),
+            NumError::range);
+  ASSERT_EQ(string_to_uint64("  +0000000000000042 ", 20, &uvalue, &endptr),
+            NumError::none);
+  ASSERT_EQ(uvalue, 42);
+  ASSERT_EQ(*endptr, ' ');
+  ASSERT_EQ(string_to_uint64(" x", 2, &uvalue, &endptr), NumError::no_digits);
+
+  ASSERT_EQ(string_to_int64("-9223372036854775808", 20, &value, &endptr),
+            NumError::none);
+  ASSERT_EQ(value, INT64_MIN);
+  ASSERT_EQ(string_to_int64("9223372036854775807", 19, &value, &endptr),
+            NumError::none);
+  ASSERT_EQ(value, INT64_MAX);
+  ASSERT_EQ(string_to_int64("9223372036854775808", 19, &value, &endptr),
+            NumError::range);
+  ASSERT_EQ(string_to_int64("-12345678a", 10, &value, &endptr),
+            NumError::none);
+  ASSERT_EQ(value, -12345678);
+  ASSERT_EQ(*endptr, 'a');
+
+  return EXIT_SUCCESS;
+}
+
 static int test_strntol() {
   ASSERT_EQ(strntol("1234", 4, nullptr, 10), 1234);
   ASSERT_EQ(strntol("-1234", 5, nullptr, 10), -1234);
@@ -157,6 +275,9 @@ int main(int argc, char *argv[]) {
   TEST_RUN(ctx, test_is_not_blank());
   TEST_RUN(ctx, test_skip_blank());
   TEST_RUN(ctx, test_skip_non_blank());
+  TEST_RUN(ctx, test_find_char());
+  TEST_RUN(ctx, test_simd_levels());
+  TEST_RUN(ctx, test_string_to_int());
   TEST_RUN(ctx, test_strntol());
   TEST_RUN(ctx, test_strntoul());
 